@@ -36,6 +36,12 @@
           headers.
         - When we receive the RXP_PLAYER_EVENT_RESET we will shutdown the player.
           So to restart playing you would need to call init() again.
+        - We create a fragment shader for each chroma layout (RXP_YUV420P, 
+          RXP_YUV422P and RXP_YUV444P) and use the one of `pix_fmt` of the 
+          packets. The chroma textures have the size of the chroma planes, we 
+          don't convert them to 4:2:0.
+        - We only upload the visible picture of the frames (see `pic_x`, `pic_y`,
+          `pic_width` and `pic_height` in rxp_packets.h). 
 
  */
 #ifndef RXP_CPP_PLAYER_GL_H
@@ -69,30 +75,58 @@ namespace rxp {
     "}                                          \n"
     "";
 
-  static const char* RXP_PLAYER_FS = "" 
-    "#version 330                                                      \n"
-    "uniform sampler2D u_ytex;                                         \n"
-    "uniform sampler2D u_utex;                                         \n"
-    "uniform sampler2D u_vtex;                                         \n"
-    "in vec2 v_tex;                                                    \n"
-    "const vec3 R_cf = vec3(1.164383,  0.000000,  1.596027);           \n"
-    "const vec3 G_cf = vec3(1.164383, -0.391762, -0.812968);           \n"
-    "const vec3 B_cf = vec3(1.164383,  2.017232,  0.000000);           \n"
-    "const vec3 offset = vec3(-0.0625, -0.5, -0.5);                    \n"
-    "layout( location = 0 ) out vec4 fragcolor;                        \n" 
-    "void main() {                                                     \n"
-    "  float y = texture(u_ytex, v_tex).r;                             \n"
-    "  float u = texture(u_utex, v_tex).r;                             \n"
-    "  float v = texture(u_vtex, v_tex).r;                             \n"
-    "  vec3 yuv = vec3(y,u,v);                                         \n"
-    "  yuv += offset;                                                  \n"
-    "  fragcolor = vec4(0.0, 0.0, 0.0, 1.0);                           \n"
-    "  fragcolor.r = dot(yuv, R_cf);                                   \n"
-    "  fragcolor.g = dot(yuv, G_cf);                                   \n"
-    "  fragcolor.b = dot(yuv, B_cf);                                   \n"
+  /* 
+     The chroma planes cover RXP_CHROMA_SCALE luma pixels per chroma pixel; when
+     the width or height is odd the last chroma pixel covers half of it, so we 
+     can't use the luma texcoord directly.
+  */
+#define RXP_PLAYER_FS_MAIN                                                    \
+    "uniform sampler2D u_ytex;                                         \n"   \
+    "uniform sampler2D u_utex;                                         \n"   \
+    "uniform sampler2D u_vtex;                                         \n"   \
+    "in vec2 v_tex;                                                    \n"   \
+    "const vec3 R_cf = vec3(1.164383,  0.000000,  1.596027);           \n"   \
+    "const vec3 G_cf = vec3(1.164383, -0.391762, -0.812968);           \n"   \
+    "const vec3 B_cf = vec3(1.164383,  2.017232,  0.000000);           \n"   \
+    "const vec3 offset = vec3(-0.0625, -0.5, -0.5);                    \n"   \
+    "layout( location = 0 ) out vec4 fragcolor;                        \n"   \
+    "void main() {                                                     \n"   \
+    "  vec2 ysize = vec2(textureSize(u_ytex, 0));                      \n"   \
+    "  vec2 csize = vec2(textureSize(u_utex, 0)) * RXP_CHROMA_SCALE;   \n"   \
+    "  vec2 c_tex = v_tex * (ysize / csize);                           \n"   \
+    "  float y = texture(u_ytex, v_tex).r;                             \n"   \
+    "  float u = texture(u_utex, c_tex).r;                             \n"   \
+    "  float v = texture(u_vtex, c_tex).r;                             \n"   \
+    "  vec3 yuv = vec3(y,u,v);                                         \n"   \
+    "  yuv += offset;                                                  \n"   \
+    "  fragcolor = vec4(0.0, 0.0, 0.0, 1.0);                           \n"   \
+    "  fragcolor.r = dot(yuv, R_cf);                                   \n"   \
+    "  fragcolor.g = dot(yuv, G_cf);                                   \n"   \
+    "  fragcolor.b = dot(yuv, B_cf);                                   \n"   \
     "}                                                                 \n"
+
+  static const char* RXP_PLAYER_FS_420 = "" 
+    "#version 330                                                      \n"
+    "#define RXP_CHROMA_SCALE vec2(2.0, 2.0)                           \n"
+    RXP_PLAYER_FS_MAIN
+    "";
+
+  static const char* RXP_PLAYER_FS_422 = "" 
+    "#version 330                                                      \n"
+    "#define RXP_CHROMA_SCALE vec2(2.0, 1.0)                           \n"
+    RXP_PLAYER_FS_MAIN
+    "";
+
+  static const char* RXP_PLAYER_FS_444 = "" 
+    "#version 330                                                      \n"
+    "#define RXP_CHROMA_SCALE vec2(1.0, 1.0)                           \n"
+    RXP_PLAYER_FS_MAIN
     "";
 
+  static const char* RXP_PLAYER_FS = RXP_PLAYER_FS_420;
+
+#undef RXP_PLAYER_FS_MAIN
+
   /* ------------------------------------------------------------------------*/
 
   class PlayerGL;
@@ -128,8 +162,9 @@ namespace rxp {
 
     /* GL */
     GLuint vert;
-    GLuint frag;
-    GLuint prog;
+    GLuint frag[3];                                                         /* the fragment shaders for RXP_YUV420P, RXP_YUV422P and RXP_YUV444P */
+    GLuint progs[3];                                                        /* the programs for each of the pixel formats */
+    GLuint prog;                                                            /* the program for the pixel format of the video, one of progs */
     GLuint vao;
     GLuint tex_y;
     GLuint tex_u;
@@ -138,6 +173,7 @@ namespace rxp {
 
     int video_width;
     int video_height;
+    int pix_fmt;                                                            /* the pixel format of the textures */
   };
 
   /* ------------------------------------------------------------------ */
@@ -211,7 +247,6 @@ namespace rxp {
 
   PlayerGL::PlayerGL() 
     :vert(0)
-    ,frag(0)
     ,prog(0)
     ,vao(0)
     ,tex_y(0)
@@ -219,10 +254,15 @@ namespace rxp {
     ,tex_v(0)
     ,video_width(0)
     ,video_height(0)
+    ,pix_fmt(RXP_YUV420P)
     ,on_event(NULL)
     ,on_video_frame(NULL)
     ,user(NULL)
   {
+    for (int i = 0; i < 3; ++i) {
+      frag[i] = 0;
+      progs[i] = 0;
+    }
   }
 
   PlayerGL::~PlayerGL() {
@@ -231,9 +271,13 @@ namespace rxp {
       ctx.shutdown();
     }
 
+    for (int i = 0; i < 3; ++i) {
+      if (0 != frag[i])  {   glDeleteShader(frag[i]);      frag[i] = 0;   }
+      if (0 != progs[i]) {   glDeleteProgram(progs[i]);    progs[i] = 0;  }
+    }
+
     if (0 != vert)  {   glDeleteShader(vert);            vert = 0;    }
-    if (0 != frag)  {   glDeleteShader(frag);            frag = 0;    }
-    if (0 != prog)  {   glDeleteProgram(prog);           prog = 0;    }
+    prog = 0;
     if (0 != vao)   {   glDeleteVertexArrays(1, &vao);   vao = 0;     }
     if (0 != tex_y) {   glDeleteTextures(1, &tex_y);     tex_y = 0;   }
     if (0 != tex_u) {   glDeleteTextures(1, &tex_u);     tex_u = 0;   }
@@ -249,7 +293,9 @@ namespace rxp {
   }
 
   int PlayerGL::init(std::string filepath) {
+    const char* fs[3] = { RXP_PLAYER_FS_420, RXP_PLAYER_FS_422, RXP_PLAYER_FS_444 };
     int r = 0;
+    int i = 0;
 
     /* initialize the player. */
     r = ctx.init(filepath);
@@ -263,20 +309,24 @@ namespace rxp {
         r = -1;
         goto error;
       }
-      if (0 != create_shader(&frag, GL_FRAGMENT_SHADER, RXP_PLAYER_FS)) {
-        r = -3;
-        goto error;
-      }
-      if (0 != create_program(&prog, vert, frag, 1)) {
-        r = -4;
-        goto error;
+      for (i = 0; i < 3; ++i) {
+        if (0 != create_shader(&frag[i], GL_FRAGMENT_SHADER, fs[i])) {
+          r = -3;
+          goto error;
+        }
+        if (0 != create_program(&progs[i], vert, frag[i], 1)) {
+          r = -4;
+          goto error;
+        }
+        glUseProgram(progs[i]);
+        glUniform1i(glGetUniformLocation(progs[i], "u_ytex"), 0);
+        glUniform1i(glGetUniformLocation(progs[i], "u_utex"), 1);
+        glUniform1i(glGetUniformLocation(progs[i], "u_vtex"), 2);
       }
 
       glGenVertexArrays(1, &vao);
-      glUseProgram(prog);
-      glUniform1i(glGetUniformLocation(prog, "u_ytex"), 0);
-      glUniform1i(glGetUniformLocation(prog, "u_utex"), 1);
-      glUniform1i(glGetUniformLocation(prog, "u_vtex"), 2);
+      pix_fmt = RXP_YUV420P;
+      prog = progs[0];
     }
 
     glGetIntegerv(GL_VIEWPORT, vp);
@@ -298,14 +348,17 @@ namespace rxp {
       glDeleteShader(vert);
       vert = 0;
     }
-    if (0 != frag) {
-      glDeleteShader(frag);
-      frag = 0;
-    }
-    if (0 != prog) {
-      glDeleteProgram(prog);
-      prog = 0;
+    for (i = 0; i < 3; ++i) {
+      if (0 != frag[i]) {
+        glDeleteShader(frag[i]);
+        frag[i] = 0;
+      }
+      if (0 != progs[i]) {
+        glDeleteProgram(progs[i]);
+        progs[i] = 0;
+      }
     }
+    prog = 0;
     if (0 != vao) {
       glDeleteVertexArrays(1, &vao);
       vao = 0;
@@ -395,9 +448,18 @@ namespace rxp {
       return;
     }
 
+    /* the image didn't change, the textures are still valid */
+    if (RXP_REPEAT_FRAME == pkt->type) {
+      return;
+    }
+
     /* did the width/height change? if so, we need to recreate the textures. */
     /* @todo - test this code correctly, should work, but not tested by switching the video source. */
-    if (0 != gl->tex_y && (pkt->img[0].width != gl->video_width || pkt->img[0].height != gl->video_height)) {
+    if (0 != gl->tex_y 
+        && (pkt->img[0].pic_width != gl->video_width 
+            || pkt->img[0].pic_height != gl->video_height
+            || pkt->pix_fmt != gl->pix_fmt))
+      {
       glDeleteTextures(1, &gl->tex_y);
       glDeleteTextures(1, &gl->tex_u);
       glDeleteTextures(1, &gl->tex_v);
@@ -408,28 +470,37 @@ namespace rxp {
 
     if (gl->tex_y == 0) {
 
-      gl->video_width = pkt->img[0].width;
-      gl->video_height = pkt->img[0].height;
+      gl->video_width = pkt->img[0].pic_width;
+      gl->video_height = pkt->img[0].pic_height;
+      gl->pix_fmt = pkt->pix_fmt;
+
+      /* the shader that matches the chroma layout */
+      switch (pkt->pix_fmt) {
+        case RXP_YUV422P: { gl->prog = gl->progs[1]; break; } 
+        case RXP_YUV444P: { gl->prog = gl->progs[2]; break; } 
+        default:          { gl->prog = gl->progs[0]; break; } 
+      }
 
       /* create textures after we've decoded a frame. */
-      gl->tex_y = create_texture(pkt->img[0].width, pkt->img[0].height);
-      gl->tex_u = create_texture(pkt->img[1].width, pkt->img[1].height);
-      gl->tex_v = create_texture(pkt->img[2].width, pkt->img[2].height);
+      gl->tex_y = create_texture(pkt->img[0].pic_width, pkt->img[0].pic_height);
+      gl->tex_u = create_texture(pkt->img[1].pic_width, pkt->img[1].pic_height);
+      gl->tex_v = create_texture(pkt->img[2].pic_width, pkt->img[2].pic_height);
     }
 
-    glBindTexture(GL_TEXTURE_2D, gl->tex_y);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, pkt->img[0].stride);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pkt->img[0].width, pkt->img[0].height, GL_RED, GL_UNSIGNED_BYTE, pkt->img[0].data);
-
-    glBindTexture(GL_TEXTURE_2D, gl->tex_u);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, pkt->img[1].stride);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pkt->img[1].width, pkt->img[1].height, GL_RED, GL_UNSIGNED_BYTE, pkt->img[1].data);
+    /* the visible picture can start at any column and have any width */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    glBindTexture(GL_TEXTURE_2D, gl->tex_v);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, pkt->img[2].stride);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pkt->img[2].width, pkt->img[2].height, GL_RED, GL_UNSIGNED_BYTE, pkt->img[2].data);
+    GLuint tex[3] = { gl->tex_y, gl->tex_u, gl->tex_v };
+    for (int i = 0; i < 3; ++i) {
+      rxp_img* img = &pkt->img[i];
+      glBindTexture(GL_TEXTURE_2D, tex[i]);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, img->stride);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, img->pic_width, img->pic_height, GL_RED, GL_UNSIGNED_BYTE, 
+                      img->data + img->pic_y * img->stride + img->pic_x);
+    }
 
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     /* and notify listener */
     if (gl->on_video_frame) {
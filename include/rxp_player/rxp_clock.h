@@ -14,7 +14,15 @@
 
    If you want to calculate the pts, when using an audio clock, you can use 
    `rxp_clock_calculate_audio_time()` by passing the total number of played samples.
-   It will return the pts in nanoseconds. 
+   It will return the pts in nanoseconds. `rxp_clock_calculate_audio_samples()`
+   does the opposite. We don't store the duration of one sample because that 
+   isn't a whole number of nanoseconds (22675.7 ns at 44.1kHz) and the rounding
+   error would add up; the time is always calculated from the number of samples
+   and the samplerate, so it's exact over any duration.
+
+   When the clock is paused with `rxp_clock_pause()` the time doesn't change until 
+   you call `rxp_clock_resume()`. An audio clock only advances when you add samples 
+   so pausing only affects the CPU clock.
 
  */
 
@@ -39,16 +47,21 @@ struct rxp_clock {
   uint64_t time;                                                              /* duration since the clock started in nanos*/
   uint64_t samplerate;                                                        /* audio clock: the sample rate to determine the current time */
   uint64_t nsamples;                                                          /* audio clock: how many audio samples were played */
-  uint64_t sample_time;                                                       /* audio clock: time in nano-seconds for one frame */
+  uint64_t time_paused;                                                       /* cpu clock: the time when we paused */
+  int is_paused;                                                              /* 1 when the clock is paused */
 };
 
 int rxp_clock_init(rxp_clock* clock);                                         /* initialize the members of the clock to defaults. */
 int rxp_clock_start(rxp_clock* clock);                                        /* start the clock, after calling `rxp_clock_update()`, the time member will holdt the time in milliseconds */
 int rxp_clock_stop(rxp_clock* clock);                                         /* stop the clock, resets everything */
 int rxp_clock_update(rxp_clock* clock);                                       /* update, this will calculate the new `time` member value */
+int rxp_clock_pause(rxp_clock* clock);                                        /* halt the clock, e.g. while we're waiting for data */
+int rxp_clock_resume(rxp_clock* clock);                                       /* continue from the time where we paused */
+int rxp_clock_seek(rxp_clock* clock, uint64_t pts);                           /* set the current time to pts (in nanoseconds); for an audio clock we set the number of played samples */
 int rxp_clock_shutdown(rxp_clock* clock);                                     /* resets everything to a state as it was before init() */
 int rxp_clock_set_samplerate(rxp_clock* clock, uint64_t samplerate);          /* when you set the samplerate, you make this clock a audio based clock, make sure to use */
 uint64_t rxp_clock_calculate_audio_time(rxp_clock* clock, uint64_t samples);  /* based on the samplerate of the clock this function will return the timestamp for the given number of samples */
+uint64_t rxp_clock_calculate_audio_samples(rxp_clock* clock, uint64_t pts);   /* based on the samplerate of the clock this function returns the number of samples that are played at the given pts */
 void rxp_clock_add_samples(rxp_clock* clock, uint32_t samples);               /* whenever you played some audio samples, call this with the number of audio samples you played so we know what current pts to use */
 
 #endif
@@ -0,0 +1,83 @@
+/*
+
+  rxp_decode_thread
+  -----------------
+
+  A thread with a bounded queue of compressed ogg packets. The decoder runs one
+  for the video and one for the audio stream: the thread that reads the pages
+  (the scheduler thread in the rxp_player) pushes the packets of a stream into
+  its queue and the decode thread passes them to the codec. Theora and vorbis
+  then decode in parallel and a slow video frame doesn't hold up the audio.
+
+  The packets returned by ogg_stream_packetout() point into the ogg stream
+  buffers which change with the next page, so we copy them into the slots of
+  the queue. Each slot keeps its buffer, so after the first couple of packets
+  nothing is allocated anymore. When the queue is full `rxp_decode_thread_push()`
+  blocks until the decode thread took a packet; this keeps the reader at most
+  RXP_DECODE_THREAD_SLOTS packets ahead. `nwaits` and `wait_time` tell you how
+  often and how long the reader waited for the decoder; read them with 
+  `rxp_decode_thread_get_stats()`.
+
+  The callback is called on the decode thread, without holding the mutex. Push,
+  flush and wait must be called from the same thread (the reader). Each slot
+  keeps the `late_pts` that the reader passed with the packet, so the decode
+  thread never reads the state of the reader. When the callback publishes 
+  something that other threads read (e.g. the decoded pts) it can wrap that 
+  in `rxp_decode_thread_lock()` and `rxp_decode_thread_unlock()`. When the 
+  callback returns < 0 we keep the first error until the thread is flushed; the
+  reader checks it with `rxp_decode_thread_error()`.
+
+ */
+#ifndef RXP_DECODE_THREAD_H
+#define RXP_DECODE_THREAD_H
+
+#include <stdint.h>
+#include <ogg/ogg.h>
+#include <uv.h>
+
+#define RXP_DECODE_THREAD_SLOTS 64                                          /* the max. number of packets in the queue */
+
+typedef struct rxp_decode_slot rxp_decode_slot;
+typedef struct rxp_decode_thread rxp_decode_thread;
+
+typedef int(*rxp_decode_thread_callback)(void* user, void* stream, ogg_packet* packet, uint64_t late_pts); /* is called on the decode thread for each packet, in the order they were pushed; returns < 0 on error */
+
+struct rxp_decode_slot {
+  ogg_packet packet;                                                        /* the copy of the packet, `packet.packet` points into `data` */
+  void* stream;                                                             /* the stream that was passed to `rxp_decode_thread_push()` */
+  uint64_t late_pts;                                                        /* the `late_pts` of the decoder when the packet was pushed */
+  unsigned char* data;                                                      /* the buffer we copy the packet data into, we reuse it for the next packets */
+  long capacity;                                                            /* the size of data */
+};
+
+struct rxp_decode_thread {
+  rxp_decode_slot slots[RXP_DECODE_THREAD_SLOTS];                           /* the queue */
+  uint32_t head;                                                            /* the slot we write the next packet into */
+  uint32_t tail;                                                            /* the slot of the next packet that we decode */
+  uint32_t count;                                                           /* number of packets in the queue, including the one that is being decoded */
+  int is_busy;                                                              /* 1 while the callback is called */
+  int must_stop;                                                            /* set to 1 when the thread must stop */
+  int error;                                                                /* the first error that the callback returned since we started or flushed, 0 when none */
+  rxp_decode_thread_callback on_packet;                                     /* decodes a packet */
+  void* user;                                                               /* is passed into on_packet */
+  uv_thread_t thread;                                                       /* the decode thread */
+  uv_mutex_t mutex;                                                         /* protects the positions and flags */
+  uv_cond_t cond;                                                           /* is signalled whenever a packet is added or decoded */
+  uint64_t npackets;                                                        /* statistics: number of packets we decoded */
+  uint64_t nwaits;                                                          /* statistics: how often the reader had to wait because the queue was full */
+  uint64_t wait_time;                                                       /* statistics: total time in nanoseconds that the reader waited */
+  int is_init;                                                              /* 0xCAFEBABE when the thread is running */
+};
+
+int rxp_decode_thread_init(rxp_decode_thread* t);                           /* set all members to defaults */
+int rxp_decode_thread_start(rxp_decode_thread* t, rxp_decode_thread_callback cb, void* user); /* starts the thread which calls cb for each packet */
+int rxp_decode_thread_stop(rxp_decode_thread* t);                           /* drops the queued packets, joins the thread and frees the slots */
+int rxp_decode_thread_push(rxp_decode_thread* t, void* stream, ogg_packet* packet, uint64_t late_pts); /* copies the packet into the queue, blocks while the queue is full */
+int rxp_decode_thread_wait(rxp_decode_thread* t);                           /* blocks until all queued packets have been decoded */
+int rxp_decode_thread_flush(rxp_decode_thread* t);                          /* drops the queued packets and blocks until the packet that is being decoded is ready */
+int rxp_decode_thread_get_stats(rxp_decode_thread* t, uint64_t* npackets, uint64_t* nwaits, uint64_t* wait_time); /* copies the statistics, can be called from any thread */
+int rxp_decode_thread_error(rxp_decode_thread* t);                          /* returns the first error of the callback since we started or flushed; 0 when there was none or when the thread isn't running */
+int rxp_decode_thread_lock(rxp_decode_thread* t);                           /* locks the mutex of a running thread, returns < 0 and does nothing when the thread isn't running */
+int rxp_decode_thread_unlock(rxp_decode_thread* t);                         /* unlocks the mutex of a running thread */
+
+#endif
@@ -4,14 +4,151 @@
   -----------
   
   The rxp_decoder takes care of demuxing an .ogg stream that contains
-  theora and/or vorbis (at the time of writing only these stream types are 
-  supported by in the future we will add support for daala and opus). The 
-  general flow is showed in the `test_decoder.c` file. 
+  theora and/or vorbis or opus audio (opus only when compiled with 
+  RXP_USE_OPUS and linked with libopus). The general flow is showed in the 
+  `test_decoder.c` file. 
 
   Every time you call `rxp_decoder_decode()` we will decoder another batch
   of packets and make sure the set callbacks will be called. You can set a 
   callback that receives the decoded video buffer (yuv420p).
 
+  Each stream has its own codec context and we find the stream of a page with
+  a hash on its serial. A file can contain several theora and vorbis streams 
+  (e.g. camera angles or languages); we call these tracks and number them per 
+  type in the order of their BOS pages. We only decode one video and one audio
+  track, by default the first ones. Use `rxp_decoder_select_track()` before you
+  start decoding to select another one; the pages of the other tracks are 
+  dropped before they reach libogg or the codecs. With `rxp_decoder_enable_streams()`
+  you can disable the video or audio completely, e.g. for a muted video wall or
+  when you only need the audio; the pages of a disabled type are dropped too.
+
+  Chained files are several ogg files concatenated after each other; each of 
+  these links has its own streams with new serials. When all streams ended and
+  we get a new BOS page, we free the streams of the previous link, fire the 
+  RXP_DEC_EVENT_CHAIN event and continue with the streams of the new link. The
+  codecs are set up from the headers of the new link, so the frame size and
+  audio format may change (we fire RXP_DEC_EVENT_AUDIO_INFO and
+  RXP_DEC_EVENT_VIDEO_INFO again). The pts of
+  a link starts at `chain_pts`, the end of the previous link, so the timeline
+  continues without a gap. Seeking is only possible in the first link.
+
+  The decoder reads from an rxp_io source (see rxp_io.h). Use `rxp_decoder_open_io()`
+  to decode from memory or from your own reader, or `rxp_decoder_open_file()` to 
+  open a file. By default we memory map the file (see rxp_mmap.h) and feed the ogg 
+  sync layer from the mapping. When the file cannot be mapped we read the file from
+  a separate thread that keeps `readahead_size` bytes in memory (see rxp_readahead.h).
+  The decoder owns the source once `rxp_decoder_open_io()` accepted it: it's closed
+  by `rxp_decoder_close_file()`, or directly when opening fails after that.
+  Use `rxp_decoder_seek()` to jump to a pts. We bisect the file on the granulepos
+  of the pages to find the theora keyframe before the pts (using the keyframe 
+  granule shift) and the vorbis page before it. We continue decoding from there 
+  but don't call `on_theora` and `on_audio` until we've reached the pts; the first
+  audio samples you get start exactly at the sample of the pts. Seeking needs a 
+  source with a seek callback and reads O(log(file size)) pages; the decoding 
+  cost depends on the distance to the previous keyframe. With RXP_IO_READAHEAD we
+  read directly from the file while bisecting and restart the read-ahead thread 
+  once, at the offset where we continue decoding. That offset is stored in 
+  `seek_offset`; `rxp_decoder_seek_offset()` goes back to it w/o searching 
+  again, e.g. when you demuxed ahead of a seek and want to start over.
+
+  When there is a seek index sidecar next to the file (see rxp_index.h), 
+  `rxp_decoder_open_file()` loads it and `rxp_decoder_seek()` uses the offsets from
+  the index instead of bisecting the file. The index also gives us the `duration`
+  of the file directly after opening it. Files with an Ogg Skeleton 4.0 track 
+  don't need a sidecar: we read the keyframe index and duration from the skeleton
+  packets while decoding the headers.
+
+  Adaptive quality: when you set `late_pts` to the current playback time before
+  decoding, we assume that frames which end before it won't be shown anymore. 
+  When decoded frames are late we lower the theora post-processing level 
+  (TH_DECCTL_SET_PPLEVEL) and raise it again when we're on time for a while. 
+  Non-keyframe packets that are more than RXP_DEC_LATE_DROP nanoseconds late 
+  aren't decoded at all; once we skip a packet we skip everything until the next
+  keyframe, because the following frames depend on it. `nframes_skipped` counts
+  these. `late_pts` is 0 by default which disables all of this. With decode 
+  threads each packet takes the `late_pts` of the moment it was read along, so
+  only the thread that calls `rxp_decoder_decode()` reads the field.
+
+  You can select the input mode by setting `io_mode` before opening the file; 
+  RXP_IO_STDIO reads the file with fread() on the decoding thread. With RXP_IO_MMAP
+  and the memory source we don't copy the data, the rxp_framer finds the pages 
+  directly in the mapping. Use RXP_IO_STREAM
+  to decode a FIFO or a file that is still being written; when there is no new data
+  `rxp_decoder_decode()` returns 1 and sets the RXP_DEC_STATE_WAITING state instead
+  of firing RXP_DEC_EVENT_READY. Just call it again later.
+
+  Demuxing
+  --------
+
+  When you only need the compressed packets (e.g. to analyse or remux a file), 
+  call `rxp_decoder_demux()` instead of `rxp_decoder_decode()`. It returns the
+  next packet of any stream in file order without passing it to a codec, so it
+  runs at the speed of the source. We only parse the headers that we need to 
+  compute the timing (the theora identification header, all vorbis headers and
+  the OpusHead). The packet data points into the ogg stream buffers, nothing 
+  is allocated per packet; the packet is valid until the next call. 
+
+      rxp_demux_packet pkt;
+
+      while (0 == rxp_decoder_demux(decoder, &pkt)) {
+        printf("%d: %ld bytes, granule: %lld, pts: %lld%s\n", pkt.serial, pkt.packet.bytes,
+               pkt.granulepos, pkt.pts, pkt.is_keyframe ? ", keyframe" : "");
+      }
+
+  Ogg only stores the granulepos of the last packet that ends on a page, we 
+  compute it for the other packets: theora counts frames from the keyframe flag 
+  and vorbis and opus count the samples of each packet. Every page with a 
+  granulepos resyncs the count. `pts` is the end time of the packet, the same
+  value that the decoder presents the frame or samples with. After 
+  `rxp_decoder_seek()` or a gap in the data we don't know the position until the
+  next page with a granulepos; until then `granulepos` and `pts` are -1. For 
+  theora we count back from the granule of that page, so we know the pts of all
+  its packets, and the granulepos from the next keyframe on. Don't mix 
+  `rxp_decoder_demux()` and `rxp_decoder_decode()` on the same decoder.
+
+  Decode threads
+  --------------
+
+  Set `use_threads` to 1 before opening a file to decode the video and audio 
+  on their own threads (see rxp_decode_thread.h). `rxp_decoder_decode()` then
+  only reads the pages and pushes the packets of the video and audio stream into
+  a bounded queue per stream; theora and vorbis (or opus) decode in parallel and
+  a slow video frame doesn't hold up the audio. When a queue is full, 
+  `rxp_decoder_decode()` blocks until the decode thread took a packet. The 
+  `decoded_pts` of a stream is updated by its decode thread, so it trails the 
+  pages that we've read; use `rxp_decoder_get_decoded_pts()` to read it from
+  another thread. `on_theora`, `on_theora_stripe` and `on_theora_dup` are
+  called on the video thread, `on_audio` and `on_audio_interleaved` on the audio
+  thread and `on_event` on any of them. `rxp_decoder_seek()` and 
+  `rxp_decoder_close_file()` drop the queued packets; before we fire 
+  RXP_DEC_EVENT_READY or start the next link of a chained file we wait until all
+  queued packets have been decoded. The threads are started when we open the 
+  first file and stopped by `rxp_decoder_clear()`. The rxp_player enables this
+  by default.
+
+  Reusing a decoder
+  -----------------
+
+  Once a file has been read the decoder stays in the ready state. Call 
+  `rxp_decoder_reset()` before you open the next file on the same decoder; it
+  closes the source, frees the streams and their codec contexts and resets the
+  sync layer, but keeps the decode threads (and their slot buffers), the 
+  selected tracks, the enabled streams and the callbacks.
+
+  Statistics
+  ----------
+
+  `rxp_decoder_get_stats()` fills a rxp_decoder_stats with the counters that 
+  help you tune the decoder: how often and how long we waited for the read-ahead
+  thread (RXP_IO_READAHEAD, see `readahead_size`), how many packets the decode
+  threads decoded and how long `rxp_decoder_decode()` waited for them, and the
+  number of theora frames we skipped because they were too late. Call it on 
+  the thread that decodes (the scheduler thread of a player), between calls to
+  `rxp_decoder_decode()`: opening, seeking and closing stop and restart the 
+  read-ahead thread, so its counters can't be read while that happens. The 
+  read-ahead counters restart with each file and after a seek, the decode thread
+  counters run as long as the threads, see `rxp_decoder_reset()`.
+
   You can set an event listener that is called whenever something worth notifying
   occurs. Note that if you use the rxp_decoder directly with the rxp_scheduler (or
   rxp_player), the callback may be called from another thread. 
@@ -24,6 +161,29 @@
                       in memory, you should copy it in your callback.
 
 
+     on_theora_stripe: when set before the theora headers are decoded, this is
+                      called from th_decode_packetin() (see TH_DECCTL_SET_STRIPE_CB)
+                      with each stripe of the frame as soon as it's decoded, while
+                      the rows are still in the cache. `row0` and `row_end` are the
+                      range of luma rows, top-down, chroma rows are scaled with the 
+                      pixel format. It's also called for frames that we decode but
+                      don't present (e.g. after a seek); on_theora_frame tells you
+                      when a frame is presented.
+
+     on_theora_dup:   theora encoders emit an empty packet when a frame is the same
+                      as the previous one (TH_DUPFRAME). When this callback is set we
+                      call it with the pts of the duplicate instead of on_theora_frame
+                      so you don't need to copy or upload the same image again. When 
+                      it's not set you get the previous image with the new pts.
+
+     on_audio:        is called with the decoded audio, one buffer per channel.
+
+     on_audio_interleaved: opus decodes interleaved audio; when this callback is set
+                      we call it with the decoded opus samples directly, otherwise
+                      we deinterleave them for on_audio. Vorbis audio always goes
+                      to on_audio. Opus always decodes at 48kHz; we drop the
+                      pre-skip samples at the start and the padding at the end.
+
      on_event:        this will be called when certain events occur like
                       when we're ready with reading all packets. 
         
@@ -38,21 +198,47 @@
 #include <ogg/ogg.h>
 #include <theora/theoradec.h>
 #include <vorbis/codec.h>
+#if defined(RXP_USE_OPUS)
+#  include <opus/opus_multistream.h>
+#endif
+#include <rxp_player/rxp_io.h>
+#include <rxp_player/rxp_index.h>
+#include <rxp_player/rxp_framer.h>
+#include <rxp_player/rxp_decode_thread.h>
+
+#define RXP_DEC_STREAM_BUCKETS 64                                                                  /* number of buckets of the serial hash, must be a power of two */
+#define RXP_DEC_LATE_DROP (100 * 1000ull * 1000ull)                                                /* when a non-keyframe ends more than this many ns before `late_pts` we don't decode it */
+#define RXP_DEC_PP_DOWN_FRAMES 2                                                                   /* we lower the post-processing level after this many late frames */
+#define RXP_DEC_PP_UP_FRAMES 120                                                                   /* we raise the post-processing level after this many frames that were on time */
+#define RXP_OPUS_RATE 48000                                                                        /* opus always decodes at 48kHz */
+#define RXP_OPUS_MAX_FRAMES 5760                                                                   /* the max. number of samples per channel in an opus packet (120ms) */
 
 typedef struct rxp_theora rxp_theora;
 typedef struct rxp_vorbis rxp_vorbis;
+typedef struct rxp_opus rxp_opus;
 typedef struct rxp_stream rxp_stream;
+typedef struct rxp_demux_packet rxp_demux_packet;
+typedef struct rxp_decoder_stats rxp_decoder_stats;
 typedef struct rxp_decoder rxp_decoder;
 
 typedef void (*decoder_event_callback)(rxp_decoder* decoder, int event);                           /* callback interface for decoder events. */ 
 typedef void (*theora_frame_callback)(rxp_decoder* decoder, uint64_t pts, th_ycbcr_buffer buffer); /* callback that is called when decoding theora frames. */
+typedef void (*theora_stripe_callback)(rxp_decoder* decoder, th_ycbcr_buffer buffer, int row0, int row_end); /* callback that is called with the rows [row0, row_end) of the luma plane as soon as they're decoded */
+typedef void (*theora_dup_callback)(rxp_decoder* decoder, uint64_t pts);                           /* callback that is called when a theora frame is a duplicate of the previous one; the previous frame is shown until pts */
 typedef void (*decoder_audio_callback)(rxp_decoder* decoder, float** pcm, int nframes);            /* callback that is called whne the decoder decodes audio data (vorbis at the time of writing), pcm[0] contains the left channel, pcm[1] the right one (when multi channel audio is used) */
+typedef void (*decoder_audio_interleaved_callback)(rxp_decoder* decoder, float* pcm, int nframes); /* callback that is called with interleaved audio (opus), pcm contains nframes * nchannels samples */
 
 struct rxp_theora {
   th_info info;
   th_comment comment;
   th_setup_info* setup;
   th_dec_ctx* ctx;
+  int64_t nframes;                                                                                 /* the number of frames up to the last packet (keyframe + offset part of its granule), -1 when unknown; we use it to restore the granule after skipping packets */
+  int is_skipping;                                                                                 /* 1 when we skip the packets until the next keyframe because we're too late */
+  int pp_level;                                                                                    /* the current post-processing level */
+  int pp_level_max;                                                                                /* the max. post-processing level we use, see `pp_level` of the decoder */
+  int nframes_late;                                                                                /* number of late frames since we changed the post-processing level */
+  int nframes_on_time;                                                                             /* number of frames that were on time since we changed the post-processing level */
 };
 
 struct rxp_vorbis {
@@ -64,31 +250,101 @@ struct rxp_vorbis {
   int is_dsp_init;                                                                                 /* is set to 1 when `vorbis_synthesis_init()` has been called on the state and block and we can call vorbis_block_clear() and vorbis_sdp_clear. */
 };
 
+struct rxp_opus {
+  struct OpusMSDecoder* ctx;                                                                       /* the decoder, created when we've parsed the OpusHead packet */
+  float* pcm;                                                                                      /* the interleaved output of the decoder, RXP_OPUS_MAX_FRAMES per channel */
+  float** planar;                                                                                  /* when we don't have an `on_audio_interleaved` callback we deinterleave into these buffers */
+  int channels;                                                                                    /* number of output channels */
+  int preskip;                                                                                     /* the number of samples at the start of the stream that we don't present; the granulepos includes them */
+  int skip;                                                                                        /* the number of pre-skip samples that we still need to drop */
+  int num_header_packets;                                                                          /* the number of header packets we've read, OpusHead and OpusTags */
+};
+
+struct rxp_demux_packet {
+  ogg_packet packet;                                                                               /* the compressed packet, the data is valid until the next call of `rxp_decoder_demux()` */
+  int serial;                                                                                      /* serial of the stream */
+  int type;                                                                                        /* RXP_THEORA, RXP_VORBIS, RXP_OPUS, RXP_SKELETON or RXP_NONE for streams we don't know */
+  int track;                                                                                       /* the track of the stream between the streams of the same kind, -1 for other streams */
+  int link;                                                                                        /* the link of a chained file the packet belongs to */
+  int64_t granulepos;                                                                              /* the granulepos of the packet, also when it doesn't end a page; -1 when unknown */
+  int64_t pts;                                                                                     /* the end time of the packet in nanoseconds, including the `chain_pts`; -1 when unknown or for header packets */
+  int is_keyframe;                                                                                 /* 1 for theora keyframes and for all audio data packets */
+  int is_header;                                                                                   /* 1 for codec header packets and skeleton packets */
+};
+
+struct rxp_decoder_stats {
+  uint64_t io_nreads;                                                                              /* RXP_IO_READAHEAD: the number of fread() calls of the read-ahead thread, 0 for other modes */
+  uint64_t io_nwaits;                                                                              /* RXP_IO_READAHEAD: how often the decoder had to wait for data */
+  uint64_t io_wait_time;                                                                           /* RXP_IO_READAHEAD: total time in nanoseconds that the decoder waited for data */
+  uint64_t video_npackets;                                                                         /* `use_threads`: the number of packets the video thread decoded */
+  uint64_t video_nwaits;                                                                           /* `use_threads`: how often we waited because the queue of the video thread was full */
+  uint64_t video_wait_time;                                                                        /* `use_threads`: total time in nanoseconds that we waited for the video thread */
+  uint64_t audio_npackets;                                                                         /* `use_threads`: the number of packets the audio thread decoded */
+  uint64_t audio_nwaits;                                                                           /* `use_threads`: how often we waited because the queue of the audio thread was full */
+  uint64_t audio_wait_time;                                                                        /* `use_threads`: total time in nanoseconds that we waited for the audio thread */
+  uint64_t nframes_skipped;                                                                        /* the number of theora packets that we didn't decode because they were too late, see `late_pts` */
+};
+
 struct rxp_stream {
   int64_t decoded_pts;                                                                             /* last decoded pts for this stream, we need to keep track of this, so a user of this code can decode up to a given goal pts as done in the rxp_player.*/
   uint64_t decoded_frames;                                                                         /* decoded video frames or audio samples, used to e.g. calculate the decoded_pts for audio */
   int eos;                                                                                         /* end of stream, is set to 1 when the stream ended */
   int serial;                                                                                      /* serial of the stream */
   int type;                                                                                        /* what kind of decoder type */      
+  int is_ignored;                                                                                  /* 1 when we couldn't detect the codec of the stream (e.g. kate); `rxp_decoder_decode()` drops its pages */
+  int seek_state;                                                                                  /* RXP_SEEK_{NONE,SYNC,SKIP}, see rxp_decoder_seek() */
+  int64_t seek_granule;                                                                            /* the granulepos of the page found by the last bisection, -1 when none */
+  int track;                                                                                       /* the index of this stream between the streams of the same type, in the order of the bos pages */
+  int64_t demux_frame;                                                                             /* `rxp_decoder_demux()`: theora: the frame count (keyframe + offset of the granule) of the last packet, audio: the granule of the last packet */
+  int64_t demux_keyframe;                                                                          /* `rxp_decoder_demux()`: the frame count of the last theora keyframe */
+  int demux_blocksize;                                                                             /* `rxp_decoder_demux()`: the blocksize of the last vorbis packet, 0 when we haven't seen one */
+  int demux_partial;                                                                               /* `rxp_decoder_demux()`: 1 when the stream state holds the start of a packet that continues on the next page */
   ogg_stream_state stream_state;                                                                   /* ogg stream state */
-  rxp_theora* theora;                                                                              /* pointer to the theora decoder */
+  rxp_theora theora;                                                                               /* the theora decoder, only used for RXP_THEORA streams */
+  rxp_vorbis vorbis;                                                                               /* the vorbis decoder, only used for RXP_VORBIS streams */
+  rxp_opus opus;                                                                                   /* the opus decoder, only used for RXP_OPUS streams */
+  rxp_stream* hash_next;                                                                           /* the next stream in the same bucket of the serial hash */
   rxp_stream* next;
 };
 
 struct rxp_decoder {
-  rxp_vorbis vorbis;                                                                               /* the vorbis decoder members */
-  rxp_theora theora;                                                                               /* the theora decoder members */
-  rxp_stream* streams;                                                                             /* the streams in the ogg file */
-  FILE* fp;                                                                                        /* at this moment we only support reading from a file */
-  uint32_t file_size;                                                                              /* size of the file we're reading */
+  rxp_stream* streams;                                                                             /* the streams in the ogg file, in the order of their bos pages */
+  rxp_stream* stream_table[RXP_DEC_STREAM_BUCKETS];                                                /* the same streams, hashed on their serial */
+  rxp_stream* video;                                                                               /* the theora stream that we decode, NULL until we found it */
+  rxp_stream* audio;                                                                               /* the vorbis or opus stream that we decode, NULL until we found it */
+  int video_track;                                                                                 /* the theora track we decode, 0 = the first theora stream, see `rxp_decoder_select_track()` */
+  int audio_track;                                                                                 /* the audio track we decode, 0 = the first vorbis or opus stream */
+  int stream_mask;                                                                                 /* the stream types we decode, RXP_DEC_STREAM_ALL by default, see `rxp_decoder_enable_streams()` */
+  rxp_io io;                                                                                       /* the source we read from; when reading a file with RXP_IO_READAHEAD, `io.readahead` contains the wait statistics */
+  uint32_t readahead_size;                                                                         /* the read-ahead window in bytes used by `rxp_decoder_open_file()`, defaults to RXP_READAHEAD_DEFAULT_SIZE */
+  int io_mode;                                                                                     /* RXP_IO_MMAP (default), RXP_IO_READAHEAD, RXP_IO_STDIO or RXP_IO_STREAM, used by `rxp_decoder_open_file()`. when the file cannot be mapped we use RXP_IO_READAHEAD; `io.mode` is the mode we actually use, this stays what you asked for */
+  int64_t file_size;                                                                               /* size of the stream we're reading, < 0 when unknown */
+  rxp_framer framer;                                                                               /* finds the pages in place when the source is memory backed (RXP_IO_MMAP, RXP_IO_MEMORY) so we don't copy the data into the ogg sync layer */
+  rxp_index index;                                                                                 /* the seek index, loaded from the sidecar by `rxp_decoder_open_file()`; nstreams is 0 when there is no index */
+  uint64_t duration;                                                                               /* the duration in nanoseconds when we know it (from the index), else 0 */
+  uint64_t chain_pts;                                                                              /* the pts at which the current link of a chained file starts, 0 for the first link */
+  uint64_t late_pts;                                                                               /* frames that end before this pts won't be shown anymore; set it to the playback time to enable adaptive quality, 0 (default) disables it */
+  int pp_level;                                                                                    /* the highest theora post-processing level we use, -1 (default) is the max. level of the stream */
+  uint64_t nframes_skipped;                                                                        /* number of theora packets that we didn't decode because they were too late, use `rxp_decoder_get_stats()` to read it from another thread */
+  int link;                                                                                        /* the index of the current link of a chained file, 0 for the first one */
+  rxp_stream* demux_stream;                                                                        /* the stream of the last page read by `rxp_decoder_demux()`, until we returned all its packets */
+  int use_threads;                                                                                 /* 1 we decode the video and audio on their own threads, 0 (default) we decode on the thread that calls `rxp_decoder_decode()`; set before opening a file */
+  rxp_decode_thread video_thread;                                                                  /* decodes the packets of the video stream when `use_threads` is 1 */
+  rxp_decode_thread audio_thread;                                                                  /* decodes the packets of the audio stream when `use_threads` is 1 */
   ogg_sync_state sync_state;                                                                       /* used by ogg, state tracking */
   int state;                                                                                       /* the current state */
+  uint64_t seek_pts;                                                                               /* the pts of the last seek, we don't present data before this pts while a stream has a seek_state */
+  int64_t seek_offset;                                                                             /* the byte offset from where we decode after the last seek, -1 before the first seek; see rxp_decoder_seek_offset() */
   uint64_t samplerate;                                                                             /* @todo: not sure if we need to store this here ... it's in player where we need it .. maybe pass it into callback (?) - when we find an audio stream, we set the samplerate and fire the RXP_DEC_EVENT_AUDIO_INFO event - UPDATE: I think it might be worth having here as we use it now (as experiment) to calculate the pts for the audio stream */
   int nchannels;                                                                                   /* @todo: not sure if we need to store this here .... "" "" - number of audio channels found */
+  int pix_fmt;                                                                                     /* RXP_YUV420P, RXP_YUV422P or RXP_YUV444P; the chroma layout of the video stream, set before we fire RXP_DEC_EVENT_VIDEO_INFO */
   int is_init;                                                                                     /* 1 when init, else -1 */
   void* user;                                                                                      /* can be set to anything by the user */
   theora_frame_callback on_theora;                                                                 /* will be called when we've decoded a theora frame */
+  theora_stripe_callback on_theora_stripe;                                                         /* when set, will be called with each decoded stripe of a theora frame */
+  theora_dup_callback on_theora_dup;                                                               /* when set, will be called instead of on_theora for duplicate frames */
   decoder_audio_callback on_audio;                                                                 /* will be called when we've decoded some audio */
+  decoder_audio_interleaved_callback on_audio_interleaved;                                         /* when set, will be called instead of on_audio with decoded opus audio */
   decoder_event_callback on_event;                                                                 /* will be called when an event occurs (e.g. file closed.) */
 };
 
@@ -97,7 +353,17 @@ rxp_decoder* rxp_decoder_alloc();
 int rxp_decoder_init(rxp_decoder* decoder);                                                        /* initialize a decoder, returns < 0 on error after which you should dealloc if necessary */
 int rxp_decoder_clear(rxp_decoder* decoder);                                                       /* free the allocated memory of the decoder */
 int rxp_decoder_open_file(rxp_decoder* decoder, char* filepath);                                   /* open the video file */
-int rxp_decoder_decode(rxp_decoder* decoder);                                                      /* decodes one frame */
-int rxp_decoder_close_file(rxp_decoder* decoder);                                                  /* close file */
+int rxp_decoder_open_io(rxp_decoder* decoder, rxp_io* io);                                         /* decode from the given source; we copy the rxp_io struct and call its close callback when we're ready. when we can't start decoding it (-5, -6) we close it too and reset `io`, so rxp_io_is_open(io) tells you if you still own it */
+int rxp_decoder_decode(rxp_decoder* decoder);                                                      /* decodes one frame, returns 1 when the stream has no new data yet and -8 when a codec failed; with decode threads we return that with the call after the failing packet */
+int rxp_decoder_demux(rxp_decoder* decoder, rxp_demux_packet* pkt);                                /* returns 0 and the next compressed packet w/o decoding it, 1 when the stream has no new data yet and < 0 at the end or on error */
+int rxp_decoder_seek(rxp_decoder* decoder, uint64_t pts);                                          /* continue decoding at the given pts in nanoseconds, the source must be seekable. returns -3 when it isn't, -4 before the headers are decoded, -5 when we can't find the offset, -6 when the source and -8 when the page framer can't seek, -7 after the first link of a chained file, -9 when we can't pause the read-ahead */
+int rxp_decoder_seek_offset(rxp_decoder* decoder, uint64_t pts, int64_t offset);                  /* like rxp_decoder_seek() but continues at the `seek_offset` of an earlier seek to the same pts w/o searching it again. returns -10 for an invalid offset */
+int rxp_decoder_select_track(rxp_decoder* decoder, int type, int track);                           /* select the RXP_THEORA or audio (RXP_VORBIS, RXP_OPUS) track to decode, call this before you start decoding */
+int rxp_decoder_enable_streams(rxp_decoder* decoder, int mask);                                    /* only decode the RXP_DEC_STREAM_{VIDEO,AUDIO} types in mask, call this before you start decoding */
+int rxp_decoder_close_file(rxp_decoder* decoder);                                                  /* close the file or source */
+int rxp_decoder_is_open(rxp_decoder* decoder);                                                     /* returns 0 when a file or source is opened, else < 0 */
+int rxp_decoder_get_stats(rxp_decoder* decoder, rxp_decoder_stats* stats);                        /* fills stats with the read-ahead, decode thread and skip counters of the open file; call it on the thread that decodes */
+int64_t rxp_decoder_get_decoded_pts(rxp_decoder* decoder, rxp_stream* stream);                    /* returns the `decoded_pts` of the stream; safe to call while its decode thread is running */
+int rxp_decoder_reset(rxp_decoder* decoder);                                                       /* closes the source when it's open and frees the streams and codec state so you can open the next file; keeps the decode threads, tracks and settings */
 
 #endif
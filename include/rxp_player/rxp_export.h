@@ -0,0 +1,54 @@
+/*
+
+  rxp_export
+  ----------
+
+  Decodes all video frames of a file as fast as possible, for offline jobs like
+  exporting frames or analysing a file. We split the file into segments that
+  start at keyframes and decode the segments on a pool of threads; each thread
+  has its own rxp_decoder (and so its own th_dec_ctx) on the same file. The
+  frames are still delivered in pts order, on the calling thread:
+
+      static void on_frame(uint64_t pts, th_ycbcr_buffer buffer, void* user) {
+        write_png(pts, buffer);
+      }
+
+      if (rxp_export_frames("bunny.ogg", 0, on_frame, NULL) < 0) {
+        printf("Error: cannot export the frames.\n");
+      }
+
+  When the file has a seek index (a sidecar or an Ogg Skeleton index, see
+  rxp_index.h) we put the segment boundaries exactly on keyframes, so every
+  frame is decoded once. Without an index we split the duration into equal
+  parts and `rxp_decoder_seek()` bisects the file to the keyframe before each
+  boundary; each segment then also decodes the frames between that keyframe
+  and its start. Use `rxp_index_create()` first when you export a file more
+  than once. We make RXP_EXPORT_SEGMENTS_PER_THREAD segments per thread so a
+  thread that got an easy segment takes the next one.
+
+  Reorder buffer: each thread copies its frames into its own queue of
+  RXP_EXPORT_QUEUE_FRAMES frames. We call the callback with the frames of the
+  oldest segment while the other threads decode ahead; a thread waits when its
+  queue is full. So we use at most nthreads * RXP_EXPORT_QUEUE_FRAMES frames of
+  memory (e.g. 32 threads at 1080p: about 400MB). The planes that you get in
+  the callback are only valid during the call, the stride is the width of the
+  frame. We only decode the first theora stream and the first link of a chained
+  file; there is no audio. Duplicate frames are delivered as a copy of the
+  previous image with their own pts.
+
+ */
+#ifndef RXP_EXPORT_H
+#define RXP_EXPORT_H
+
+#include <stdint.h>
+#include <theora/theoradec.h>
+
+#define RXP_EXPORT_MAX_THREADS 64                                             /* the max. number of threads used by rxp_export_frames() */
+#define RXP_EXPORT_SEGMENTS_PER_THREAD 4                                      /* we split the file in this many segments per thread */
+#define RXP_EXPORT_QUEUE_FRAMES 4                                             /* the number of decoded frames each thread can keep before it has to wait */
+
+typedef void (*rxp_export_callback)(uint64_t pts, th_ycbcr_buffer buffer, void* user); /* is called for each frame in pts order; pts is the end time of the frame in ns, like the decoder uses */
+
+int rxp_export_frames(char* filepath, int nthreads, rxp_export_callback cb, void* user); /* decodes all frames on nthreads threads (<= 0: one per cpu) and calls cb with them in pts order on the calling thread; returns when all frames are delivered, < 0 on error */
+
+#endif
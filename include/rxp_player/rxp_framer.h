@@ -0,0 +1,58 @@
+/*
+
+  rxp_framer
+  ----------
+
+  Finds ogg pages in place in a memory backed source (an mmap'd file or the
+  memory source, see `rxp_io_get_data()`). libogg's sync layer copies every 
+  byte we read into its own buffer before it can find a page; the framer 
+  hands out ogg_page structs that point straight into the source data so the
+  only copy left is the one into the logical stream (ogg_stream_pagein). The
+  source data must stay valid while you use the pages.
+
+  We look for the "OggS" capture pattern with SSE2, AVX2 or NEON when the 
+  compiler targets them (e.g. build with -mavx2 or -march=native for AVX2) 
+  and with memchr() otherwise. Every candidate page is validated like libogg 
+  does: version, header and body size and the CRC checksum (slice-by-8). Bytes
+  that aren't part of a valid page are skipped.
+
+  The decoder uses the framer automatically for memory backed sources, the seek
+  index builder and the prober use it too.
+
+      rxp_framer framer;
+      ogg_page page;
+      int64_t offset;
+
+      rxp_framer_init(&framer);
+      rxp_framer_open(&framer, data, nbytes);
+
+      while (0 == rxp_framer_next(&framer, &page, &offset)) {
+        ... 
+      }
+
+ */
+#ifndef RXP_FRAMER_H
+#define RXP_FRAMER_H
+
+#include <stdint.h>
+#include <ogg/ogg.h>
+
+#define RXP_FRAMER_HEADER_SIZE 27                                             /* size of a page header w/o the segment table */
+
+typedef struct rxp_framer rxp_framer;
+
+struct rxp_framer {
+  const uint8_t* data;                                                        /* the source data, not owned by us */
+  uint64_t size;                                                              /* number of bytes in data */
+  uint64_t pos;                                                               /* the position after the last page we returned */
+  uint64_t nskipped;                                                          /* number of bytes that weren't part of a valid page, for diagnostics */
+  int is_init;                                                                /* 0xCAFEBABE when opened */
+};
+
+int rxp_framer_init(rxp_framer* framer);                                      /* set all members to defaults */
+int rxp_framer_open(rxp_framer* framer, const uint8_t* data, uint64_t nbytes); /* find pages in the given data, starting at 0 */
+int rxp_framer_seek(rxp_framer* framer, uint64_t pos);                        /* continue searching for pages at pos */
+int rxp_framer_next(rxp_framer* framer, ogg_page* page, int64_t* offset);     /* returns 0 and sets page (and offset when not NULL) to the next valid page, returns 1 when there are no more pages */
+const uint8_t* rxp_framer_find_capture(const uint8_t* data, const uint8_t* end); /* returns the first "OggS" in [data, end) or NULL */
+
+#endif
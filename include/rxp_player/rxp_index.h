@@ -0,0 +1,101 @@
+/*
+
+  rxp_index
+  ---------
+
+  A seek index with the keyframe byte offsets and granules for each stream in
+  an .ogg file. With an index, `rxp_decoder_seek()` doesn't need to bisect the
+  file anymore; we directly read from the offset of the keyframe before the
+  seek pts. The index also gives us the duration of the file when we open it.
+
+  Building an index means we have to read the complete file once, so we store
+  it in a sidecar file next to the .ogg file (`bunny.ogg.rxpidx`). The sidecar
+  contains the size and modification time of the .ogg file; when the .ogg file
+  changed we ignore it. `rxp_decoder_open_file()` loads the sidecar when it
+  exists. Use `rxp_index_create()` to build and store a sidecar, e.g.:
+
+      if (rxp_index_create("bunny.ogg") < 0) {
+        printf("Error: cannot create the index.\n");
+      }
+
+  Entries
+  -------
+
+  For theora we store an entry for each keyframe. The offset is the offset of
+  the last theora page before the keyframe (the keyframe packet may start on
+  that page), the granule is the granule of the keyframe and pts is the time
+  at which the keyframe is presented. For vorbis we store an entry about each
+  RXP_INDEX_AUDIO_INTERVAL nanoseconds, with the offset of the page and the
+  pts of the last sample on that page.
+
+  For a chained file we only store entries for the streams of the first link,
+  because the decoder can't seek into the next links. We still read the next
+  links to get the duration, which is the sum of the durations of the links.
+
+  The sidecar is a cache for the machine that created it, we store all values
+  in native byte order.
+
+  Ogg Skeleton
+  ------------
+
+  Files that are muxed with an Ogg Skeleton 4.0 track already contain a keyframe
+  index, so they don't need a sidecar. The decoder passes the skeleton packets to
+  `rxp_index_add_skeleton()` while reading the headers, which adds the keypoints 
+  of the theora and vorbis streams as entries. A keypoint offset is the offset of
+  the page on which the keyframe starts and we don't know its granule (-1). The
+  skeleton index is only used when the segment length in the fishead matches the
+  size of the file, and when we already have entries for a stream (e.g. from a 
+  sidecar) we keep those.
+
+ */
+#ifndef RXP_INDEX_H
+#define RXP_INDEX_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define RXP_INDEX_EXTENSION ".rxpidx"                                         /* the extension we append to the filepath of the .ogg for the sidecar */
+#define RXP_INDEX_VERSION 1                                                   /* version of the sidecar file format */
+#define RXP_INDEX_AUDIO_INTERVAL (1000ull * 1000ull * 1000ull)                 /* we store an audio entry about every second */
+
+typedef struct rxp_index_entry rxp_index_entry;
+typedef struct rxp_index_stream rxp_index_stream;
+typedef struct rxp_index rxp_index;
+
+struct rxp_index_entry {
+  int64_t offset;                                                             /* byte offset of the page from where we need to decode */
+  int64_t granule;                                                            /* theora: the granule of the keyframe, vorbis: the granule of the page */
+  uint64_t pts;                                                               /* theora: the time when the keyframe is presented, vorbis: the time of the last sample on the page, in nanoseconds */
+};
+
+struct rxp_index_stream {
+  int serial;                                                                 /* the serial of the logical stream */
+  int type;                                                                   /* RXP_THEORA or RXP_VORBIS */
+  uint32_t nentries;                                                          /* number of used entries */
+  uint32_t capacity;                                                          /* number of allocated entries */
+  rxp_index_entry* entries;                                                   /* the entries, ordered by offset */
+};
+
+struct rxp_index {
+  rxp_index_stream* streams;                                                  /* the indexed streams */
+  uint32_t nstreams;                                                          /* number of streams, 0 when there is no index */
+  uint64_t file_size;                                                         /* size of the .ogg file the index was created for */
+  int64_t mtime;                                                              /* modification time of the .ogg file the index was created for */
+  uint64_t duration;                                                          /* duration of the longest stream in nanoseconds, for a chained file the sum of the links */
+  int is_skeleton_valid;                                                      /* 1 when we parsed a skeleton 4.0 fishead that matches the file size */
+  int is_init;
+};
+
+int rxp_index_init(rxp_index* index);                                         /* set all members to defaults */
+int rxp_index_clear(rxp_index* index);                                        /* frees all entries and calls rxp_index_init() */
+int rxp_index_build(rxp_index* index, char* filepath);                        /* reads the complete file and creates the entries */
+int rxp_index_save(rxp_index* index, char* indexpath);                        /* writes the index to the given file */
+int rxp_index_load(rxp_index* index, char* indexpath, char* filepath);        /* loads the index and validates it against the size and modification time of filepath */
+int rxp_index_create(char* filepath);                                         /* builds the index for filepath and saves it as sidecar */
+int rxp_index_get_path(char* filepath, char* dest, size_t nbytes);            /* writes the path of the sidecar for filepath into dest */
+int rxp_index_add_stream(rxp_index* index, int serial, int type, rxp_index_stream** stream); /* adds a new stream or returns the existing one for the serial */
+int rxp_index_add_entry(rxp_index_stream* stream, int64_t offset, int64_t granule, uint64_t pts); /* append an entry, entries must be added in offset order */
+int rxp_index_find(rxp_index* index, uint64_t pts, int64_t* offset);          /* finds the offset from where we need to decode to present pts; returns < 0 when we don't have an index */
+int rxp_index_add_skeleton(rxp_index* index, const unsigned char* data, long nbytes, int64_t file_size); /* parses a skeleton fishead, fisbone or index packet; returns 1 when we added entries */
+
+#endif
@@ -0,0 +1,118 @@
+/*
+
+  rxp_io
+  ------
+
+  The decoder doesn't read files itself; it reads from an rxp_io source. An
+  rxp_io is a set of callbacks (read/seek/tell/size/close) and some state
+  that is used by the built-in sources. You can create your own source by
+  setting the callbacks and the `user` member, or use one of the built-in
+  sources:
+
+     rxp_io_open_file():     opens a file using one of the RXP_IO_{MMAP,READAHEAD,STDIO}
+                             modes. When the file cannot be memory mapped we fall back
+                             to RXP_IO_READAHEAD. The read-ahead thread is started on
+                             the first read, so you can pass the rxp_io by value to 
+                             the decoder or player; don't copy it after you've read from it.
+                             Every seek stops the thread and the next read restarts it;
+                             when you do many small seeks+reads (e.g. bisecting) call
+                             rxp_io_pause_readahead(io, 1) first so we read directly 
+                             from the file and only restart the thread once you resume.
+
+     rxp_io_open_file() with RXP_IO_STREAM:
+                             reads a file that is still being written, a FIFO or stdin
+                             (use "-" as path). Reads don't block: when there is no new
+                             data yet, read returns RXP_IO_AGAIN instead of 0 and the 
+                             decoder waits for more data. A FIFO ends when the writer
+                             closes it; a growing file ends when no new data arrived
+                             for `stream_timeout` nanoseconds. We keep waiting after
+                             the end of all streams, because the next link of a 
+                             chained stream may follow.
+
+     rxp_io_open_memory():   reads from a buffer that you already have in memory, e.g.
+                             a clip from an asset pack. We don't copy the buffer so it
+                             must stay valid until the source is closed.
+
+  Sources that have the complete stream in memory (RXP_IO_MMAP and the memory
+  source) can be read w/o copying: `rxp_io_get_data()` returns the data and the
+  reader calls `rxp_io_consume()` to tell the source how far it has read. The 
+  decoder uses this with the rxp_framer to find ogg pages in place.
+
+  callbacks
+  ---------
+
+     read:       read at most nbytes into dest. return the number of bytes read,
+                 0 at the end of the stream and < 0 on error. Streaming sources 
+                 return RXP_IO_AGAIN when there is no data yet; set `is_stream` 
+                 to 1 for those.
+     seek:       set the read position, whence is SEEK_SET, SEEK_CUR or SEEK_END.
+                 return 0 on success. May be NULL when the source cannot seek.
+     tell:       return the current read position or < 0 when unknown. May be NULL.
+     size:       return the size of the stream in bytes or < 0 when unknown. May be NULL.
+     close:      is called when the decoder is ready with the source. May be NULL.
+
+ */
+#ifndef RXP_IO_H
+#define RXP_IO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <rxp_player/rxp_mmap.h>
+#include <rxp_player/rxp_readahead.h>
+
+#define RXP_IO_AGAIN (-11)                                                                /* returned by the read callback of a stream when there is no new data yet */
+#define RXP_IO_STREAM_POLL_TIMEOUT 20                                                     /* RXP_IO_STREAM: the max. number of milliseconds one read waits for new data */
+#define RXP_IO_STREAM_DEFAULT_TIMEOUT (5 * 1000ull * 1000ull * 1000ull)                   /* RXP_IO_STREAM: when we didn't receive any data for this many nanoseconds, the stream has ended */
+
+typedef struct rxp_io rxp_io;
+
+typedef int (*rxp_io_read_callback)(rxp_io* io, void* dest, uint32_t nbytes);             /* read at most nbytes, returns the number of bytes read, 0 at the end and < 0 on error */
+typedef int (*rxp_io_seek_callback)(rxp_io* io, int64_t offset, int whence);              /* seek to the given position, returns 0 on success */
+typedef int64_t (*rxp_io_tell_callback)(rxp_io* io);                                      /* returns the current read position, < 0 when unknown */
+typedef int64_t (*rxp_io_size_callback)(rxp_io* io);                                      /* returns the size of the stream, < 0 when unknown */
+typedef int (*rxp_io_close_callback)(rxp_io* io);                                         /* is called when the source isn't used anymore */
+
+struct rxp_io {
+
+  /* callbacks */
+  void* user;                                                                             /* can be used by custom sources */
+  rxp_io_read_callback read;                                                              /* must be set */
+  rxp_io_seek_callback seek;                                                              /* optional */
+  rxp_io_tell_callback tell;                                                              /* optional */
+  rxp_io_size_callback size;                                                              /* optional */
+  rxp_io_close_callback close;                                                            /* optional */
+  int is_stream;                                                                          /* set to 1 when the read callback may return RXP_IO_AGAIN */
+
+  /* used by the built-in sources */
+  int mode;                                                                               /* the RXP_IO_* mode of the built-in file source, RXP_IO_MEMORY for the memory source */
+  FILE* fp;                                                                               /* RXP_IO_STDIO and RXP_IO_READAHEAD */
+  rxp_mmap map;                                                                           /* RXP_IO_MMAP */
+  rxp_readahead readahead;                                                                /* RXP_IO_READAHEAD, contains the wait statistics */
+  const uint8_t* mem;                                                                     /* RXP_IO_MEMORY, not owned by us */
+  uint64_t mem_size;                                                                      /* RXP_IO_MEMORY */
+  uint64_t pos;                                                                           /* RXP_IO_MEMORY and RXP_IO_READAHEAD, the read position */
+  uint64_t file_size;                                                                     /* RXP_IO_STDIO and RXP_IO_READAHEAD */
+  uint32_t readahead_size;                                                                /* RXP_IO_READAHEAD, the read-ahead window */
+  int is_readahead_paused;                                                                /* RXP_IO_READAHEAD, 1 when we read directly from the file w/o the reader thread, see rxp_io_pause_readahead() */
+  int fd;                                                                                 /* RXP_IO_STREAM, the non-blocking file descriptor */
+  int fd_flags;                                                                           /* RXP_IO_STREAM, the flags of stdin before we made it non-blocking; we restore them on close. -1 when not used */
+  int is_fifo;                                                                            /* RXP_IO_STREAM, 1 when we read from a pipe/FIFO, 0 for a growing file */
+  int got_data;                                                                           /* RXP_IO_STREAM, 1 when we received data; a FIFO w/o writer only ends after we got some data */
+  uint64_t stream_timeout;                                                                /* RXP_IO_STREAM, see RXP_IO_STREAM_DEFAULT_TIMEOUT; you can change it after opening */
+  uint64_t last_data_time;                                                                /* RXP_IO_STREAM, uv_hrtime() when we last received data */
+};
+
+int rxp_io_init(rxp_io* io);                                                              /* set all members to defaults, call this before setting your own callbacks. the rxp_io_open_*() functions call this for you */
+int rxp_io_open_file(rxp_io* io, char* filepath, int mode, uint32_t readahead_size);      /* open a file using the RXP_IO_{MMAP,READAHEAD,STDIO,STREAM} mode, readahead_size is only used for RXP_IO_READAHEAD */
+int rxp_io_open_memory(rxp_io* io, const void* data, uint64_t nbytes);                    /* read from memory w/o copying it; data must stay valid until the source is closed */
+int rxp_io_read(rxp_io* io, void* dest, uint32_t nbytes);                                 /* calls the read callback */
+int rxp_io_seek(rxp_io* io, int64_t offset, int whence);                                  /* calls the seek callback, returns < 0 when the source cannot seek */
+int64_t rxp_io_tell(rxp_io* io);                                                          /* calls the tell callback, returns < 0 when unknown */
+int64_t rxp_io_size(rxp_io* io);                                                          /* calls the size callback, returns < 0 when unknown */
+int rxp_io_close(rxp_io* io);                                                             /* calls the close callback and resets the source */
+int rxp_io_is_open(rxp_io* io);                                                           /* returns 0 when the source is opened, else < 0 */
+const uint8_t* rxp_io_get_data(rxp_io* io, uint64_t* nbytes);                             /* returns the complete stream when the source is memory backed (RXP_IO_MMAP, RXP_IO_MEMORY), else NULL */
+int rxp_io_pause_readahead(rxp_io* io, int paused);                                       /* RXP_IO_READAHEAD: 1 = stop the reader thread and read directly, 0 = restart it on the next read. Does nothing for other sources */
+int rxp_io_consume(rxp_io* io, uint64_t pos);                                             /* for memory backed sources: we've read from the data returned by rxp_io_get_data() up to pos */
+
+#endif
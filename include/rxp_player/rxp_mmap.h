@@ -0,0 +1,52 @@
+/*
+
+  rxp_mmap
+  --------
+
+  Read-only memory mapping of a file. The decoder uses this to feed the
+  ogg sync layer directly from the mapping instead of calling fread()
+  for every 4096 bytes. All reading goes through the page cache of the
+  kernel which is very nice when you loop the same (large) file over and
+  over again, like we do in installations.
+
+  We tell the kernel that we're reading the file sequentially and every
+  time the read position crosses the previous read-ahead mark we ask the
+  kernel to fetch the next `RXP_MMAP_WILLNEED_SIZE` bytes. Offsets and
+  sizes are 64 bit so files > 4GB work too (on 64 bit systems).
+
+  When the file cannot be mapped (e.g. a pipe, or a 32 bit process with a
+  huge file), `rxp_mmap_open()` returns < 0 and the user should fall back
+  to stdio.
+
+ */
+#ifndef RXP_MMAP_H
+#define RXP_MMAP_H
+
+#include <stdint.h>
+
+#define RXP_MMAP_WILLNEED_SIZE (8 * 1024 * 1024)                            /* how many bytes we ask the kernel to read ahead of the current read position */
+
+typedef struct rxp_mmap rxp_mmap;
+
+struct rxp_mmap {
+  uint8_t* data;                                                            /* the mapped file */
+  uint64_t size;                                                            /* size of the mapped file */
+  uint64_t pos;                                                             /* current read position */
+  uint64_t advised;                                                         /* up to this position we've asked the kernel to prefetch the file */
+#if defined(_WIN32)
+  void* file;                                                               /* HANDLE of the file */
+  void* mapping;                                                            /* HANDLE of the file mapping */
+#else
+  int fd;                                                                   /* file descriptor of the mapped file */
+#endif
+  int is_init;                                                              /* 0xCAFEBABE when the file is mapped */
+};
+
+int rxp_mmap_init(rxp_mmap* map);                                           /* set all members to defaults */
+int rxp_mmap_open(rxp_mmap* map, char* filepath);                           /* map the given file, returns < 0 when the file cannot be mapped */
+int rxp_mmap_close(rxp_mmap* map);                                          /* unmap the file and reset the members */
+int rxp_mmap_read(rxp_mmap* map, void* dest, uint32_t nbytes);              /* copy at most nbytes from the current position into dest, returns the number of bytes copied, 0 at the end of the file */
+int rxp_mmap_seek(rxp_mmap* map, uint64_t pos);                             /* set the read position, returns < 0 when pos is beyond the end of the file */
+int rxp_mmap_consume(rxp_mmap* map, uint64_t pos);                          /* we've read directly from `data` up to pos (see rxp_framer); moves the read position forward and keeps prefetching w/o copying */
+
+#endif
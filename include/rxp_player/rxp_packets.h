@@ -6,6 +6,25 @@
   rxp_packets is used to store and retrieve video packets that the 
   decoder produces. See rxp_player.c where we use this struct. 
 
+  The packets are reused; when you reuse a free packet, call 
+  `rxp_packet_queue_requeue()` so the packets stay in the order of their pts.
+  A packet with the RXP_REPEAT_FRAME type has no image; it tells you that the
+  previous frame is still valid until `repeat_pts`.
+
+  `pix_fmt` is the layout of the planes: RXP_YUV420P (half width and height 
+  chroma), RXP_YUV422P (half width chroma) or RXP_YUV444P. The planes start 
+  at 16 byte aligned addresses.
+
+  Theora frames are a multiple of 16 pixels, the visible picture is a part of
+  it. `pic_x`, `pic_y`, `pic_width` and `pic_height` of each rxp_img give the 
+  visible part of that plane, e.g. to upload a plane use:
+
+       data + pic_y * stride + pic_x, pic_width x pic_height
+
+  When the player crops the frames (see `crop` in rxp_player.h) the planes
+  only contain the picture, tightly packed (stride == width) and the picture
+  starts at 0, 0.
+
 
  */
 
@@ -24,16 +43,23 @@ struct rxp_img {
   uint16_t width;
   uint16_t height;
   uint16_t stride;
+  uint16_t pic_x;                                                        /* the first column of the visible picture in this plane */
+  uint16_t pic_y;                                                        /* the first row of the visible picture in this plane */
+  uint16_t pic_width;                                                    /* the number of visible columns */
+  uint16_t pic_height;                                                   /* the number of visible rows */
   uint8_t* data;
 };
 
 /* Packet used to store video frames */
 struct rxp_packet {
-  uint8_t* data;
-  int size;
+  uint8_t* data;                                                         /* the allocated memory, the planes start at the first aligned address (img[0].data) */
+  int size;                                                              /* number of bytes used by the planes */
+  int capacity;                                                          /* number of allocated bytes in data; the frame size can change in a chained file */
   int type;
+  int pix_fmt;                                                           /* RXP_YUV420P, RXP_YUV422P or RXP_YUV444P; for RXP_REPEAT_FRAME the layout of the repeated frame */
   int is_free;
   uint64_t pts;
+  uint64_t repeat_pts;                                                   /* RXP_REPEAT_FRAME: the previous frame is shown until this pts, consecutive duplicates only move this forward */
   rxp_img img[3];                                                        /* is used for video frames */
   rxp_packet* next;
   rxp_packet* prev;
@@ -61,6 +87,7 @@ int rxp_packet_queue_init(rxp_packet_queue* queue);                      /* init
 int rxp_packet_queue_add(rxp_packet_queue* q, rxp_packet* pkt);          /* append a packet to the queue */
 int rxp_packet_queue_remove(rxp_packet_queue* q, rxp_packet* pkt);       /* remove a packet from the queue */
 rxp_packet* rxp_packet_queue_find_free_packet(rxp_packet_queue* q);      /* find a free packet in the queue */
+int rxp_packet_queue_requeue(rxp_packet_queue* q, rxp_packet* pkt);      /* move a (reused) packet to the end of the queue, so the queue stays ordered on pts */
 void rxp_packet_queue_lock(rxp_packet_queue* q);                         /* lock when you want to iterate over the list */
 void rxp_packet_queue_unlock(rxp_packet_queue* q);                       /* unlock when you're ready itetration */
 
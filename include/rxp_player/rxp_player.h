@@ -30,6 +30,86 @@
             must be big enough to whole the `nsamples` for all the channels that the 
             audio stream contains.
 
+   streaming:
+
+            When you open a stream (set `decoder.io_mode` to RXP_IO_STREAM before calling
+            `rxp_player_open()`, or pass a source with `is_stream` set to 
+            `rxp_player_open_io()`) we keep a jitter buffer. The scheduler never decodes 
+            more than `jitter_max` nanoseconds ahead of the played pts, which bounds the 
+            latency. When we run out of decoded data we set RXP_PSTATE_BUFFERING, halt
+            the clock, output silence and fire RXP_PLAYER_EVENT_BUFFERING. Once we have
+            `jitter_min` nanoseconds of data (or the stream ended) we continue and fire 
+            RXP_PLAYER_EVENT_BUFFERED. Set both values before opening the stream.
+
+   rxp_player_enable_streams():
+
+            By default we play both the video and audio. When you disable the audio
+            we don't decode it, never fire RXP_DEC_EVENT_AUDIO_INFO and use the CPU 
+            clock, so you don't need an audio callback. When you disable the video 
+            we only decode the audio, which drives the clock as usual.
+
+   on_video_frame():
+
+            Is called with each frame that should be shown. When the decoder finds
+            a duplicate frame (the image didn't change) you get a packet with the
+            RXP_REPEAT_FRAME type instead, without an image; keep showing the previous
+            frame until `repeat_pts`, you don't need to upload anything.
+
+   copy_mode:
+
+            Each decoded frame is copied into a packet. By default we do this after
+            the frame has been decoded completely, when most of it isn't in the cache
+            anymore. With RXP_COPY_STRIPES we copy the rows while libtheora decodes 
+            the frame, as soon as a stripe is ready. RXP_COPY_STRIPES_NT uses 
+            non-temporal stores for the copy (when SSE2 is available) so the packets,
+            which are only read when they're shown, don't push the decoder data out 
+            of the cache. This mostly matters for 1080p and bigger.
+
+            The copy kernels are selected once for each video stream, when the 
+            decoder fires RXP_DEC_EVENT_VIDEO_INFO, from the copy mode and the width
+            and alignment of the planes. The packets have the chroma layout of the stream, see 
+            `pix_fmt` of the player and the packets; we don't convert 4:2:2 or 4:4:4
+            to 4:2:0.
+
+   crop:
+
+            Theora frames are padded to a multiple of 16 pixels. By default we copy
+            the complete frame and `pic_x`, `pic_y`, `pic_width` and `pic_height` of
+            the rxp_img planes tell you which part is visible. Set `crop` to 1 before
+            opening a file to only copy the visible picture into tightly packed 
+            planes; this copies less data and you can upload the planes directly.
+
+   adaptive quality:
+
+            When the host can't keep up, we lower the theora post-processing level
+            and don't decode frames that are too late to be shown anymore (until the
+            next keyframe). The quality is raised again when we're on time. Set 
+            `adaptive_quality` to 0 to disable this. `decoder.nframes_skipped` counts
+            the frames we didn't decode, `nframes_missed` the decoded frames we never
+            showed.
+
+   decode threads:
+
+            The scheduler thread only reads the pages; the theora and vorbis (or opus)
+            packets are decoded on their own threads, see `use_threads` of the decoder.
+            A slow video frame doesn't hold up the audio anymore and high bitrate 
+            content uses more than one core. Set `decoder.use_threads` to 0 before
+            opening a file to decode everything on the scheduler thread.
+
+   rxp_player_reopen():
+
+            To switch to another clip you don't have to clear() and init() the player.
+            `rxp_player_reopen()` stops the playback directly and lets the scheduler 
+            thread close the current file, reset the codecs and open the new file. 
+            The scheduler thread, the decode threads, the video packets and the 
+            audio buffer are reused, so nothing is allocated when the next clip has
+            the same format. You can call it while playing, while paused or when
+            the previous file ended (e.g. on RXP_PLAYER_EVENT_RESET; then we start the
+            scheduler thread again). Like after `rxp_player_open()` we fire 
+            RXP_DEC_EVENT_AUDIO_INFO and RXP_DEC_EVENT_VIDEO_INFO for the new file and
+            you call `rxp_player_play()` to start it. The selected tracks, enabled
+            streams and the other settings are kept.
+
    rxp_player_event_callback():
  
             The event callback can be set, so the user is notified on certain events that
@@ -37,6 +117,14 @@
             the samplerate/number of channels, we will fire an event so you can start an 
             output audio stream for your OS. Note that the event callback can be triggered
             from another thread, so ALWAYS LOCK THE PLAYER when you access it's members.
+
+            The audio of the next link of a chained file is decoded ahead, while we
+            still play the previous link. When its samplerate or number of channels 
+            differs, we queue the new format in the audio buffer and only switch when
+            the playback reaches it: `rxp_player_fill_audio_buffer()` gives you 
+            silence from there until `rxp_player_update()` switched the clock and 
+            `samplerate`/`nchannels`, and fired RXP_PLAYER_EVENT_AUDIO_FORMAT. 
+            Restart your output audio stream with the new format on that event.
        
 
  */
@@ -50,10 +138,24 @@
 #include <rxp_player/rxp_scheduler.h>
 #include <rxp_player/rxp_clock.h>
 
+#define RXP_PLAYER_JITTER_MIN (500 * 1000ull * 1000ull)                              /* default `jitter_min`, we need this many nanoseconds of decoded data before we (re)start playing a stream */
+#define RXP_PLAYER_JITTER_MAX (2 * 1000ull * 1000ull * 1000ull)                       /* default `jitter_max`, we never decode more than this many nanoseconds ahead when playing a stream */
+#define RXP_PLAYER_AUDIO_TMP 4096                                                     /* the number of samples in `audio_tmp`, we interleave decoded vorbis audio into it */
+#define RXP_PLAYER_AUDIO_FORMATS 8                                                    /* the max. number of audio formats (links of a chained file) that can be queued in the audio buffer */
+#define RXP_PLAYER_AUDIO_BUFFER_SIZE (1024 * 1024 * 5)                                /* the size of the audio ringbuffer in bytes */
+
 typedef struct rxp_player rxp_player;
+typedef struct rxp_player_audio_format rxp_player_audio_format;
 
 typedef void(*rxp_player_video_frame_callback)(rxp_player* player, rxp_packet* pkt);       /* is called when we you should draw a new video frame. */
 typedef void(*rxp_player_event_callback)(rxp_player* player, int event);                   /* is called on certain events, e.g. when we detected an audio stream and the samplerate + number of channels is set, can be used to setup an audio stream for example */
+typedef void(*rxp_player_copy_kernel)(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int nbytes, int nrows); /* copies nrows rows of nbytes from a decoded plane into a packet */
+
+struct rxp_player_audio_format {
+  uint64_t offset;                                                                         /* the number of bytes written into the audio buffer before the first sample of this format */
+  uint64_t samplerate;                                                                     /* the samplerate from offset on */
+  int nchannels;                                                                           /* the number of channels from offset on */
+};
 
 struct rxp_player {
 
@@ -65,10 +167,32 @@ struct rxp_player {
                                                                                       
   uv_mutex_t mutex;                                                                        /* mutex that is used to protect the player state */
   uint64_t last_used_pts;                                                                  /* the last used pts for the video packets, this is used to make sure we get the correct "next" video packet (= with higher pts then last_used_pts) */
-  uint64_t samplerate;                                                                     /* the samplerate of the audio stream if found */
+  uint64_t samplerate;                                                                     /* the samplerate of the audio stream if found; of the link we're playing for chained files */
   uint64_t total_audio_frames;                                                             /* the total number of audio frames that we received from the decoder. we used this to tell the scheduler up till which pts we have decoded */
-  int nchannels;                                                                           /* the number of audio channels of the audio stream when found */
+  int nchannels;                                                                           /* the number of audio channels of the audio stream when found; of the link we're playing for chained files */
+  uint64_t write_samplerate;                                                               /* the samplerate of the audio the decoder writes into the audio buffer; differs from `samplerate` while we play the end of the previous link of a chained file */
+  int write_nchannels;                                                                     /* the number of channels of the audio the decoder writes into the audio buffer */
+  rxp_player_audio_format audio_formats[RXP_PLAYER_AUDIO_FORMATS];                         /* the audio formats that start somewhere in the audio buffer, oldest first */
+  int naudio_formats;                                                                      /* the number of queued audio formats */
+  uint64_t audio_nwritten;                                                                 /* the number of bytes we wrote into the audio buffer since it was emptied */
+  uint64_t audio_nread;                                                                    /* the number of bytes we read from the audio buffer since it was emptied */
+  int is_stream;                                                                           /* 1 when we're playing a stream (pipe, FIFO, growing file) and use the jitter buffer */
+  uint64_t jitter_min;                                                                     /* streams: the amount of decoded data in nanoseconds we need before we start playing or continue after buffering */
+  uint64_t jitter_max;                                                                     /* streams: the max. amount of data in nanoseconds we decode ahead; bounds the latency */
   int state;                                                                               /* the player state */
+  int copy_mode;                                                                           /* how we copy decoded video frames into the packets: RXP_COPY_FRAME (default), RXP_COPY_STRIPES or RXP_COPY_STRIPES_NT; set before opening a file */
+  rxp_packet* stripe_pkt;                                                                  /* RXP_COPY_STRIPES: the packet into which we copy the stripes of the frame that is being decoded */
+  int pix_fmt;                                                                             /* RXP_YUV420P (default), RXP_YUV422P or RXP_YUV444P; the chroma layout of the video stream, set on RXP_DEC_EVENT_VIDEO_INFO */
+  rxp_player_copy_kernel copy_plane[3];                                                    /* the kernels that copy the Y, U and V planes, selected on RXP_DEC_EVENT_VIDEO_INFO */
+  int crop;                                                                                /* 1 we only copy the visible picture of the frames into tightly packed planes, 0 (default) we copy the complete frames; set before opening a file */
+  rxp_img planes[3];                                                                       /* the layout of the planes in the packets (w/o data), set on RXP_DEC_EVENT_VIDEO_INFO */
+  int plane_x[3];                                                                          /* the first column of each decoded plane that we copy */
+  int plane_y[3];                                                                          /* the first row of each decoded plane that we copy */
+  int plane_bytes;                                                                         /* the number of bytes we need for the planes of a packet */
+  int adaptive_quality;                                                                    /* 1 (default) we lower the video quality and skip frames when decoding can't keep up with the clock, 0 we decode everything at the best quality */
+  uint64_t nframes_missed;                                                                 /* number of decoded video frames that we never showed because they were too late; see `decoder.nframes_skipped` for frames we didn't decode */
+  int nreopen;                                                                             /* the number of reopen tasks that the scheduler didn't handle yet; meanwhile we ignore the end of the previous file */
+  float audio_tmp[RXP_PLAYER_AUDIO_TMP];                                                   /* is used on the audio decode thread to interleave the decoded vorbis audio */
   int must_stop;                                                                           /* this is set to 1 in the rxp_player_fill_audio_buffer() when there is no audio left to play back and we should stop playing. We cannot simply dealloc/clear/reset everything in the audio callback becuase that function is not allowed to take too much time */
   int is_init;                                                                            /* 1 = yes, -1 = no */ 
 
@@ -81,8 +205,14 @@ struct rxp_player {
 int rxp_player_init(rxp_player* player);                                                   /* initialize all of the members */
 int rxp_player_clear(rxp_player* player);                                                  /* frees all allocated memory and resets state to what it was before init() */
 int rxp_player_open(rxp_player* player, char* file);                                       /* open a .ogg file */
+int rxp_player_open_io(rxp_player* player, rxp_io* io);                                    /* open a .ogg stream from the given source, e.g. one created with rxp_io_open_memory(). the rxp_io is copied. */
+int rxp_player_reopen(rxp_player* player, char* file);                                     /* replace the current file (playing, paused or ended) with the given one, w/o clear() and init(); call rxp_player_play() again to start playing it */
+int rxp_player_reopen_io(rxp_player* player, rxp_io* io);                                  /* same as rxp_player_reopen() for a source, the rxp_io is copied */
+int rxp_player_select_track(rxp_player* player, int type, int track);                      /* select the RXP_THEORA or RXP_VORBIS track (0 = the first one) to play when the file contains several, call this before rxp_player_open() */
+int rxp_player_enable_streams(rxp_player* player, int mask);                               /* only play RXP_DEC_STREAM_VIDEO and/or RXP_DEC_STREAM_AUDIO, the others aren't decoded; call this before rxp_player_open() */
 int rxp_player_play(rxp_player* player);                                                   /* start playing. returns 0 on success. it's important to know that this will add a play task to the scheduler which will fire the play event only when it has decoded a couple of frames, so the playback will be smooth */
 int rxp_player_pause(rxp_player* player);                                                  /* pause the player, returns < 0 on error, 0 on success, 1 when not playing */
+int rxp_player_seek(rxp_player* player, uint64_t pts);                                     /* jump to the given pts in nanoseconds. the seek is handled by the scheduler thread, after which we present the frame and audio sample at pts. only works for seekable sources while the file is open */
 int rxp_player_stop(rxp_player* player);                                                   /* stop playing, also stops the scheduler; basically resets all state to default, calling the appropriate callbacks and events. */
 int rxp_player_lock(rxp_player* player);                                                   /* whenever you need to use any of the internal members make sure to lock/unlock the player. */
 int rxp_player_unlock(rxp_player* player);                                                 /* unlock the player. */
@@ -0,0 +1,96 @@
+/*
+
+  rxp_probe
+  ---------
+
+  Retrieves the video and audio info and the duration of a file without 
+  decoding anything and without starting the player or scheduler. This is 
+  what you want when you need the info for a lot of files, e.g. for a media 
+  library.
+
+  We only read the BOS pages at the start of the file; they contain the 
+  identification headers of all streams which we parse with th_decode_headerin()
+  and vorbis_synthesis_headerin(). Then we read the last pages of the file and 
+  convert their granulepos into the end time of the streams. We start with the 
+  last RXP_PROBE_TAIL_SIZE bytes and read more when we didn't find a page with 
+  a granulepos (e.g. a file with a huge last video frame). Sources that cannot 
+  seek or have no size (streams) get a duration of 0.
+
+  Chained files (e.g. a radio recording) contain several links after each other,
+  each with its own streams and serials. The info is from the first link and we
+  can't get the total duration w/o reading the whole file: when one of the last
+  pages belongs to a stream that isn't in the first link we stop, set 
+  `is_chained` to 1 and report a duration of 0.
+
+      rxp_probe_info info;
+
+      if (rxp_probe("bunny.ogg", &info) < 0) {
+        printf("Error: cannot probe the file.\n");
+      }
+  
+      printf("%d x %d, %llu ns\n", info.width, info.height, info.duration);
+
+  Batch probing
+  -------------
+
+  `rxp_probe_files()` probes a list of files on a bounded pool of threads. The
+  callback is called for each file as soon as it's probed (so not in the order
+  of the list), but never from two threads at the same time, so you can write
+  the results w/o locking. `rxp_probe_to_json()` converts a result into one line
+  of JSON; the `rxp_probe` example uses this to scan directories.
+
+ */
+#ifndef RXP_PROBE_H
+#define RXP_PROBE_H
+
+#include <stdint.h>
+#include <uv.h>
+#include <rxp_player/rxp_io.h>
+
+#define RXP_PROBE_TAIL_SIZE (64 * 1024)                                       /* we start by reading this many bytes from the end to find the duration */
+#define RXP_PROBE_MAX_TAIL_SIZE (8 * 1024 * 1024)                             /* we never read more than this from the end */
+#define RXP_PROBE_CHUNK_SIZE 4096                                             /* number of bytes per read from sources that aren't memory backed */
+#define RXP_PROBE_MAX_STREAMS 32                                              /* the max. number of streams we keep track of */
+#define RXP_PROBE_MAX_THREADS 64                                              /* the max. number of threads used by rxp_probe_files() */
+
+typedef struct rxp_probe_info rxp_probe_info;
+typedef struct rxp_probe_result rxp_probe_result;
+
+typedef void (*rxp_probe_callback)(rxp_probe_result* result, void* user);     /* is called by rxp_probe_files() for each file */
+
+struct rxp_probe_info {
+
+  /* video, from the first theora stream */
+  int has_video;                                                              /* 1 when the file has a theora stream */
+  int width;                                                                  /* the visible width (pic_width) */
+  int height;                                                                 /* the visible height (pic_height) */
+  int frame_width;                                                            /* the width of the decoded frames, a multiple of 16 */
+  int frame_height;                                                           /* the height of the decoded frames, a multiple of 16 */
+  uint32_t fps_numerator;                                                     /* the frame rate is fps_numerator / fps_denominator */
+  uint32_t fps_denominator;                                                
+  int pix_fmt;                                                                /* RXP_YUV420P, RXP_YUV422P or RXP_YUV444P */
+
+  /* audio, from the first vorbis stream */
+  int has_audio;                                                              /* 1 when the file has a vorbis stream */
+  uint64_t samplerate;                                                        /* samples per second */
+  int nchannels;                                                              /* number of audio channels */
+
+  /* general */
+  uint64_t duration;                                                          /* the end time of the longest stream in nanoseconds, 0 when unknown */
+  int is_chained;                                                             /* 1 when the file has more than one link; the info is from the first link and the duration is unknown (0) */
+  int64_t file_size;                                                          /* size of the file in bytes, < 0 when unknown */
+};
+
+struct rxp_probe_result {
+  char* filepath;                                                             /* the file that we probed */
+  int status;                                                                 /* the return value of rxp_probe(), 0 on success */
+  rxp_probe_info info;                                                        /* the info, only valid when status is 0 */
+  uint64_t time;                                                              /* the time it took to probe the file in nanoseconds */
+};
+
+int rxp_probe(char* filepath, rxp_probe_info* info);                          /* probe the given file, returns 0 on success, < 0 on error or when the file has no theora or vorbis stream */
+int rxp_probe_io(rxp_io* io, rxp_probe_info* info);                           /* probe the given source; we don't close it and leave the read position at an undefined place */
+int rxp_probe_files(char** filepaths, int nfiles, int nthreads, rxp_probe_callback cb, void* user); /* probes the files on nthreads threads (<= 0: one per cpu) and returns when all files are probed */
+int rxp_probe_to_json(rxp_probe_result* result, char* dest, size_t nbytes);   /* writes the result as one line of JSON (w/o newline) into dest, returns < 0 when dest is too small */
+
+#endif
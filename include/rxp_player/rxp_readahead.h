@@ -0,0 +1,56 @@
+/*
+
+  rxp_readahead
+  -------------
+
+  Reads a file in a separate thread and keeps the next `capacity` bytes of
+  compressed data in memory. The decoder reads from this buffer instead of
+  calling fread() on the scheduler thread, so a cold cache or a slow disk
+  doesn't stall the decoding of theora/vorbis anymore.
+
+  The reader thread is the only one writing into the buffer and the decoder
+  is the only one reading from it; the mutex only protects the positions.
+  When the buffer is empty the decoder has to wait for the reader thread. We
+  count how often this happens and how long we waited (`nwaits`, `wait_time`)
+  so you can tune the window size; `rxp_readahead_get_stats()` reads them 
+  while the thread is running.
+
+ */
+#ifndef RXP_READAHEAD_H
+#define RXP_READAHEAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <uv.h>
+
+#define RXP_READAHEAD_DEFAULT_SIZE (4 * 1024 * 1024)                        /* default window */
+#define RXP_READAHEAD_CHUNK_SIZE (64 * 1024)                                /* the reader thread reads at most this many bytes per fread() */
+
+typedef struct rxp_readahead rxp_readahead;
+
+struct rxp_readahead {
+  FILE* fp;                                                                 /* the file we read from, is not owned by us */
+  uint8_t* buffer;                                                          /* the buffer with read-ahead data */
+  uint32_t capacity;                                                        /* size of buffer, the read-ahead window */
+  uint32_t head;                                                            /* write position of the reader thread */
+  uint32_t tail;                                                            /* read position of the decoder */
+  uint32_t nbytes;                                                          /* number of bytes in the buffer that haven't been read */
+  int eof;                                                                  /* set to 1 by the reader thread when it reached the end of the file */
+  int error;                                                                /* set to 1 by the reader thread when fread() failed; the data before it can still be read */
+  int must_stop;                                                            /* set to 1 when the reader thread must stop */
+  uv_thread_t thread;                                                       /* the reader thread */
+  uv_mutex_t mutex;                                                         /* protects the positions and flags */
+  uv_cond_t cond;                                                           /* is signalled whenever data is added or removed */
+  uint64_t nreads;                                                          /* statistics: number of fread() calls */
+  uint64_t nwaits;                                                          /* statistics: how often the decoder had to wait for data */
+  uint64_t wait_time;                                                       /* statistics: total time in nanoseconds that the decoder waited for data */
+  int is_init;                                                              /* 0xCAFEBABE when the thread is running */
+};
+
+int rxp_readahead_init(rxp_readahead* ra);                                  /* set all members to defaults */
+int rxp_readahead_start(rxp_readahead* ra, FILE* fp, uint32_t nbytes);      /* allocate a window of nbytes and start reading fp in a separate thread */
+int rxp_readahead_stop(rxp_readahead* ra);                                  /* stops and joins the reader thread, frees the buffer. does not close the file */
+int rxp_readahead_read(rxp_readahead* ra, void* dest, uint32_t nbytes);     /* read at most nbytes, blocks when there is no data yet. returns the number of bytes read, 0 at the end of the file, < 0 when reading the file failed */
+int rxp_readahead_get_stats(rxp_readahead* ra, uint64_t* nreads, uint64_t* nwaits, uint64_t* wait_time); /* copies the statistics, can be called from any thread */
+
+#endif
@@ -0,0 +1,43 @@
+/*
+
+  rxp_remux
+  ---------
+
+  Copies a time range of an .ogg file into a new file without decoding or
+  encoding anything; e.g. to cut short loops out of long master files. We read
+  the compressed packets with `rxp_decoder_demux()` and write them into new
+  logical streams with the same serials, so the pages get new sequence numbers
+  and checksums. This runs at the speed of the disk.
+
+      if (rxp_remux_trim("master.ogg", "loop.ogg", 10 * 1000000000ull, 25 * 1000000000ull) < 0) {
+        printf("Error: cannot cut the loop.\n");
+      }
+
+  A theora stream can only start at a keyframe, so the copy starts at the last
+  keyframe at or before `start`. We find it by seeking to `start` (using the
+  seek index when there is one, see rxp_index.h) and reading up to `start`;
+  then we go back to the offset of that seek with `rxp_decoder_seek_offset()`,
+  so we don't search it twice, and copy from that keyframe. The granulepos of all packets
+  is rewritten so the first frame of the copy is frame 0. Audio starts with the
+  first packet that ends at or after the keyframe, so it may start up to one
+  packet (a couple of ms) later. The video stops before the first frame that
+  starts at `end`; the granulepos of the last audio packet is set to `end`,
+  which tells the decoder to drop the samples after it.
+
+  We copy the video and audio track that the decoder selects by default (the
+  first theora and the first vorbis or opus stream). Other streams, including
+  an Ogg Skeleton track, are dropped because their timing or index doesn't 
+  match the copy anymore.
+
+  Only the first link of a chained input is copied: the copy ends at the end 
+  of the first link, also when `end` is 0 or later than the end of that link.
+
+ */
+#ifndef RXP_REMUX_H
+#define RXP_REMUX_H
+
+#include <stdint.h>
+
+int rxp_remux_trim(char* srcpath, char* dstpath, uint64_t start, uint64_t end); /* copies the video and audio of [start, end) in nanoseconds from srcpath into dstpath; when end is 0 we copy until the end of the file */
+
+#endif
@@ -19,7 +19,8 @@
   up to one second extra. When the current playback time is 1 second and we 
   the goal pts is 2 seconds, the decoder will be called until we have reached our 
   goal pts. The goal pts is a running value which means it's updated every time 
-  you call rxp_scheduler_update().
+  you call rxp_scheduler_update(). How far we decode ahead of the played pts 
+  is set by `decode_ahead`; when playing a stream this bounds the latency.
 
   The scheduler needs to know when to stop decoding and if it needs to add more
   decoding tasks. For this we use a 'decoded_pts' which represents the pts up
@@ -34,6 +35,18 @@
   etc.. are tasks that get pushed to the internal task queue and read/handled in 
   the thread. 
 
+  A seek task calls the seek callback from the thread and then resets the decoded,
+  played and goal pts to the seek pts so we start pre-buffering from there. When
+  the user seeks faster than we can handle (e.g. scrubbing) we only handle the 
+  last seek task that we find in the queue.
+
+  A reopen task replaces the file that we're decoding w/o stopping the thread:
+  we call the reopen_file callback and then pre-buffer the new file from 0, 
+  like after a seek. Decode and seek tasks that were queued before it are 
+  skipped because they belong to the previous file. `rxp_scheduler_start()` can
+  be called again after `rxp_scheduler_stop()` and does nothing when the thread
+  is already running.
+
   An important task is the play task. When you want to play a file we first decode
   a couple of frames so we have enough data that can be send to the screen/soundcard.
   Only when we've decoded enough frames we will call the set play callback function. 
@@ -55,19 +68,25 @@
 #define RXP_SCHEDULER_H
 
 #include <rxp_player/rxp_tasks.h>
+#include <rxp_player/rxp_io.h>
 #include <uv.h>
 
+#define RXP_SCHED_DECODE_AHEAD (10 * 1000ull * 1000ull * 1000ull)                      /* default value for `decode_ahead` */
+#define RXP_SCHED_PREBUFFER (3 * 1000ull * 1000ull * 1000ull)                          /* when opening a file we decode this many nanoseconds, or `decode_ahead` when it's smaller */
+
 typedef struct rxp_scheduler rxp_scheduler;
 
 typedef int(*rxp_scheduler_callback)(rxp_scheduler* s);                               /* generic callback */
 typedef int(*rxp_scheduler_decode_callback)(rxp_scheduler* s, uint64_t goalpts);      /* gets called when you need to decode a new frame (audio or video). must return 0 on success and < 0 on error or when end of file has been reached. you need to decode all streams up to the given goal-pts*/
-typedef int(*rxp_scheduler_open_file_callback)(rxp_scheduler* s, char* file);         /* gets called when you need to open the given file */
+typedef int(*rxp_scheduler_seek_callback)(rxp_scheduler* s, uint64_t pts);           /* gets called when you need to seek the decoder to the given pts, return < 0 on error */
+typedef int(*rxp_scheduler_open_file_callback)(rxp_scheduler* s, char* file, rxp_io* io); /* gets called when you need to open the given file or source; only one of them is set */
 
 struct rxp_scheduler {
   rxp_task_queue tasks;                                                               /* the tasks that we need to handle in the thread */
   uint64_t goal_pts;                                                                  /* we will need to decode until we reached this pts */
   uint64_t decoded_pts;                                                               /* we've decoded up to this pts, see rxp_scheduler_update_decode_pts() */
   uint64_t played_pts;                                                                /* the highest value of the pts that we played (e.g. sent to the audio card or the last video frame) */
+  uint64_t decode_ahead;                                                              /* we decode up to played_pts + decode_ahead nanoseconds, defaults to RXP_SCHED_DECODE_AHEAD. set this before opening a file */
   int state;                                                                          /* we need to keep state because we don't want to add extra decoding tasks when we're already decoding */
   uv_mutex_t mutex;                                                                   /* mutex to protect the data of the scheduler */
   uv_thread_t thread;                                                                 /* handle to the thread in which we decode */
@@ -77,8 +96,10 @@ struct rxp_scheduler {
   void* user;                                                                         /* custom user data */
   rxp_scheduler_decode_callback decode;                                               /* is called when the user needs to decode one more video/audio frame, in the callback, make sure that you call `rxp_scheduler_update_decode_pts` so the scheduler knows how far decoding is */
   rxp_scheduler_open_file_callback open_file;                                         /* will be called from the thread when we're ready to open the file. */
+  rxp_scheduler_open_file_callback reopen_file;                                       /* will be called from the thread when we need to replace the current file with the given one; close the current file and open the new one */
   rxp_scheduler_callback close_file;                                                  /* will be called from the thread when the file needs to be closed. normally this should be done when we're ready decoding all data. */
   rxp_scheduler_callback stop;                                                        /* is called when the thread stops */
+  rxp_scheduler_seek_callback seek;                                                   /* is called from the thread when we need to seek; after it returns we decode from the new pts */
   rxp_scheduler_callback play;                                                        /* is called when we're ready with 'pre-buffering' some frames and we start playing. this is a good place to start your audio stream in case the .ogg file has audio */
 };
 
@@ -87,12 +108,17 @@ int rxp_scheduler_reset(rxp_scheduler* s); /* only call once, before init; sets
 void rxp_scheduler_update(rxp_scheduler* s);                                          /* call this often, this will add new decode tasks when necessary */
 int rxp_scheduler_init(rxp_scheduler* s);                                             /* init all members of the scheduler, call this if you created a scheduler on the stack. */
 int rxp_scheduler_clear(rxp_scheduler* s);                                            /* clear all allocated memory and reset the state. if you want to reuse the scheduler again, make sure to call `rxp_scheduler_init` again. */
-int rxp_scheduler_start(rxp_scheduler* s);                                            /* starts the scheduler thread */
+int rxp_scheduler_start(rxp_scheduler* s);                                            /* starts the scheduler thread, also after `rxp_scheduler_stop()`; does nothing when it's running */
 int rxp_scheduler_play(rxp_scheduler* s);                                             /* start decoding and the playback */
 int rxp_scheduler_stop(rxp_scheduler* s);                                             /* stop decoding and/or calling the callbacks */
 int rxp_scheduler_open_file(rxp_scheduler* s, char* file);                            /* adds a task to open the file (will result in a call to the open_file callback from the thread) */
+int rxp_scheduler_open_io(rxp_scheduler* s, rxp_io* io);                              /* adds a task to open the source, the rxp_io is copied. (will result in a call to the open_file callback from the thread) */
+int rxp_scheduler_reopen_file(rxp_scheduler* s, char* file);                          /* adds a task to replace the current file with the given one (will result in a call to the reopen_file callback from the thread), after which we pre-buffer from 0 */
+int rxp_scheduler_reopen_io(rxp_scheduler* s, rxp_io* io);                            /* same as `rxp_scheduler_reopen_file()` for a source, the rxp_io is copied */
+int rxp_scheduler_seek(rxp_scheduler* s, uint64_t pts);                               /* adds a task to seek to the given pts (will result in a call to the seek callback from the thread). when there are multiple seek tasks we only handle the last one */
 int rxp_scheduler_close_file(rxp_scheduler* s);                                       /* will call the close_file callback from the thread */
 int rxp_scheduler_update_decode_pts(rxp_scheduler* s, uint64_t pts);                  /* the user must call this function whenever it decoded a video/audio frame to let us know if we need to decode some more frames (to make sure that we always have some decoded frames... aka pre-buffering) */
 int rxp_scheduler_update_played_pts(rxp_scheduler* s, uint64_t pts);                  /* whenever an audio sample or video frame is send to the output (screen/soundcard) you need to tell the scheduler the pts of the last outputted data so we know if we need to decode some more frames. */
+uint64_t rxp_scheduler_get_decoded_pts(rxp_scheduler* s);                             /* returns the pts up to which we've decoded, use this instead of reading `decoded_pts` from another thread than the scheduler thread */
 
 #endif
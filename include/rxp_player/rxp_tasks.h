@@ -17,10 +17,13 @@
 typedef struct rxp_task rxp_task;
 typedef struct rxp_task_queue rxp_task_queue;
 
+typedef void(*rxp_task_dealloc_callback)(rxp_task* task);                 /* is called by rxp_task_dealloc() before the data of the task is freed */
+
 struct rxp_task {
   int type;
   int state;
   void* data;
+  rxp_task_dealloc_callback on_dealloc;                                  /* when set, releases what `data` refers to, also when the task is dropped w/o being handled */
   rxp_task* next;
 };
 
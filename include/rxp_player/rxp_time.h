@@ -0,0 +1,40 @@
+/*
+
+  rxp_time
+  --------
+
+  Converts between frame or sample counts, theora granules and nanoseconds
+  using integer math only. The decoder, the clock, the seek index, the prober
+  and the remuxer all use these functions so they agree on the pts of every
+  frame and sample, also in files that are days long.
+
+  A rate is given as `rate_num / rate_den` frames or samples per second: for
+  theora that's `fps_numerator / fps_denominator`, for audio it's the
+  samplerate and 1. We split the values into whole seconds and the rest before
+  we multiply by 1e9, so nothing overflows as long as the result fits.
+
+  A theora granule contains the frame number of the last keyframe, shifted by
+  `keyframe_granule_shift`, plus the number of frames since that keyframe. In
+  bitstreams before version 3.2.1 the granule of the first frame is 0, in
+  newer ones it's 1; `rxp_time_theora_offset()` tells you which one you have.
+
+      // the end time of the frame with the given granule
+      pts = rxp_time_theora_ns(&info, granulepos);
+
+      // the number of audio samples that end before or at pts
+      nsamples = rxp_time_to_count(pts, samplerate, 1);
+
+ */
+#ifndef RXP_TIME_H
+#define RXP_TIME_H
+
+#include <stdint.h>
+#include <theora/codec.h>
+
+int64_t rxp_time_ns(int64_t n, uint64_t rate_num, uint64_t rate_den);                 /* the time in ns of n frames or samples at a rate of rate_num / rate_den per second, 0 when n <= 0 or the rate is 0 */
+int64_t rxp_time_to_count(uint64_t pts, uint64_t rate_num, uint64_t rate_den);        /* the number of frames or samples at a rate of rate_num / rate_den per second that end before or at pts */
+int64_t rxp_time_theora_count(int64_t granule, int shift);                            /* the number of frames up to the given granule (keyframe + offset) */
+int rxp_time_theora_offset(int version_major, int version_minor, int version_subminor); /* 1 when the granule of the first frame is 1 (bitstreams >= 3.2.1), else 0 */
+int64_t rxp_time_theora_ns(th_info* info, int64_t granule);                           /* the end time in ns of the frame with the given granule, the same as th_granule_time() but w/o rounding errors; 0 when the granule is < 0 */
+
+#endif
@@ -9,11 +9,36 @@
 #define RXP_TASK_OPEN_FILE 3
 #define RXP_TASK_CLOSE_FILE 4
 #define RXP_TASK_STOP 5
+#define RXP_TASK_SEEK 6
+#define RXP_TASK_REOPEN_FILE 7
 
 /* decoder states */
 #define RXP_DEC_STATE_NONE 0x0000          /* default state */
 #define RXP_DEC_STATE_DECODING 0x0002      /* we've opened a i/o stream and we're decoding */
 #define RXP_DEC_STATE_READY 0x0004         /* all packets have been decoded, file is closed */
+#define RXP_DEC_STATE_WAITING 0x0008       /* the stream has no new data yet, we continue on the next decode call */
+
+/* stream seek states, see rxp_decoder_seek() */
+#define RXP_SEEK_NONE 0                    /* not seeking, we present everything we decode */
+#define RXP_SEEK_SYNC 1                    /* we're waiting for the first packet with a granulepos to know the exact position */
+#define RXP_SEEK_SKIP 2                    /* we know the position and decode, but don't present, until we reached the seek pts */
+
+/* decoder stream mask, see rxp_decoder_enable_streams() */
+#define RXP_DEC_STREAM_VIDEO 0x0001        /* decode the theora stream */
+#define RXP_DEC_STREAM_AUDIO 0x0002        /* decode the vorbis stream */
+#define RXP_DEC_STREAM_ALL (RXP_DEC_STREAM_VIDEO | RXP_DEC_STREAM_AUDIO)
+
+/* player video copy modes, see `copy_mode` in rxp_player.h */
+#define RXP_COPY_FRAME 1                   /* copy the decoded frame after th_decode_ycbcr_out() */
+#define RXP_COPY_STRIPES 2                 /* copy each stripe as soon as it's decoded while it's still in the cache, see TH_DECCTL_SET_STRIPE_CB */
+#define RXP_COPY_STRIPES_NT 3              /* same as RXP_COPY_STRIPES but with non-temporal stores so we don't pollute the cache with the copy */
+
+/* decoder input modes */
+#define RXP_IO_STDIO 1                     /* read the file with fread() */
+#define RXP_IO_MMAP 2                      /* memory map the file and feed the ogg sync layer from the mapping */
+#define RXP_IO_READAHEAD 3                 /* read the file with fread() from a separate thread, see rxp_readahead.h */
+#define RXP_IO_MEMORY 4                    /* read from a buffer in memory, see rxp_io_open_memory() */
+#define RXP_IO_STREAM 5                    /* read a FIFO, pipe or a file that is still being written w/o blocking, see rxp_io.h */
 
 /* player states */
 #define RXP_PSTATE_NONE (1 << 0)             /* the player isn't doing anything */
@@ -22,12 +47,18 @@
 #define RXP_PSTATE_PAUSED (1 << 3)           /* when the player is paused */
 #define RXP_PSTATE_DECODE_READY (1 << 4)     /* ready with decoding the file */
 #define RXP_PSTATE_SHUTTING_DOWN (1 << 5)    /* when rxp_player_clear() is called; only used to make sure tat someone doesn't call clear multiple times. */
+#define RXP_PSTATE_BUFFERING (1 << 6)        /* when playing a stream, the clock is halted until the jitter buffer has been filled */
 
 /* decoder events */
 #define RXP_DEC_EVENT_READY 0x0001         /* we're ready with decoding all packets; decoding may stop */
 #define RXP_DEC_EVENT_AUDIO_INFO 0x0002    /* we have found an audio stream and the samplerate/channels member has been set */
 #define RXP_PLAYER_EVENT_RESET 0x0003      /* gets fired when the player is ready with playing all the video packets and you should "stop" rendering and the audio stream */
 #define RXP_PLAYER_EVENT_PLAY 0x0004       /* gets fired when the decoder/scheduler is ready with pre-buffering and opening the file and we're kicking off playback */
+#define RXP_PLAYER_EVENT_BUFFERING 0x0005  /* gets fired when we're playing a stream and ran out of decoded data; the clock is halted */
+#define RXP_PLAYER_EVENT_BUFFERED 0x0006   /* gets fired when the jitter buffer has been filled again and playback continues */
+#define RXP_DEC_EVENT_CHAIN 0x0007         /* the next link of a chained file starts; the streams of the previous link have been freed */
+#define RXP_DEC_EVENT_VIDEO_INFO 0x0008    /* we have found a video stream and the pix_fmt member has been set */
+#define RXP_PLAYER_EVENT_AUDIO_FORMAT 0x0009 /* the playback reached a link of a chained file with another samplerate or number of channels; the samplerate/nchannels members of the player have been set */
  
 /* scheduler states */
 #define RXP_SCHED_STATE_NONE 0x0000
@@ -37,8 +68,13 @@
 /* decoder types */
 #define RXP_THEORA 1
 #define RXP_VORBIS 2
+#define RXP_SKELETON 3                     /* ogg skeleton, we only use it for the keyframe index; see rxp_index.h */
+#define RXP_OPUS 4                         /* only decoded when compiled with RXP_USE_OPUS */
 
 /* rxp_packet types */
 #define RXP_YUV420P 1 
+#define RXP_YUV422P 2                      /* full height, half width chroma */
+#define RXP_YUV444P 3                      /* full resolution chroma */
+#define RXP_REPEAT_FRAME 4                 /* no image; keep showing the previous frame until `repeat_pts` */
 
 #endif
@@ -0,0 +1,94 @@
+/*
+
+  EXPORT FRAMES
+  -------------
+  Decodes all frames of an .ogg file on several threads (see rxp_export.h) and
+  writes them, in order, into a .y4m file. Without a number of threads we use
+  one per cpu. Create a seek index first (rxp_index_create) so the segments
+  start exactly at keyframes.
+
+     ./rxp_export_frames bunny.ogg bunny.y4m 32
+
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <uv.h>
+#include <rxp_player/rxp_export.h>
+#include <rxp_player/rxp_probe.h>
+#include <rxp_player/rxp_types.h>
+
+static void on_frame(uint64_t pts, th_ycbcr_buffer buffer, void* user);
+
+static uint64_t nframes = 0;
+
+int main(int argc, char** argv) {
+
+  rxp_probe_info info;
+  const char* chroma = "420jpeg";
+  FILE* fp = NULL;
+  uint64_t t0 = 0;
+  int nthreads = 0;
+  int r = 0;
+
+  if (argc < 3) {
+    printf("Usage: %s input.ogg output.y4m [nthreads]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 3) {
+    nthreads = atoi(argv[3]);
+  }
+
+  if (rxp_probe(argv[1], &info) < 0 || 0 == info.has_video) {
+    printf("Error: %s doesn't contain a theora stream.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  if (RXP_YUV422P == info.pix_fmt) {
+    chroma = "422";
+  }
+  else if (RXP_YUV444P == info.pix_fmt) {
+    chroma = "444";
+  }
+
+  fp = fopen(argv[2], "wb");
+  if (!fp) {
+    printf("Error: cannot open %s.\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  /* the frames are delivered with their padding, we store the complete frames */
+  fprintf(fp, "YUV4MPEG2 W%d H%d F%u:%u Ip A1:1 C%s\n",
+          info.frame_width, info.frame_height,
+          info.fps_numerator, info.fps_denominator,
+          chroma);
+
+  t0 = uv_hrtime();
+  r = rxp_export_frames(argv[1], nthreads, on_frame, fp);
+
+  fclose(fp);
+
+  if (r < 0) {
+    printf("Error: cannot export the frames of %s.\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  printf("Exported %llu frames into %s in %.3f ms.\n", (unsigned long long)nframes, argv[2], (uv_hrtime() - t0) / 1e6);
+
+  return EXIT_SUCCESS;
+}
+
+static void on_frame(uint64_t pts, th_ycbcr_buffer buffer, void* user) {
+
+  FILE* fp = (FILE*)user;
+  int i = 0;
+
+  fprintf(fp, "FRAME\n");
+
+  /* the planes are tightly packed and stored after each other */
+  for (i = 0; i < 3; ++i) {
+    fwrite(buffer[i].data, 1, buffer[i].stride * buffer[i].height, fp);
+  }
+
+  nframes++;
+}
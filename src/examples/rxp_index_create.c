@@ -0,0 +1,36 @@
+/*
+ 
+  CREATE SEEK INDEX
+  -----------------
+  Creates the seek index sidecar (see rxp_index.h) for each of the given .ogg 
+  files. Run it once after you've copied the videos for an installation; the 
+  decoder loads the sidecar automatically when you open the file.
+
+     ./rxp_index_create video1.ogg video2.ogg
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <rxp_player/rxp_index.h>
+
+int main(int argc, char** argv) {
+
+  int i = 0;
+  int failed = 0;
+
+  if (argc < 2) {
+    printf("Usage: %s file.ogg [file.ogg ...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 1; i < argc; ++i) {
+    if (rxp_index_create(argv[i]) < 0) {
+      printf("Error: cannot create the index for %s.\n", argv[i]);
+      failed++;
+      continue;
+    }
+    printf("Created the index for %s.\n", argv[i]);
+  }
+
+  return (0 == failed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -86,7 +86,7 @@ static const char* RXP_PLAYER_FS = ""
 
 static void on_event(rxp_player* player, int event);               /* gets called whenever an event occurs */
 static void on_video_frame(rxp_player* player, rxp_packet* pkt);   /* gets called whenever a new video frame needs to be displayed. */
-static GLuint create_texture(int width, int height);               /* create yuv420p specific texture */
+static GLuint create_texture(int width, int height);               /* create a texture for one of the yuv planes */
 static int setup_opengl();                                         /* sets up all the openGL state for the player */
 static int setup_player();                                         /* sets up the rxp_player */
 
@@ -97,6 +97,8 @@ GLuint vao = 0;                                                    /* we need to
 GLuint tex_y = 0;                                                  /* y-channel texture to which we upload the y of the yuv420p */
 GLuint tex_u = 0;                                                  /* u-channel texture to which we upload the u of the yuv420p */
 GLuint tex_v = 0;                                                  /* v-channel texture to which we upload the v of the yuv420p */
+int tex_width = 0;                                                 /* width of the y texture, used to detect a change of the frame size */
+int tex_height = 0;                                                /* height of the y texture */
 rxp_player player;                                                 /* the all mighty player =) */ 
 
 cubeb* audio_ctx = NULL;
@@ -339,6 +341,9 @@ static int setup_player() {
     return -1;
   }
 
+  /* only copy the visible picture, so we can upload the planes as they are */
+  player.crop = 1;
+
   std::string video = rx_get_exe_path() +"/big_buck_bunny_720p_stereo.ogg";
   //std::string video = rx_get_exe_path() +"/big_buck_bunny_720p_no_audio.ogg";o
   if (rxp_player_open(&player, (char*)video.c_str()) < 0) {
@@ -359,20 +364,40 @@ static int setup_player() {
 
 /*
 
-  At this moment we only support YUYV420P video and here
-  we create the 3 textures for each Y,U and V layer. Note 
+  We create the 3 textures for each Y,U and V layer with the
+  size of the planes, so 4:2:2 and 4:4:4 video (see pkt->pix_fmt)
+  work with the same shader. When the width or height is odd the
+  chroma is slightly off; see PlayerGL.h for a shader per layout.
 
  */
 
 static void on_video_frame(rxp_player* player, rxp_packet* pkt) {
 
+  /* a duplicate of the previous frame, nothing to upload */
+  if (RXP_REPEAT_FRAME == pkt->type) {
+    return;
+  }
+
+  /* the frame size can change in the next link of a chained file */
+  if (tex_y != 0 && (pkt->img[0].width != tex_width || pkt->img[0].height != tex_height)) {
+    glDeleteTextures(1, &tex_y);
+    glDeleteTextures(1, &tex_u);
+    glDeleteTextures(1, &tex_v);
+    tex_y = 0;
+  }
+
   if (tex_y == 0) {
     /* create textures after we've decoded a frame. */
+    tex_width = pkt->img[0].width;
+    tex_height = pkt->img[0].height;
     tex_y = create_texture(pkt->img[0].width, pkt->img[0].height);
     tex_u = create_texture(pkt->img[1].width, pkt->img[1].height);
     tex_v = create_texture(pkt->img[2].width, pkt->img[2].height);
   }
 
+  /* the cropped rows are tightly packed, so they can have any length */
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
   glBindTexture(GL_TEXTURE_2D, tex_y);
   glPixelStorei(GL_UNPACK_ROW_LENGTH, pkt->img[0].stride);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pkt->img[0].width, pkt->img[0].height, GL_RED, GL_UNSIGNED_BYTE, pkt->img[0].data);
@@ -384,6 +409,9 @@ static void on_video_frame(rxp_player* player, rxp_packet* pkt) {
   glBindTexture(GL_TEXTURE_2D, tex_v);
   glPixelStorei(GL_UNPACK_ROW_LENGTH, pkt->img[2].stride);
   glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pkt->img[2].width, pkt->img[2].height, GL_RED, GL_UNSIGNED_BYTE, pkt->img[2].data);
+
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 }  
 
 /* 
@@ -404,6 +432,11 @@ static void on_video_frame(rxp_player* player, rxp_packet* pkt) {
           can check this by testing the number of channels, which 
           should be > 0, when the .ogg file has an audio stream.
 
+   RXP_PLAYER_EVENT_AUDIO_FORMAT:
+          The playback reached a link of a chained file with
+          another samplerate or number of channels; restart the
+          audio stream with the new nchannels and samplerate.
+
    RXP_PLAYER_EVENT_RESET: 
           Whenever you receive the RXP_PLAYER_EVENT_RESET event 
           it's time to tear down the player and stop the audio 
@@ -426,6 +459,18 @@ static void on_event(rxp_player* p, int event) {
       start_audio();
     }
   }
+  else if (event == RXP_PLAYER_EVENT_AUDIO_FORMAT) {
+    /* the next link of a chained file has another samplerate or number of channels */
+    printf("+ Received RXP_PLAYER_EVENT_AUDIO_FORMAT event.\n");
+    if (audio_stream) {
+      cubeb_stream_stop(audio_stream);
+      cubeb_stream_destroy(audio_stream);
+      audio_stream = NULL;
+    }
+    if (p->nchannels > 0) {
+      start_audio();
+    }
+  }
   else if (event == RXP_PLAYER_EVENT_RESET) {
     printf("+ Received RXP_PLAYER_EVENT_RESET event.\n");
 
@@ -0,0 +1,213 @@
+/*
+ 
+  PROBE FILES
+  -----------
+  Probes all the given files and the .ogg/.ogv files in the given directories 
+  (recursively) on a pool of threads and writes one line of JSON per file. The 
+  throughput is written to stderr when we're ready.
+
+     ./rxp_probe_files [-j nthreads] [-o results.jsonl] dir_or_file ...
+
+  By default we use one thread per cpu and write the results to stdout. Note 
+  that the library writes its errors to stdout too, so use -o when you want to 
+  parse the results.
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <uv.h>
+#include <rxp_player/rxp_probe.h>
+
+typedef struct {
+  char** filepaths;
+  int nfiles;
+  int capacity;
+} file_list;
+
+typedef struct {
+  FILE* fp;
+  int nfailed;
+} probe_output;
+
+static int add_path(file_list* list, const char* path);               /* adds a file or all .ogg/.ogv files in a directory */
+static int add_file(file_list* list, const char* path);
+static int has_ogg_extension(const char* path);
+static void on_probed(rxp_probe_result* result, void* user);
+
+int main(int argc, char** argv) {
+
+  file_list list = { NULL, 0, 0 };
+  probe_output output = { stdout, 0 };
+  char* output_path = NULL;
+  int nthreads = 0;
+  uint64_t start = 0;
+  double seconds = 0.0;
+  int i = 0;
+
+  for (i = 1; i < argc; ++i) {
+    if (0 == strcmp(argv[i], "-j") && i + 1 < argc) {
+      nthreads = atoi(argv[++i]);
+    }
+    else if (0 == strcmp(argv[i], "-o") && i + 1 < argc) {
+      output_path = argv[++i];
+    }
+    else if (add_path(&list, argv[i]) < 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (0 == list.nfiles) {
+    printf("Usage: %s [-j nthreads] [-o results.jsonl] dir_or_file ...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (output_path) {
+    output.fp = fopen(output_path, "wb");
+    if (!output.fp) {
+      printf("Error: cannot open %s.\n", output_path);
+      return EXIT_FAILURE;
+    }
+  }
+
+  start = uv_hrtime();
+
+  if (rxp_probe_files(list.filepaths, list.nfiles, nthreads, on_probed, &output) < 0) {
+    printf("Error: failed to probe the files.\n");
+  }
+
+  seconds = (uv_hrtime() - start) / 1e9;
+
+  fprintf(stderr, "Probed %d files (%d failed) in %.3f s, %.1f files/s.\n",
+          list.nfiles, output.nfailed, seconds, (seconds > 0.0) ? list.nfiles / seconds : 0.0);
+
+  if (output_path) {
+    fclose(output.fp);
+  }
+
+  for (i = 0; i < list.nfiles; ++i) {
+    free(list.filepaths[i]);
+  }
+  free(list.filepaths);
+
+  return (0 == output.nfailed) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* the callbacks are serialized by rxp_probe_files() so we don't need to lock */
+static void on_probed(rxp_probe_result* result, void* user) {
+
+  probe_output* output = (probe_output*)user;
+  char line[4096];
+  char* json = line;
+  size_t nbytes = 1024 + 6 * strlen(result->filepath);
+
+  /* an escaped character of the filepath takes at most 6 bytes, the rest of the line fits in 1024 */
+  if (nbytes <= sizeof(line)) {
+    nbytes = sizeof(line);
+  }
+  else {
+    json = (char*)malloc(nbytes);
+    if (!json) {
+      printf("Error: cannot allocate the JSON for %s.\n", result->filepath);
+      output->nfailed++;
+      return;
+    }
+  }
+
+  if (rxp_probe_to_json(result, json, nbytes) < 0) {
+    printf("Error: cannot create the JSON for %s.\n", result->filepath);
+    output->nfailed++;
+  }
+  else {
+    fprintf(output->fp, "%s\n", json);
+    if (0 != result->status) {
+      output->nfailed++;
+    }
+  }
+
+  if (json != line) {
+    free(json);
+  }
+}
+
+static int add_path(file_list* list, const char* path) {
+
+  uv_fs_t req;
+  uv_dirent_t ent;
+  char child[4096];
+
+  /* when we cannot scan it, it's a file */
+  if (uv_fs_scandir(uv_default_loop(), &req, path, 0, NULL) < 0) {
+    uv_fs_req_cleanup(&req);
+    return add_file(list, path);
+  }
+
+  while (UV_EOF != uv_fs_scandir_next(&req, &ent)) {
+
+    if ((size_t)snprintf(child, sizeof(child), "%s/%s", path, ent.name) >= sizeof(child)) {
+      continue;
+    }
+
+    if (UV_DIRENT_DIR == ent.type) {
+      if (add_path(list, child) < 0) {
+        uv_fs_req_cleanup(&req);
+        return -1;
+      }
+    }
+    else if (has_ogg_extension(ent.name)) {
+      if (add_file(list, child) < 0) {
+        uv_fs_req_cleanup(&req);
+        return -2;
+      }
+    }
+  }
+
+  uv_fs_req_cleanup(&req);
+
+  return 0;
+}
+
+static int add_file(file_list* list, const char* path) {
+
+  char** filepaths = NULL;
+  char* copy = NULL;
+
+  if (list->nfiles == list->capacity) {
+    list->capacity = (0 == list->capacity) ? 256 : list->capacity * 2;
+    filepaths = (char**)realloc(list->filepaths, list->capacity * sizeof(char*));
+    if (!filepaths) {
+      printf("Error: cannot allocate the file list.\n");
+      return -1;
+    }
+    list->filepaths = filepaths;
+  }
+
+  copy = (char*)malloc(strlen(path) + 1);
+  if (!copy) {
+    printf("Error: cannot allocate the file path.\n");
+    return -2;
+  }
+
+  strcpy(copy, path);
+  list->filepaths[list->nfiles++] = copy;
+
+  return 0;
+}
+
+static int has_ogg_extension(const char* path) {
+
+  const char* ext = strrchr(path, '.');
+  char lower[5] = { 0 };
+  int i = 0;
+
+  if (!ext || strlen(ext) != 4) {
+    return 0;
+  }
+
+  for (i = 0; i < 4; ++i) {
+    lower[i] = (char)tolower((unsigned char)ext[i]);
+  }
+
+  return (0 == strcmp(lower, ".ogg") || 0 == strcmp(lower, ".ogv"));
+}
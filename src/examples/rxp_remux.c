@@ -0,0 +1,48 @@
+/*
+ 
+  REMUX
+  -----
+  Copies a time range of an .ogg file into a new file without re-encoding (see
+  rxp_remux.h). The start and end are given in seconds; without an end we copy
+  until the end of the file. The copy starts at the keyframe before the start.
+
+     ./rxp_remux master.ogg loop.ogg 10 25.5
+ 
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <uv.h>
+#include <rxp_player/rxp_remux.h>
+
+int main(int argc, char** argv) {
+
+  double start = 0.0;
+  double end = 0.0;
+  uint64_t t0 = 0;
+
+  if (argc < 4) {
+    printf("Usage: %s input.ogg output.ogg start_seconds [end_seconds]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  start = atof(argv[3]);
+  if (argc > 4) {
+    end = atof(argv[4]);
+  }
+
+  if (start < 0.0 || end < 0.0) {
+    printf("Error: the start and end cannot be negative.\n");
+    return EXIT_FAILURE;
+  }
+
+  t0 = uv_hrtime();
+
+  if (rxp_remux_trim(argv[1], argv[2], (uint64_t)(start * 1e9), (uint64_t)(end * 1e9)) < 0) {
+    printf("Error: cannot copy %s into %s.\n", argv[1], argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  printf("Copied %s into %s in %.3f ms.\n", argv[1], argv[2], (uv_hrtime() - t0) / 1e6);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,679 @@
+/*
+
+  SELF CHECK
+  ----------
+  Checks the parts of the library that replace libogg or libtheora code, or
+  that do tricky integer math, against the reference or against known values:
+
+     - the pages the framer finds in a stream that we create in memory with
+       libogg (also after we prepend garbage, corrupt a page and cut off the 
+       last page) must be the same as the pages that ogg_sync_pageseek() finds.
+       The framer only accepts pages with a valid crc, so this checks the 
+       slice-by-8 crc against the one ogg_stream_pageout() calculates too.
+     - the SIMD capture search must find "OggS" at every offset and alignment.
+     - the skeleton index keypoints, which are stored as varints, see rxp_index.h
+     - the conversions between counts and nanoseconds, see rxp_time.h, around
+       whole seconds and for files that are weeks long.
+     - the lookup of the seek index entries.
+
+     ./rxp_selfcheck
+
+  Run it after you changed one of these or when you build for a new cpu; it
+  returns EXIT_FAILURE when one of the checks fails. `ctest` runs it too.
+
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ogg/ogg.h>
+#include <rxp_player/rxp_types.h>
+#include <rxp_player/rxp_framer.h>
+#include <rxp_player/rxp_index.h>
+#include <rxp_player/rxp_time.h>
+
+#define NS 1000000000ull
+#define CAPTURE_BUFFER_SIZE 512
+#define OGG_NPACKETS 600                                                        /* number of packets in the stream we create */
+#define OGG_MAX_PACKET_SIZE 70000                                               /* larger than a page, so some packets span pages */
+#define SKELETON_PACKET_SIZE 128                                                /* large enough for a skeleton index packet with two keypoints */
+
+static int nchecks = 0;
+static int nfailed = 0;
+
+static int check(int ok, const char* what);                                     /* counts the check and prints what failed; returns ok */
+static int check_framer(const uint8_t* data, uint64_t nbytes, const char* name);  /* compares the framer with libogg for the given data */
+static int check_capture(void);
+static int check_skeleton(void);
+static int check_time(void);
+static int check_index(void);
+static int add_skeleton(rxp_index* index, uint64_t segment_length, int64_t file_size); /* adds a fishead and a theora fisbone for stream 1 */
+static int write_varint(uint64_t v, unsigned char* dest);                       /* writes v as skeleton varint, returns the number of bytes */
+static void write_le(unsigned char* dest, uint64_t v, int nbytes);              /* skeleton values are little endian */
+static uint8_t* create_ogg(uint64_t* nbytes);                                   /* creates two interleaved logical streams with libogg */
+static int append_page(uint8_t** data, uint64_t* nbytes, ogg_page* page);
+static uint32_t next_random(void);                                              /* a small LCG, so every run uses the same data */
+
+static uint32_t random_state = 0x2545F491;
+
+int main(void) {
+
+  uint8_t* data = NULL;
+  uint8_t* corrupt = NULL;
+  uint64_t nbytes = 0;
+  uint64_t i = 0;
+
+  data = create_ogg(&nbytes);
+  if (NULL == data) {
+    return EXIT_FAILURE;
+  }
+
+  check_framer(data, nbytes, "the created stream");
+
+  /* garbage that looks like captures, a corrupt page and a last page that is cut off */
+  corrupt = (uint8_t*)malloc(nbytes + 64);
+  if (NULL == corrupt) {
+    printf("Error: cannot allocate the corrupt copy.\n");
+    free(data);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 64; ++i) {
+    corrupt[i] = "OggS"[i % 4];
+  }
+
+  memcpy(corrupt + 64, data, nbytes);
+  corrupt[64 + nbytes / 2] ^= 0x5A;
+
+  check_framer(corrupt, (nbytes + 64 > 100) ? (nbytes + 64 - 100) : nbytes + 64, "the corrupt copy");
+
+  free(corrupt);
+  free(data);
+
+  check_capture();
+  check_skeleton();
+  check_time();
+  check_index();
+
+  if (0 != nfailed) {
+    printf("%d of %d checks failed.\n", nfailed, nchecks);
+    return EXIT_FAILURE;
+  }
+
+  printf("All %d checks passed.\n", nchecks);
+
+  return EXIT_SUCCESS;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int check(int ok, const char* what) {
+
+  nchecks++;
+
+  if (!ok) {
+    nfailed++;
+    printf("Error: check failed: %s\n", what);
+  }
+
+  return ok;
+}
+
+static int check_framer(const uint8_t* data, uint64_t nbytes, const char* name) {
+
+  rxp_framer framer;
+  ogg_sync_state sync;
+  ogg_page ref_page;
+  ogg_page page;
+  char* buffer = NULL;
+  int64_t offset = 0;
+  int64_t ref_offset = 0;
+  uint32_t npages = 0;
+  long r = 0;
+
+  if (0 != rxp_framer_init(&framer)) {
+    return check(0, "rxp_framer_init()");
+  }
+
+  if (0 != rxp_framer_open(&framer, data, nbytes)) {
+    return check(0, "rxp_framer_open()");
+  }
+
+  ogg_sync_init(&sync);
+
+  buffer = ogg_sync_buffer(&sync, (long)nbytes);
+  if (NULL == buffer) {
+    ogg_sync_clear(&sync);
+    return check(0, "ogg_sync_buffer()");
+  }
+
+  memcpy(buffer, data, nbytes);
+  ogg_sync_wrote(&sync, (long)nbytes);
+
+  while (0 != (r = ogg_sync_pageseek(&sync, &ref_page))) {
+
+    /* libogg skipped bytes */
+    if (r < 0) {
+      ref_offset += -r;
+      continue;
+    }
+
+    npages++;
+
+    if (!check(0 == rxp_framer_next(&framer, &page, &offset), "the framer finds every page libogg finds")
+        || !check(offset == ref_offset, "the framer finds the page at the same offset")
+        || !check(page.header_len == ref_page.header_len && page.body_len == ref_page.body_len, "the framer finds pages with the same size")
+        || !check(0 == memcmp(page.header, ref_page.header, page.header_len), "the framer finds pages with the same header")
+        || !check(0 == memcmp(page.body, ref_page.body, page.body_len), "the framer finds pages with the same body"))
+    {
+      printf("Error: %s, page %u at offset %lld.\n", name, npages, (long long)ref_offset);
+      break;
+    }
+
+    ref_offset += r;
+  }
+
+  if (0 == r) {
+    check(1 == rxp_framer_next(&framer, &page, &offset), "the framer doesn't find pages that libogg doesn't find");
+  }
+
+  check(npages > 0, "libogg finds pages in the data");
+
+  ogg_sync_clear(&sync);
+
+#if !defined(NDEBUG)
+  printf("Info: compared %u pages in %s, the framer skipped %llu bytes.\n", npages, name, (unsigned long long)framer.nskipped);
+#endif
+
+  return 0;
+}
+
+static int check_capture(void) {
+
+  uint8_t buffer[CAPTURE_BUFFER_SIZE];
+  int pos = 0;
+  int start = 0;
+  int ok = 1;
+  int i = 0;
+
+  /* a pattern that starts like a capture, but never is one */
+  for (i = 0; i < CAPTURE_BUFFER_SIZE; ++i) {
+    buffer[i] = "Oggx"[i % 4];
+  }
+
+  check(NULL == rxp_framer_find_capture(buffer, buffer + CAPTURE_BUFFER_SIZE), "the capture search doesn't find OggS when there is none");
+
+  for (pos = 0; pos <= CAPTURE_BUFFER_SIZE - 4 && ok; ++pos) {
+
+    memcpy(buffer + pos, "OggS", 4);
+
+    /* start at every alignment before the capture, also past the width of a vector */
+    for (start = (pos > 40) ? pos - 40 : 0; start <= pos; ++start) {
+
+      if (buffer + pos != rxp_framer_find_capture(buffer + start, buffer + CAPTURE_BUFFER_SIZE)) {
+        printf("Error: the capture at %d isn't found when we start at %d.\n", pos, start);
+        ok = 0;
+        break;
+      }
+
+      if (NULL != rxp_framer_find_capture(buffer + start, buffer + pos + 3)) {
+        printf("Error: the capture at %d is found when it's cut off, start at %d.\n", pos, start);
+        ok = 0;
+        break;
+      }
+    }
+
+    for (i = pos; i < pos + 4; ++i) {
+      buffer[i] = "Oggx"[i % 4];
+    }
+  }
+
+  check(ok, "the capture search finds OggS at every offset");
+
+  return 0;
+}
+
+static int check_skeleton(void) {
+
+  static const uint64_t values[] = { 0, 1, 127, 128, 255, 300, 16383, 16384, 2097151, 2097152,
+                                     1ull << 31, 1ull << 35, (1ull << 56) - 1, 1ull << 56, (1ull << 62) + 5, (1ull << 63) - 1 };
+  unsigned char packet[SKELETON_PACKET_SIZE];
+  rxp_index index;
+  int64_t offset = 0;
+  uint64_t second = 0;
+  int nvalues = (int)(sizeof(values) / sizeof(values[0]));
+  int len = 0;
+  int ok = 1;
+  int i = 0;
+
+  /* an index packet for stream 1 with two keypoints; the offset of the first one is the value we check */
+  memset(packet, 0x00, sizeof(packet));
+  memcpy(packet, "index\0", 6);
+  write_le(packet + 6, 1, 4);
+  write_le(packet + 10, 2, 8);
+  write_le(packet + 18, 1000, 8);
+  write_le(packet + 34, 2000, 8);
+
+  for (i = 0; i < nvalues; ++i) {
+
+    /* the second keypoint is a delta, the sum must fit in 63 bits */
+    second = (values[i] < (1ull << 62)) ? values[nvalues - 1 - i] % (1ull << 62) : ((1ull << 63) - 1 - values[i]);
+
+    len = 42;
+    len += write_varint(values[i], packet + len);
+    len += write_varint(1, packet + len);
+    len += write_varint(second, packet + len);
+    len += write_varint(1000, packet + len);
+
+    if (0 != add_skeleton(&index, 0, 0)) {
+      return check(0, "rxp_index_add_skeleton() with a fishead and fisbone");
+    }
+
+    if (1 != rxp_index_add_skeleton(&index, packet, len, 0)
+        || 0 != rxp_index_find(&index, NS / 1000, &offset) || (uint64_t)offset != values[i]
+        || 0 != rxp_index_find(&index, NS + NS / 1000, &offset) || (uint64_t)offset != values[i] + second
+        || 0 != rxp_index_find(&index, 0, &offset) || 0 != offset
+        || 2 * NS != index.duration)
+    {
+      printf("Error: cannot read the keypoint %llu.\n", (unsigned long long)values[i]);
+      ok = 0;
+    }
+
+    rxp_index_clear(&index);
+
+    /* the last varint is cut off */
+    add_skeleton(&index, 0, 0);
+    if (rxp_index_add_skeleton(&index, packet, len - 1, 0) >= 0 || rxp_index_find(&index, 2 * NS, &offset) >= 0) {
+      printf("Error: the keypoint %llu is read when the packet is cut off.\n", (unsigned long long)values[i]);
+      ok = 0;
+    }
+
+    rxp_index_clear(&index);
+  }
+
+  check(ok, "the skeleton keypoints are read for all values");
+
+  /* a varint with more than 63 bits */
+  write_le(packet + 10, 1, 8);
+  memset(packet + 42, 0x7F, 9);
+  packet[51] = 0xFF;
+  len = 52 + write_varint(1, packet + 52);
+
+  add_skeleton(&index, 0, 0);
+  check(rxp_index_add_skeleton(&index, packet, len, 0) < 0, "the skeleton varint reader stops after 63 bits");
+  rxp_index_clear(&index);
+
+  /* keypoints of a file that changed after muxing are not used */
+  write_le(packet + 10, 1, 8);
+  len = 42;
+  len += write_varint(100, packet + len);
+  len += write_varint(1, packet + len);
+
+  add_skeleton(&index, 1000, 2000);
+  check(0 == rxp_index_add_skeleton(&index, packet, len, 2000) && rxp_index_find(&index, NS, &offset) < 0, "the skeleton index is ignored when the file size changed");
+  rxp_index_clear(&index);
+
+  add_skeleton(&index, 2000, 2000);
+  check(1 == rxp_index_add_skeleton(&index, packet, len, 2000) && 0 == rxp_index_find(&index, NS, &offset) && 100 == offset, "the skeleton index is used when the file size matches");
+  rxp_index_clear(&index);
+
+  return 0;
+}
+
+static int check_time(void) {
+
+  static const uint64_t rates[][2] = { { 30000, 1001 }, { 24000, 1001 }, { 60000, 1001 }, { 25, 1 }, { 30, 1 }, { 44100, 1 }, { 48000, 1 }, { 22050, 1 } };
+  int nrates = (int)(sizeof(rates) / sizeof(rates[0]));
+  uint64_t num = 0;
+  uint64_t den = 0;
+  uint64_t k = 0;
+  int64_t n = 0;
+  int64_t t = 0;
+  int64_t expected = 0;
+  int ok = 1;
+  int i = 0;
+  th_info info;
+
+  check(0 == rxp_time_ns(0, 30, 1), "rxp_time_ns() of 0 is 0");
+  check(0 == rxp_time_ns(-5, 30, 1), "rxp_time_ns() of a negative count is 0");
+  check(0 == rxp_time_ns(5, 0, 1), "rxp_time_ns() with a rate of 0 is 0");
+  check(0 == rxp_time_to_count(NS, 30, 0), "rxp_time_to_count() with a rate of 0 is 0");
+  check(33366666 == rxp_time_ns(1, 30000, 1001), "the first frame at 29.97 fps ends at 33366666");
+  check(1001ll * NS == rxp_time_ns(30000, 30000, 1001), "30000 frames at 29.97 fps take 1001 seconds");
+  check(22675 == rxp_time_ns(1, 44100, 1), "the first sample at 44.1 kHz ends at 22675");
+  check(NS == (uint64_t)rxp_time_ns(44100, 44100, 1), "44100 samples at 44.1 kHz take a second");
+  check(0 == rxp_time_to_count(22675, 44100, 1), "the first sample at 44.1 kHz ends after 22675");
+  check(1 == rxp_time_to_count(22676, 44100, 1), "the first sample at 44.1 kHz ends before 22676");
+  check(44099 == rxp_time_to_count(NS - 1, 44100, 1), "44099 samples at 44.1 kHz end before a second");
+  check(30000 == rxp_time_to_count(1001ll * NS, 30000, 1001), "30000 frames at 29.97 fps end at 1001 seconds");
+  check(29999 == rxp_time_to_count(1001ll * NS - 1, 30000, 1001), "29999 frames at 29.97 fps end before 1001 seconds");
+
+  for (i = 0; i < nrates && ok; ++i) {
+
+    num = rates[i][0];
+    den = rates[i][1];
+
+    /* small counts: compare with the direct calculation, which doesn't overflow yet */
+    for (n = 0; n < 100000; ++n) {
+
+      t = rxp_time_ns(n, num, den);
+      expected = (int64_t)(((uint64_t)n * den * NS) / num);
+
+      if (t != expected || n != rxp_time_to_count(t + 1, num, den)) {
+        printf("Error: wrong time or count for %lld at %llu/%llu.\n", (long long)n, (unsigned long long)num, (unsigned long long)den);
+        ok = 0;
+        break;
+      }
+
+      /* t is rounded down, so frame n only ends at t when t is exact */
+      expected = (0 == ((uint64_t)n * den * NS) % num) ? n : n - 1;
+      if (n > 0 && expected != rxp_time_to_count(t, num, den)) {
+        printf("Error: wrong count at the end of %lld at %llu/%llu.\n", (long long)n, (unsigned long long)num, (unsigned long long)den);
+        ok = 0;
+        break;
+      }
+    }
+
+    /* whole seconds, and the ns before them, up to a year */
+    for (k = 1; k < 365ull * 24ull * 3600ull && ok; k = k * 3 + 1) {
+
+      expected = (int64_t)((k * num) / den);
+      if (expected != rxp_time_to_count(k * NS, num, den)) {
+        printf("Error: wrong count at %llu seconds at %llu/%llu.\n", (unsigned long long)k, (unsigned long long)num, (unsigned long long)den);
+        ok = 0;
+        break;
+      }
+
+      expected = (0 == (k * num) % den) ? expected - 1 : expected;
+      if (expected != rxp_time_to_count(k * NS - 1, num, den)) {
+        printf("Error: wrong count just before %llu seconds at %llu/%llu.\n", (unsigned long long)k, (unsigned long long)num, (unsigned long long)den);
+        ok = 0;
+        break;
+      }
+    }
+
+    /* counts of a file that is 30 days long */
+    for (n = (int64_t)((30ull * 24ull * 3600ull * num) / den) - 100; n < (int64_t)((30ull * 24ull * 3600ull * num) / den) + 100 && ok; ++n) {
+
+      t = rxp_time_ns(n, num, den);
+
+      if (n != rxp_time_to_count(t + 1, num, den)
+          || n - 1 != rxp_time_to_count(t - 1, num, den)
+          || t >= rxp_time_ns(n + 1, num, den))
+      {
+        printf("Error: wrong time or count for %lld at %llu/%llu.\n", (long long)n, (unsigned long long)num, (unsigned long long)den);
+        ok = 0;
+        break;
+      }
+    }
+  }
+
+  check(ok, "the time of counts and the counts of times are correct");
+
+  /* theora granules */
+  check(8 == rxp_time_theora_count((5 << 6) | 3, 6), "keyframe 5 plus 3 frames is frame 8");
+  check(1 == rxp_time_theora_offset(3, 2, 1), "the first granule of 3.2.1 is 1");
+  check(0 == rxp_time_theora_offset(3, 2, 0), "the first granule of 3.2.0 is 0");
+
+  memset(&info, 0, sizeof(info));
+  info.fps_numerator = 30;
+  info.fps_denominator = 1;
+  info.keyframe_granule_shift = 6;
+  info.version_major = 3;
+  info.version_minor = 2;
+  info.version_subminor = 1;
+
+  check(33333333 == rxp_time_theora_ns(&info, 1), "the first frame of a 3.2.1 stream ends at 33333333");
+  check(NS == (uint64_t)rxp_time_theora_ns(&info, (29 << 6) | 1), "frame 30 of a 3.2.1 stream ends at a second");
+  check(0 == rxp_time_theora_ns(&info, -1), "the time of granule -1 is 0");
+
+  info.version_subminor = 0;
+  check(33333333 == rxp_time_theora_ns(&info, 0), "the first frame of a 3.2.0 stream ends at 33333333");
+
+  return 0;
+}
+
+static int check_index(void) {
+
+  rxp_index index;
+  rxp_index_stream* stream = NULL;
+  int64_t offset = 0;
+
+  if (0 != rxp_index_init(&index)) {
+    return check(0, "rxp_index_init()");
+  }
+
+  check(rxp_index_find(&index, 0, &offset) < 0, "rxp_index_find() fails w/o streams");
+
+  if (0 != rxp_index_add_stream(&index, 1, RXP_THEORA, &stream)) {
+    return check(0, "rxp_index_add_stream()");
+  }
+
+  check(rxp_index_find(&index, NS, &offset) < 0, "rxp_index_find() fails w/o entries");
+
+  /* theora: we decode from the last keyframe that is presented at or before pts */
+  rxp_index_add_entry(stream, 100, 0, 0);
+  rxp_index_add_entry(stream, 2000, 60 << 6, 2 * NS);
+  rxp_index_add_entry(stream, 5000, 120 << 6, 4 * NS);
+
+  check(0 == rxp_index_find(&index, 0, &offset) && 100 == offset, "the first keyframe is used for 0");
+  check(0 == rxp_index_find(&index, 2 * NS - 1, &offset) && 100 == offset, "the first keyframe is used just before the second");
+  check(0 == rxp_index_find(&index, 2 * NS, &offset) && 2000 == offset, "the second keyframe is used at its pts");
+  check(0 == rxp_index_find(&index, 9 * NS, &offset) && 5000 == offset, "the last keyframe is used after the end");
+
+  rxp_index_clear(&index);
+
+  if (0 != rxp_index_add_stream(&index, 2, RXP_VORBIS, &stream)) {
+    return check(0, "rxp_index_add_stream()");
+  }
+
+  /* vorbis: we decode from the last page that ends before pts */
+  rxp_index_add_entry(stream, 50, 44100, NS);
+  rxp_index_add_entry(stream, 1500, 88200, 2 * NS);
+  rxp_index_add_entry(stream, 4800, 132300, 3 * NS);
+
+  check(0 == rxp_index_find(&index, NS, &offset) && 0 == offset, "no audio page ends before the end of the first");
+  check(0 == rxp_index_find(&index, NS + 1, &offset) && 50 == offset, "the first audio page ends before its end + 1");
+  check(0 == rxp_index_find(&index, 2 * NS, &offset) && 50 == offset, "the second audio page doesn't end before its end");
+  check(0 == rxp_index_find(&index, 2 * NS + 1, &offset) && 1500 == offset, "the second audio page ends before its end + 1");
+  check(0 == rxp_index_find(&index, 9 * NS, &offset) && 4800 == offset, "the last audio page is used after the end");
+
+  /* add the entries before we add the next stream, adding a stream reallocates them */
+  if (0 != rxp_index_add_stream(&index, 1, RXP_THEORA, &stream)) {
+    rxp_index_clear(&index);
+    return check(0, "rxp_index_add_stream()");
+  }
+
+  rxp_index_add_entry(stream, 100, 0, 0);
+  rxp_index_add_entry(stream, 2000, 60 << 6, 2 * NS);
+  rxp_index_add_entry(stream, 5000, 120 << 6, 4 * NS);
+
+  /* the offset is the smallest offset of all streams */
+  check(0 == rxp_index_find(&index, 500, &offset) && 0 == offset, "we decode from the start when audio needs it");
+  check(0 == rxp_index_find(&index, 2 * NS, &offset) && 50 == offset, "we decode from the first audio page at 2s");
+  check(0 == rxp_index_find(&index, 3 * NS + NS / 2, &offset) && 2000 == offset, "we decode from the second keyframe at 3.5s");
+
+  rxp_index_clear(&index);
+
+  check(rxp_index_find(&index, 0, &offset) < 0, "rxp_index_find() fails w/o index");
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+/* 7 bits per byte, least significant first; the last byte has the high bit set. */
+static int write_varint(uint64_t v, unsigned char* dest) {
+
+  int n = 0;
+
+  while (v >= 0x80) {
+    dest[n++] = (unsigned char)(v & 0x7F);
+    v >>= 7;
+  }
+
+  dest[n++] = (unsigned char)(v | 0x80);
+
+  return n;
+}
+
+static void write_le(unsigned char* dest, uint64_t v, int nbytes) {
+
+  int i = 0;
+
+  for (i = 0; i < nbytes; ++i) {
+    dest[i] = (unsigned char)(v >> (8 * i));
+  }
+}
+
+/* a skeleton 4.0 fishead and a fisbone for a theora stream with serial 1 */
+static int add_skeleton(rxp_index* index, uint64_t segment_length, int64_t file_size) {
+
+  static const char content_type[] = "Content-Type: video/theora\r\n";
+  unsigned char fishead[80];
+  unsigned char fisbone[52 + sizeof(content_type)];
+
+  rxp_index_init(index);
+
+  memset(fishead, 0x00, sizeof(fishead));
+  memcpy(fishead, "fishead\0", 8);
+  write_le(fishead + 8, 4, 2);
+  write_le(fishead + 64, segment_length, 8);
+
+  memset(fisbone, 0x00, sizeof(fisbone));
+  memcpy(fisbone, "fisbone\0", 8);
+  write_le(fisbone + 8, 44, 4);
+  write_le(fisbone + 12, 1, 4);
+  memcpy(fisbone + 52, content_type, sizeof(content_type) - 1);
+
+  if (0 != rxp_index_add_skeleton(index, fishead, sizeof(fishead), file_size)
+      || 0 != rxp_index_add_skeleton(index, fisbone, sizeof(fisbone), file_size))
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
+/* 
+   Packets of random size: empty ones, multiples of 255 bytes (which need a 
+   0 lacing value), and ones that are larger than a page. Some contain "OggS" 
+   so the capture search finds captures that don't start a page.
+*/
+static uint8_t* create_ogg(uint64_t* nbytes) {
+
+  ogg_stream_state streams[2];
+  ogg_packet packet;
+  ogg_page page;
+  unsigned char* payload = NULL;
+  uint8_t* data = NULL;
+  long len = 0;
+  int ok = 1;
+  int i = 0;
+  int j = 0;
+
+  *nbytes = 0;
+
+  payload = (unsigned char*)malloc(OGG_MAX_PACKET_SIZE);
+  if (NULL == payload) {
+    printf("Error: cannot allocate the packet payload.\n");
+    return NULL;
+  }
+
+  ogg_stream_init(&streams[0], 0x1234);
+  ogg_stream_init(&streams[1], 0x5678);
+
+  for (i = 0; i < OGG_NPACKETS && ok; ++i) {
+
+    if (i < 2) {
+      len = 42;
+    }
+    else if (0 == i % 7) {
+      len = 255 * (long)(1 + next_random() % 4);
+    }
+    else if (1 == i % 7) {
+      len = 20000 + (long)(next_random() % (OGG_MAX_PACKET_SIZE - 20000));
+    }
+    else if (2 == i % 7) {
+      len = 0;
+    }
+    else {
+      len = (long)(next_random() % 3000);
+    }
+
+    for (j = 0; j < len; ++j) {
+      payload[j] = (unsigned char)next_random();
+    }
+
+    if (len > 100 && 0 == i % 3) {
+      memcpy(payload + len / 2, "OggS", 4);
+    }
+
+    packet.packet = payload;
+    packet.bytes = len;
+    packet.b_o_s = (i < 2) ? 1 : 0;
+    packet.e_o_s = (i >= OGG_NPACKETS - 2) ? 1 : 0;
+    packet.granulepos = i / 2;
+    packet.packetno = i / 2;
+
+    if (0 != ogg_stream_packetin(&streams[i % 2], &packet)) {
+      printf("Error: ogg_stream_packetin() failed.\n");
+      ok = 0;
+      break;
+    }
+
+    /* the bos pages must be first and only contain the bos packet */
+    if (i < 2) {
+      while (ok && 0 != ogg_stream_flush(&streams[i % 2], &page)) {
+        ok = (0 == append_page(&data, nbytes, &page));
+      }
+      continue;
+    }
+
+    while (ok && 0 != ogg_stream_pageout(&streams[i % 2], &page)) {
+      ok = (0 == append_page(&data, nbytes, &page));
+    }
+  }
+
+  for (i = 0; i < 2; ++i) {
+    while (ok && 0 != ogg_stream_flush(&streams[i], &page)) {
+      ok = (0 == append_page(&data, nbytes, &page));
+    }
+  }
+
+  ogg_stream_clear(&streams[0]);
+  ogg_stream_clear(&streams[1]);
+  free(payload);
+
+  if (!ok) {
+    free(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+static int append_page(uint8_t** data, uint64_t* nbytes, ogg_page* page) {
+
+  uint8_t* tmp = NULL;
+
+  tmp = (uint8_t*)realloc(*data, *nbytes + page->header_len + page->body_len);
+  if (NULL == tmp) {
+    printf("Error: cannot grow the created stream.\n");
+    return -1;
+  }
+
+  *data = tmp;
+
+  memcpy(*data + *nbytes, page->header, page->header_len);
+  *nbytes += page->header_len;
+
+  memcpy(*data + *nbytes, page->body, page->body_len);
+  *nbytes += page->body_len;
+
+  return 0;
+}
+
+static uint32_t next_random(void) {
+  random_state = random_state * 1664525u + 1013904223u;
+  return random_state >> 8;
+}
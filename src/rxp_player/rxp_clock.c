@@ -1,4 +1,12 @@
 #include <rxp_player/rxp_clock.h>
+#include <rxp_player/rxp_time.h>
+
+/* ---------------------------------------------------------------- */
+
+static uint64_t rxp_clock_samples_to_ns(uint64_t samples, uint64_t samplerate);  /* the time of the given number of samples in ns, w/o rounding errors or overflowing */
+static uint64_t rxp_clock_ns_to_samples(uint64_t pts, uint64_t samplerate);      /* the number of samples that end before or at pts */
+
+/* ---------------------------------------------------------------- */
 
 int rxp_clock_init(rxp_clock* clock) {
   if (!clock) { return -1; } 
@@ -7,16 +15,17 @@ int rxp_clock_init(rxp_clock* clock) {
   clock->time_last = 0;
   clock->time_start = 0;
   clock->nsamples = 0;
-  clock->sample_time = 0;
   clock->samplerate = 0;
+  clock->time_paused = 0;
+  clock->is_paused = 0;
   return 0;
 }
 
 int rxp_clock_start(rxp_clock* clock) {
   if (!clock) { return - 1; } 
-  clock->time_start = uv_hrtime();
-  clock->time_last = clock->time_start;
-  clock->time = 0;
+  /* time is only set when we seeked before starting */
+  clock->time_last = uv_hrtime();
+  clock->time_start = clock->time_last - clock->time;
   return 0;
 }
 
@@ -30,19 +39,67 @@ int rxp_clock_update(rxp_clock* clock) {
 
   if (clock->type == RXP_CLOCK_CPU) {
 
+    if (clock->is_paused) {
+      return 0;
+    }
+
     /* cpu based time */
     clock->time_last = uv_hrtime();
     clock->time = clock->time_last - clock->time_start;
   }
   else { 
     /* audio sample based on the nubmer of added samples */
-    clock->time_last = clock->nsamples * clock->sample_time;
+    clock->time_last = rxp_clock_samples_to_ns(clock->nsamples, clock->samplerate);
     clock->time = clock->time_last;
   }
 
   return 0;
 }
 
+int rxp_clock_pause(rxp_clock* clock) {
+  if (!clock) { return -1; } 
+  if (clock->is_paused) { return 0; } 
+  clock->time_paused = uv_hrtime();
+  clock->is_paused = 1;
+  return 0;
+}
+
+int rxp_clock_resume(rxp_clock* clock) {
+  if (!clock) { return -1; } 
+  if (!clock->is_paused) { return 0; } 
+  
+  /* shift the start time so the paused period isn't counted */
+  if (clock->type == RXP_CLOCK_CPU) {
+    clock->time_start += uv_hrtime() - clock->time_paused;
+  }
+
+  clock->is_paused = 0;
+  return 0;
+}
+
+int rxp_clock_seek(rxp_clock* clock, uint64_t pts) {
+
+  uint64_t now = 0;
+
+  if (!clock) { return -1; } 
+
+  if (clock->type == RXP_CLOCK_CPU) {
+    now = uv_hrtime();
+    clock->time_start = now - pts;
+    clock->time_last = now;
+    if (clock->is_paused) {
+      clock->time_paused = now;
+    }
+  }
+  else {
+    clock->nsamples = rxp_clock_ns_to_samples(pts, clock->samplerate);
+  }
+
+  clock->time = pts;
+
+  return 0;
+}
+
 /* just resets the clock, same as init, init<>shutdown seems ok api wise */
 int rxp_clock_shutdown(rxp_clock* clock) {
   return rxp_clock_init(clock);
@@ -56,10 +113,9 @@ int rxp_clock_set_samplerate(rxp_clock* clock, uint64_t samplerate) {
 
   /* we cannot use uv_hrtime() as used in rxp_clock_start() because we base
      the time on the number of player/added samples, therefore the current 
-     time is calculated only based on the played samples times sample_time. */
+     time is calculated only based on the played samples and the samplerate. */
   clock->samplerate = samplerate;
   clock->type = RXP_CLOCK_AUDIO;
-  clock->sample_time = ((double)1.0 / (double)(samplerate)) * (uint64_t)(1000 * 1000 * 1000);
   return 0;
 }
 
@@ -68,5 +124,19 @@ void rxp_clock_add_samples(rxp_clock* clock, uint32_t samples) {
 }
 
 uint64_t rxp_clock_calculate_audio_time(rxp_clock* clock, uint64_t samples) {
-  return clock->sample_time * samples;
+  return rxp_clock_samples_to_ns(samples, clock->samplerate);
+}
+
+uint64_t rxp_clock_calculate_audio_samples(rxp_clock* clock, uint64_t pts) {
+  return rxp_clock_ns_to_samples(pts, clock->samplerate);
+}
+
+/* ---------------------------------------------------------------- */
+
+static uint64_t rxp_clock_samples_to_ns(uint64_t samples, uint64_t samplerate) {
+  return (uint64_t)rxp_time_ns((int64_t)samples, samplerate, 1);
+}
+
+static uint64_t rxp_clock_ns_to_samples(uint64_t pts, uint64_t samplerate) {
+  return (uint64_t)rxp_time_to_count(pts, samplerate, 1);
 }
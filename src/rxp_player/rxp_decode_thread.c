@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rxp_player/rxp_decode_thread.h>
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_decode_thread_run(void* thread);                          /* the thread function which decodes the queued packets */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_decode_thread_init(rxp_decode_thread* t) {
+
+  if (!t) { return -1; }
+
+  memset(t->slots, 0x00, sizeof(t->slots));
+  t->head = 0;
+  t->tail = 0;
+  t->count = 0;
+  t->is_busy = 0;
+  t->must_stop = 0;
+  t->error = 0;
+  t->on_packet = NULL;
+  t->user = NULL;
+  t->npackets = 0;
+  t->nwaits = 0;
+  t->wait_time = 0;
+  t->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+int rxp_decode_thread_start(rxp_decode_thread* t, rxp_decode_thread_callback cb, void* user) {
+
+  if (!t) { return -1; }
+  if (!cb) { return -2; }
+
+  if (0xCAFEBABE == t->is_init) {
+    printf("Error: the decode thread is already running.\n");
+    return -3;
+  }
+
+  if (uv_mutex_init(&t->mutex) != 0) {
+    printf("Error: cannot initialize the decode thread mutex.\n");
+    return -4;
+  }
+
+  if (uv_cond_init(&t->cond) != 0) {
+    printf("Error: cannot initialize the decode thread condition var.\n");
+    uv_mutex_destroy(&t->mutex);
+    return -5;
+  }
+
+  memset(t->slots, 0x00, sizeof(t->slots));
+  t->head = 0;
+  t->tail = 0;
+  t->count = 0;
+  t->is_busy = 0;
+  t->must_stop = 0;
+  t->error = 0;
+  t->on_packet = cb;
+  t->user = user;
+  t->npackets = 0;
+  t->nwaits = 0;
+  t->wait_time = 0;
+  t->is_init = 0xCAFEBABE;
+
+  if (uv_thread_create(&t->thread, rxp_decode_thread_run, (void*)t) != 0) {
+    printf("Error: cannot create the decode thread.\n");
+    uv_cond_destroy(&t->cond);
+    uv_mutex_destroy(&t->mutex);
+    t->is_init = 0xDEADBEEF;
+    return -6;
+  }
+
+  return 0;
+}
+
+int rxp_decode_thread_stop(rxp_decode_thread* t) {
+
+  int i = 0;
+
+  if (!t) { return -1; }
+  if (0xCAFEBABE != t->is_init) { return -2; }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    t->must_stop = 1;
+    uv_cond_broadcast(&t->cond);
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  uv_thread_join(&t->thread);
+
+#if !defined(NDEBUG)
+  printf("Info: decode thread stats, packets: %llu, reader waited %llu times for %llu ns.\n",
+         (unsigned long long)t->npackets,
+         (unsigned long long)t->nwaits,
+         (unsigned long long)t->wait_time);
+#endif
+
+  uv_cond_destroy(&t->cond);
+  uv_mutex_destroy(&t->mutex);
+
+  for (i = 0; i < RXP_DECODE_THREAD_SLOTS; ++i) {
+    free(t->slots[i].data);
+    t->slots[i].data = NULL;
+    t->slots[i].capacity = 0;
+  }
+
+  t->head = 0;
+  t->tail = 0;
+  t->count = 0;
+  t->on_packet = NULL;
+  t->user = NULL;
+  t->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+int rxp_decode_thread_push(rxp_decode_thread* t, void* stream, ogg_packet* packet, uint64_t late_pts) {
+
+  rxp_decode_slot* slot = NULL;
+  unsigned char* data = NULL;
+  uint64_t wait_start = 0;
+
+  if (!t) { return -1; }
+  if (!packet) { return -2; }
+  if (0xCAFEBABE != t->is_init) { return -3; }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    if (RXP_DECODE_THREAD_SLOTS == t->count) {
+      t->nwaits++;
+      wait_start = uv_hrtime();
+      while (0 == t->must_stop && RXP_DECODE_THREAD_SLOTS == t->count) {
+        uv_cond_wait(&t->cond, &t->mutex);
+      }
+      t->wait_time += uv_hrtime() - wait_start;
+    }
+
+    if (t->must_stop) {
+      uv_mutex_unlock(&t->mutex);
+      return -4;
+    }
+
+    slot = &t->slots[t->head];
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  /* only we touch the free slots, so we can copy w/o the lock */
+  if (packet->bytes > slot->capacity) {
+    data = (unsigned char*)realloc(slot->data, packet->bytes);
+    if (!data) {
+      printf("Error: cannot allocate %ld bytes for a queued packet.\n", packet->bytes);
+      return -5;
+    }
+    slot->data = data;
+    slot->capacity = packet->bytes;
+  }
+
+  if (packet->bytes > 0) {
+    memcpy(slot->data, packet->packet, packet->bytes);
+  }
+
+  slot->packet = *packet;
+  slot->packet.packet = slot->data;
+  slot->stream = stream;
+  slot->late_pts = late_pts;
+
+  uv_mutex_lock(&t->mutex);
+  {
+    t->head = (t->head + 1) % RXP_DECODE_THREAD_SLOTS;
+    t->count++;
+    uv_cond_broadcast(&t->cond);
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  return 0;
+}
+
+int rxp_decode_thread_wait(rxp_decode_thread* t) {
+
+  if (!t) { return -1; }
+  if (0xCAFEBABE != t->is_init) { return -2; }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    while (0 != t->count) {
+      uv_cond_wait(&t->cond, &t->mutex);
+    }
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  return 0;
+}
+
+int rxp_decode_thread_flush(rxp_decode_thread* t) {
+
+  if (!t) { return -1; }
+  if (0xCAFEBABE != t->is_init) { return -2; }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    /* we keep the packet that is being decoded, it's removed when the callback returns */
+    t->count = t->is_busy ? 1 : 0;
+    t->head = (t->tail + t->count) % RXP_DECODE_THREAD_SLOTS;
+
+    while (0 != t->count) {
+      uv_cond_wait(&t->cond, &t->mutex);
+    }
+
+    /* the packets that follow the flush start fresh, e.g. after a seek */
+    t->error = 0;
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  return 0;
+}
+
+int rxp_decode_thread_get_stats(rxp_decode_thread* t, uint64_t* npackets, uint64_t* nwaits, uint64_t* wait_time) {
+
+  if (!t) { return -1; }
+  if (!npackets) { return -2; }
+  if (!nwaits) { return -3; }
+  if (!wait_time) { return -4; }
+
+  /* the thread isn't running, nobody changes the counters */
+  if (0xCAFEBABE != t->is_init) {
+    *npackets = t->npackets;
+    *nwaits = t->nwaits;
+    *wait_time = t->wait_time;
+    return 0;
+  }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    *npackets = t->npackets;
+    *nwaits = t->nwaits;
+    *wait_time = t->wait_time;
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  return 0;
+}
+
+int rxp_decode_thread_error(rxp_decode_thread* t) {
+
+  int error = 0;
+
+  if (!t) { return 0; }
+  if (0xCAFEBABE != t->is_init) { return 0; }
+
+  uv_mutex_lock(&t->mutex);
+  {
+    error = t->error;
+  }
+  uv_mutex_unlock(&t->mutex);
+
+  return error;
+}
+
+int rxp_decode_thread_lock(rxp_decode_thread* t) {
+
+  if (!t) { return -1; }
+  if (0xCAFEBABE != t->is_init) { return -2; }
+
+  uv_mutex_lock(&t->mutex);
+
+  return 0;
+}
+
+int rxp_decode_thread_unlock(rxp_decode_thread* t) {
+
+  if (!t) { return -1; }
+  if (0xCAFEBABE != t->is_init) { return -2; }
+
+  uv_mutex_unlock(&t->mutex);
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_decode_thread_run(void* thread) {
+
+  rxp_decode_thread* t = (rxp_decode_thread*)thread;
+  rxp_decode_slot* slot = NULL;
+  int r = 0;
+
+  while (1) {
+
+    uv_mutex_lock(&t->mutex);
+    {
+      while (0 == t->must_stop && 0 == t->count) {
+        uv_cond_wait(&t->cond, &t->mutex);
+      }
+
+      if (t->must_stop) {
+        uv_mutex_unlock(&t->mutex);
+        return;
+      }
+
+      slot = &t->slots[t->tail];
+      t->is_busy = 1;
+    }
+    uv_mutex_unlock(&t->mutex);
+
+    /* the reader doesn't touch this slot until we removed it from the queue */
+    r = t->on_packet(t->user, slot->stream, &slot->packet, slot->late_pts);
+
+    uv_mutex_lock(&t->mutex);
+    {
+      if (r < 0 && 0 == t->error) {
+        t->error = r;
+      }
+      t->is_busy = 0;
+      t->tail = (t->tail + 1) % RXP_DECODE_THREAD_SLOTS;
+      t->count--;
+      t->npackets++;
+      uv_cond_broadcast(&t->cond);
+    }
+    uv_mutex_unlock(&t->mutex);
+  }
+}
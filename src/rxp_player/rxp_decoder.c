@@ -2,21 +2,62 @@
 #include <stdio.h>
 #include <string.h> 
 #include <rxp_player/rxp_decoder.h>
+#include <rxp_player/rxp_time.h>
 #include <rxp_player/rxp_types.h>
 
+#define RXP_DEC_STDIO_CHUNK_SIZE 4096                        /* number of bytes we fread() per call */
+#define RXP_DEC_MMAP_CHUNK_SIZE (64 * 1024)                  /* number of bytes we read from other sources per call; no syscall so we can use bigger chunks */
+#define RXP_DEC_SEEK_CHUNK_SIZE 8192                         /* number of bytes we read per call while bisecting */
+#define RXP_DEC_SEEK_LINEAR_SIZE (64 * 1024)                 /* when the bisection interval is smaller then this, we scan it page by page */
+#define RXP_DEC_MAX_CHANNELS 256                             /* max number of audio channels, used when we trim the decoded audio after a seek */
+#define RXP_DEC_OPUS_PREROLL 3840                            /* opus needs 80ms of audio before the seek position to converge */
+
 /* ---------------------------------------------------------------- */
 
 static int rxp_theora_init();                             
 static int rxp_vorbis_init();
-static int rxp_decoder_read_oggpage(rxp_decoder* decoder, ogg_page* page);
+static int rxp_opus_init(rxp_opus* o);
+static int rxp_decoder_read_oggpage(rxp_decoder* decoder, ogg_page* page);  /* returns 0 when we read a page, 1 when a stream has no new data yet and < 0 on error or at the end */
+static int rxp_decoder_set_ready(rxp_decoder* decoder);                     /* called when we've read all data; sets the state and fires RXP_DEC_EVENT_READY, returns < 0 */
+static int rxp_decoder_streams_ended(rxp_decoder* decoder);                 /* returns 0 when we found streams and all of them received their last page */
 static int rxp_decoder_find_stream(rxp_decoder* decoder, ogg_page* page, rxp_stream** stream); /* stream is set to the stream which was previously created or to one which is allocated */
 static int rxp_decoder_detect_stream_type(rxp_decoder* decoder, rxp_stream* stream, ogg_page* page, ogg_packet* packet);
 static int rxp_decoder_add_stream(rxp_decoder* decoder, rxp_stream* stream);
-static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet);
+static int rxp_decoder_start_link(rxp_decoder* decoder);                    /* frees the streams of the current link when the next link of a chained file starts */
+static int rxp_decoder_select_stream(rxp_decoder* decoder, rxp_stream* stream); /* numbers the track of a new stream and makes it the video or audio stream when it's selected */
+static int rxp_decoder_is_stream_used(rxp_decoder* decoder, rxp_stream* stream); /* returns 0 when we decode the packets of the stream, pages of other streams are dropped */
+static void rxp_stream_free(rxp_stream* stream);                            /* clears the ogg and codec contexts of a stream and frees it */
+static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts);
 static int rxp_decoder_decode_vorbis(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet);
+static int rxp_decoder_decode_skeleton(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet);
+#if defined(RXP_USE_OPUS)
+static int rxp_decoder_decode_opus(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet);
+static int rxp_opus_create_decoder(rxp_opus* o, ogg_packet* packet);        /* parses the OpusHead packet and creates the decoder */
+#endif
+static int rxp_stream_kind(rxp_stream* stream);                             /* returns RXP_DEC_STREAM_VIDEO or RXP_DEC_STREAM_AUDIO for the streams we can decode, else 0 */
+static int rxp_stream_has_audio_headers(rxp_stream* stream);                /* returns 0 when we've read the headers of an audio stream and can decode it */
+static int rxp_stream_has_video_headers(rxp_stream* stream);                /* returns 0 when we've read all headers of a theora stream */
 static int rxp_decoder_trigger_event(rxp_decoder* decoder, int event);
 static char* rxp_decoder_theora_error_to_string(int err);
 static int rxp_decoder_set_audio_info(rxp_decoder* decoder, uint64_t samplerate, int nchannels); /* when an audio stream is found this function should be called with the audio info */
+static int rxp_decoder_can_seek(rxp_decoder* decoder);                      /* returns 0 when we can seek, else the error code of rxp_decoder_seek(); waits for the decode threads */
+static int rxp_decoder_find_seek_offset(rxp_decoder* decoder, uint64_t pts, int64_t* offset);  /* finds the offset from where we need to decode to present the given pts */
+static int rxp_decoder_bisect(rxp_decoder* decoder, rxp_stream* stream, int64_t key, int64_t* offset); /* finds the offset of the last page of the stream with a granule key < key; offset is not changed when there is no such page */
+static int rxp_decoder_next_page(rxp_decoder* decoder, ogg_sync_state* sync, int64_t* pos, int64_t end, ogg_page* page, int64_t* page_offset); /* reads the next page that starts before end, returns 1 when there isn't one */
+static int64_t rxp_decoder_granule_key(rxp_stream* stream, int64_t granule); /* converts a granule into a frame index (theora) or sample (vorbis, opus) */
+static int64_t rxp_decoder_pts_to_sample(rxp_stream* stream, uint64_t pts); /* converts a pts in ns into an audio sample index of the audio stream */
+static uint32_t rxp_decoder_hash_serial(int serial);                        /* returns the bucket for the serial */
+static int rxp_decoder_skip_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts); /* returns 0 when we don't decode the packet because it ends before late_pts */
+static void rxp_decoder_update_quality(rxp_decoder* decoder, rxp_stream* stream, uint64_t late_pts); /* lowers or raises the post-processing level depending on how late the last frame was */
+static int rxp_decoder_count_packets(ogg_page* page, int* is_partial);     /* the number of packets that end on the page and that ogg_stream_pagein() keeps; updates is_partial, see `demux_partial` */
+static void rxp_decoder_on_stripe(void* user, th_ycbcr_buffer buffer, int yfrag0, int yfrag_end); /* is called by libtheora when a stripe has been decoded */
+static int rxp_decoder_demux_packet(rxp_decoder* decoder, rxp_stream* stream, rxp_demux_packet* pkt); /* fills the type, granulepos and pts of the packet that we got from the stream */
+static int rxp_decoder_decode_packet(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts); /* passes the packet to the codec of the stream, late_pts is the `late_pts` of the decoder when we read the packet */
+static int rxp_decoder_on_thread_packet(void* user, void* stream, ogg_packet* packet, uint64_t late_pts); /* is called by the video and audio decode threads with a queued packet */
+static int rxp_decoder_get_thread_error(rxp_decoder* decoder);              /* returns < 0 when the codec failed on one of the decode threads */
+static void rxp_decoder_set_decoded_pts(rxp_decoder* decoder, rxp_stream* stream, int64_t pts); /* sets the decoded pts of the stream while holding the mutex of its decode thread, see rxp_decoder_get_decoded_pts() */
+static rxp_decode_thread* rxp_decoder_get_thread(rxp_decoder* decoder, rxp_stream* stream); /* returns the decode thread of the stream, NULL when we decode its packets on the calling thread */
+static void rxp_decoder_wait_threads(rxp_decoder* decoder, int flush);       /* blocks until the decode threads decoded all queued packets; when flush is 1 we drop them first */
 
 /* ---------------------------------------------------------------- */
 
@@ -44,30 +85,65 @@ int rxp_decoder_init(rxp_decoder* d) {
     return 0;
   }
   
-  if (rxp_theora_init(&d->theora) < 0) {
-    printf("Error: cannot initialize theora decoder.\n");
-    return -2;
-  }
-
-  if (rxp_vorbis_init(&d->vorbis) < 0) {
-    printf("Error: cannot initialize the vorbis decoder.\n");
-    return -3;
-  }
-
   memset((char*)&d->sync_state, 0x00, sizeof(ogg_sync_state));
   if (ogg_sync_init(&d->sync_state) != 0) {
     printf("Error: cannot initialize the ogg sync state.\n");
     return -4;
   }
 
+  if (rxp_io_init(&d->io) < 0) {
+    printf("Error: cannot initialize the io source.\n");
+    return -5;
+  }
+
+  if (rxp_index_init(&d->index) < 0) {
+    printf("Error: cannot initialize the seek index.\n");
+    return -6;
+  }
+
+  if (rxp_framer_init(&d->framer) < 0) {
+    printf("Error: cannot initialize the page framer.\n");
+    return -7;
+  }
+
+  if (rxp_decode_thread_init(&d->video_thread) < 0
+      || rxp_decode_thread_init(&d->audio_thread) < 0)
+    {
+      printf("Error: cannot initialize the decode threads.\n");
+      return -8;
+    }
+
   d->streams = NULL;
+  memset(d->stream_table, 0x00, sizeof(d->stream_table));
+  d->video = NULL;
+  d->audio = NULL;
+  d->video_track = 0;
+  d->audio_track = 0;
+  d->stream_mask = RXP_DEC_STREAM_ALL;
+  d->late_pts = 0;
+  d->pp_level = -1;
+  d->nframes_skipped = 0;
+  d->chain_pts = 0;
+  d->link = 0;
+  d->demux_stream = NULL;
+  d->use_threads = 0;
+  d->readahead_size = RXP_READAHEAD_DEFAULT_SIZE;
+  d->file_size = 0;
+  d->duration = 0;
+  d->io_mode = RXP_IO_MMAP;
   d->user = NULL;
   d->on_audio = NULL;
+  d->on_audio_interleaved = NULL;
   d->on_theora = NULL;
+  d->on_theora_stripe = NULL;
+  d->on_theora_dup = NULL;
   d->on_event = NULL;
   d->state = RXP_NONE;          
+  d->seek_pts = 0;
+  d->seek_offset = -1;
   d->samplerate = 0;
   d->nchannels = 0;
+  d->pix_fmt = 0;
   d->is_init = 0xCAFEBABE;
 
   return 0;
@@ -85,39 +161,29 @@ int rxp_decoder_clear(rxp_decoder* d) {
     return 0;
   }
 
+  /* the decode threads may still use the streams */
+  rxp_decode_thread_stop(&d->video_thread);
+  rxp_decode_thread_stop(&d->audio_thread);
+
   stream = d->streams;
 
   while (stream) {
     next_stream = stream->next;
-    ogg_stream_clear(&stream->stream_state);
-    free(stream);
+    rxp_stream_free(stream);
     stream = next_stream;
   }
 
   ogg_sync_clear(&d->sync_state);
-  
-  /* clear theora related */
-  if (d->theora.ctx) { 
-    th_setup_free(d->theora.setup);
-    th_decode_free(d->theora.ctx);
-    d->theora.ctx = NULL;
-    d->theora.setup = NULL;
-  }
-
-  th_comment_clear(&d->theora.comment);
-  th_info_clear(&d->theora.info);
 
-  /* clear vorbis related */
-  if (0xCAFEBABE == d->vorbis.is_dsp_init) {
-    vorbis_block_clear(&d->vorbis.block);
-    vorbis_dsp_clear(&d->vorbis.state);
-    d->vorbis.is_dsp_init = 0xDEADBEEF;
-  }
-
-  vorbis_comment_clear(&d->vorbis.comment);
-  vorbis_info_clear(&d->vorbis.info);
+  rxp_index_clear(&d->index);
 
   d->streams = NULL;
+  memset(d->stream_table, 0x00, sizeof(d->stream_table));
+  d->video = NULL;
+  d->audio = NULL;
+  d->chain_pts = 0;
+  d->link = 0;
+  d->demux_stream = NULL;
   d->state = RXP_NONE;
   d->is_init = 0xDEADBEEF;
 
@@ -137,72 +203,323 @@ rxp_stream* rxp_stream_alloc() {
   s->eos = 0;
   s->serial = -1;
   s->type = RXP_NONE;
-  s->theora = NULL;
+  s->is_ignored = 0;
+  s->seek_state = RXP_SEEK_NONE;
+  s->seek_granule = -1;
+  s->track = -1;
+  s->demux_frame = 0;
+  s->demux_keyframe = 0;
+  s->demux_blocksize = 0;
+  s->demux_partial = 0;
+  s->hash_next = NULL;
   s->next = NULL;
 
+  rxp_theora_init(&s->theora);
+  rxp_vorbis_init(&s->vorbis);
+  rxp_opus_init(&s->opus);
+
   return s;
 }
 
 int rxp_decoder_open_file(rxp_decoder* decoder, char* filepath) {
-  
-  long size = 0;
 
+  rxp_io io;
+  char indexpath[1024];
+  int r = 0;
+  
   if (!decoder) { return -1; } 
   if (!filepath) { return -2; } 
 
-  /* try to open the file */
-  decoder->fp = fopen(filepath, "rb");
-  if (!decoder->fp) { 
-    printf("Error: cannot read file: %s\n", filepath);
+  if (0 == rxp_decoder_is_open(decoder)) {
+    printf("Error: the decoder has already opened a file, first call rxp_decoder_close_file().\n");
     return -3;
   }
 
-  /* find size */
-  if (0 != fseek(decoder->fp, 0, SEEK_END)) {
-    printf("Error: failed to seek the end of the video file.\n");
+  if (rxp_io_open_file(&io, filepath, decoder->io_mode, decoder->readahead_size) < 0) {
     return -4;
   }
 
-  size = ftell(decoder->fp);
-  if (-1L == size) {
-    printf("Error: failed to get the SEEK_END position from the video file.\n");
-    return -5;
-    
+  /* use the seek index when there is an up to date sidecar; a stream is still being written so it can't have one */
+  if (RXP_IO_STREAM != io.mode
+      && 0 == rxp_index_get_path(filepath, indexpath, sizeof(indexpath))
+      && 0 == rxp_index_load(&decoder->index, indexpath, filepath))
+    {
+      decoder->duration = decoder->index.duration;
+#if !defined(NDEBUG)
+      printf("Info: using the seek index %s, duration: %llu ns.\n", indexpath, (unsigned long long)decoder->duration);
+#endif
+    }
+
+  /* rxp_decoder_open_io() closes the io when it fails */
+  r = rxp_decoder_open_io(decoder, &io);
+  if (r < 0) {
+    rxp_index_clear(&decoder->index);
+    decoder->duration = 0;
+    return r;
   }
 
-  if (0 != fseek(decoder->fp, 0, SEEK_SET)) {
-    printf("Error: failed to set the SEEK_SET position of the video file.\n");
-    return -6;
+  return 0;
+}
+
+int rxp_decoder_open_io(rxp_decoder* decoder, rxp_io* io) {
+
+  const uint8_t* data = NULL;
+  uint64_t nbytes = 0;
+
+  if (!decoder) { return -1; } 
+  if (!io) { return -2; } 
+
+  if (0 == rxp_decoder_is_open(decoder)) {
+    printf("Error: the decoder has already opened a source, first call rxp_decoder_close_file().\n");
+    return -3;
   }
 
-  if (size <= 0) {
-    printf("Error: the file is empty.\n");
-    return -7;
+  if (0 != rxp_io_is_open(io)) {
+    printf("Error: the given io source has no read callback.\n");
+    return -4;
   }
 
-  decoder->file_size = size;
+  if (1 == decoder->use_threads && 0xCAFEBABE != decoder->video_thread.is_init) {
+    if (rxp_decode_thread_start(&decoder->video_thread, rxp_decoder_on_thread_packet, decoder) < 0
+        || rxp_decode_thread_start(&decoder->audio_thread, rxp_decoder_on_thread_packet, decoder) < 0)
+      {
+        printf("Error: cannot start the decode threads.\n");
+        rxp_decode_thread_stop(&decoder->video_thread);
+        rxp_io_close(io);
+        return -6;
+      }
+  }
+
+  decoder->io = *io;
+  decoder->file_size = rxp_io_size(&decoder->io);
+
+  /* memory backed sources don't need the ogg sync layer */
+  data = rxp_io_get_data(&decoder->io, &nbytes);
+  if (NULL != data && rxp_framer_open(&decoder->framer, data, nbytes) < 0) {
+    printf("Error: cannot open the page framer.\n");
+    rxp_io_close(&decoder->io);
+    rxp_io_init(io); /* the caller's copy is closed too */
+    decoder->file_size = 0;
+    return -5;
+  }
   decoder->state |= RXP_DEC_STATE_DECODING;
-  
+
   return 0;
 }
 
 int rxp_decoder_close_file(rxp_decoder* decoder) {
 
   if (!decoder) { return -1; } 
-  if (!decoder->fp) { return -2; } 
+  if (0 != rxp_decoder_is_open(decoder)) { return -2; } 
 
-  if (fclose(decoder->fp) != 0) {
-    printf("Error: fclose() failed in rxp_decoder_close_file(). \n");
+  rxp_decoder_wait_threads(decoder, 1);
+
+  if (rxp_io_close(&decoder->io) < 0) {
+    printf("Error: cannot close the io source in rxp_decoder_close_file().\n");
     return -3;
   }
 
-  decoder->fp = NULL;
+  rxp_index_clear(&decoder->index);
+  rxp_framer_init(&decoder->framer);
 
   decoder->state |= RXP_DEC_STATE_READY;
 
   return 0;
 }
 
+/* closes the source when it's still open and resets the streams and codec state so we can open the next file, w/o stopping the decode threads */
+int rxp_decoder_reset(rxp_decoder* decoder) {
+
+  rxp_stream* stream = NULL;
+  rxp_stream* next_stream = NULL;
+
+  if (!decoder) { return -1; } 
+
+  if (0xCAFEBABE != decoder->is_init) {
+    printf("Error: cannot reset the decoder because it's not initialized.\n");
+    return -2;
+  }
+
+  if (0 == rxp_decoder_is_open(decoder) && rxp_decoder_close_file(decoder) < 0) {
+    return -3;
+  }
+
+  /* the decode threads may still use the streams when the source was closed w/o flushing them */
+  rxp_decoder_wait_threads(decoder, 1);
+
+  stream = decoder->streams;
+
+  while (stream) {
+    next_stream = stream->next;
+    rxp_stream_free(stream);
+    stream = next_stream;
+  }
+
+  ogg_sync_reset(&decoder->sync_state);
+
+  decoder->streams = NULL;
+  memset(decoder->stream_table, 0x00, sizeof(decoder->stream_table));
+  decoder->video = NULL;
+  decoder->audio = NULL;
+  decoder->demux_stream = NULL;
+  decoder->file_size = 0;
+  decoder->duration = 0;
+  decoder->chain_pts = 0;
+  decoder->late_pts = 0;
+  decoder->nframes_skipped = 0;
+  decoder->link = 0;
+  decoder->state = RXP_NONE;
+  decoder->seek_pts = 0;
+  decoder->seek_offset = -1;
+  decoder->samplerate = 0;
+  decoder->nchannels = 0;
+  decoder->pix_fmt = 0;
+
+  return 0;
+}
+
+int rxp_decoder_is_open(rxp_decoder* decoder) {
+  if (!decoder) { return -1; } 
+  return rxp_io_is_open(&decoder->io);
+}
+
+int rxp_decoder_seek(rxp_decoder* decoder, uint64_t pts) {
+
+  int64_t offset = 0;
+  int r = 0;
+
+  r = rxp_decoder_can_seek(decoder);
+  if (r < 0) {
+    return r;
+  }
+
+  /* bisecting does many small seeks+reads; restarting the read-ahead thread for each of them is slower than reading directly */
+  if (rxp_io_pause_readahead(&decoder->io, 1) < 0) {
+    printf("Error: cannot pause the read-ahead before seeking.\n");
+    return -9;
+  }
+
+  r = rxp_decoder_find_seek_offset(decoder, pts, &offset);
+  rxp_io_pause_readahead(&decoder->io, 0);
+
+  if (r < 0) {
+    printf("Error: cannot find the seek offset for %llu.\n", (unsigned long long)pts);
+    return -5;
+  }
+
+  return rxp_decoder_seek_offset(decoder, pts, offset);
+}
+
+int rxp_decoder_seek_offset(rxp_decoder* decoder, uint64_t pts, int64_t offset) {
+
+  rxp_stream* stream = NULL;
+  int r = 0;
+
+  r = rxp_decoder_can_seek(decoder);
+  if (r < 0) {
+    return r;
+  }
+
+  if (offset < 0 || offset > decoder->file_size) {
+    printf("Error: invalid seek offset %lld.\n", (long long)offset);
+    return -10;
+  }
+
+  /* the next read restarts the read-ahead thread at this offset */
+  if (rxp_io_seek(&decoder->io, offset, SEEK_SET) < 0) {
+    printf("Error: cannot seek the source to %lld.\n", (long long)offset);
+    return -6;
+  }
+
+  if (0xCAFEBABE == decoder->framer.is_init && rxp_framer_seek(&decoder->framer, (uint64_t)offset) < 0) {
+    printf("Error: cannot seek the page framer to %lld.\n", (long long)offset);
+    return -8;
+  }
+
+  /* flush everything we buffered for the old position */
+  ogg_sync_reset(&decoder->sync_state);
+
+  stream = decoder->streams;
+  while (stream) {
+    ogg_stream_reset(&stream->stream_state);
+    stream->demux_partial = 0;
+    stream->eos = 0;
+    rxp_decoder_set_decoded_pts(decoder, stream, 0);
+    stream->seek_state = RXP_SEEK_SYNC;
+    if (0xCAFEBABE == stream->vorbis.is_dsp_init) {
+      vorbis_synthesis_restart(&stream->vorbis.state);
+    }
+#if defined(RXP_USE_OPUS)
+    if (NULL != stream->opus.ctx) {
+      opus_multistream_decoder_ctl(stream->opus.ctx, OPUS_RESET_STATE);
+      stream->opus.skip = 0;
+    }
+#endif
+    stream = stream->next;
+  }
+
+  decoder->seek_pts = pts;
+  decoder->seek_offset = offset;
+  decoder->demux_stream = NULL;
+  decoder->state &= ~(RXP_DEC_STATE_WAITING | RXP_DEC_STATE_READY);
+
+#if !defined(NDEBUG)
+  printf("Info: seeking to %llu ns, decoding from offset %lld.\n", (unsigned long long)pts, (long long)offset);
+#endif
+
+  return 0;
+}
+
+int rxp_decoder_select_track(rxp_decoder* decoder, int type, int track) {
+
+  if (!decoder) { return -1; }
+
+  if (track < 0) {
+    printf("Error: invalid track %d.\n", track);
+    return -2;
+  }
+
+  if (RXP_THEORA == type) {
+    if (NULL != decoder->video) {
+      printf("Error: cannot select the video track after we've found the video stream.\n");
+      return -3;
+    }
+    decoder->video_track = track;
+  }
+  else if (RXP_VORBIS == type || RXP_OPUS == type) {
+    if (NULL != decoder->audio) {
+      printf("Error: cannot select the audio track after we've found the audio stream.\n");
+      return -4;
+    }
+    decoder->audio_track = track;
+  }
+  else {
+    printf("Error: can only select RXP_THEORA, RXP_VORBIS or RXP_OPUS tracks.\n");
+    return -5;
+  }
+
+  return 0;
+}
+
+int rxp_decoder_enable_streams(rxp_decoder* decoder, int mask) {
+
+  if (!decoder) { return -1; }
+
+  if (0 == (mask & RXP_DEC_STREAM_ALL) || 0 != (mask & ~RXP_DEC_STREAM_ALL)) {
+    printf("Error: invalid stream mask %d.\n", mask);
+    return -2;
+  }
+
+  if (NULL != decoder->video || NULL != decoder->audio) {
+    printf("Error: cannot change the stream mask after we've found the streams.\n");
+    return -3;
+  }
+
+  decoder->stream_mask = mask;
+
+  return 0;
+}
+
 int rxp_decoder_decode(rxp_decoder* decoder) {
 
   /* retrieve an ogg page */
@@ -210,27 +527,44 @@ int rxp_decoder_decode(rxp_decoder* decoder) {
   ogg_page page;
   ogg_packet packet;
   rxp_stream* stream = NULL;
+  rxp_decode_thread* thread = NULL;
 
   if (!decoder) { return -1; }
-  if (!decoder->fp) { return -2; } 
+  if (0 != rxp_decoder_is_open(decoder)) { return -2; } 
 
   if (0xCAFEBABE != decoder->is_init) {
     printf("Error: trying to decode, but the decoder is not initialized.\n");
     return -100;
   }
 
+  /* a codec that failed on a decode thread fails this call, as when we decode here */
+  if (rxp_decoder_get_thread_error(decoder) < 0) {
+    return -8;
+  }
+
   /* reaad an page */
-  if (rxp_decoder_read_oggpage(decoder, &page) < 0) {
+  r = rxp_decoder_read_oggpage(decoder, &page);
+  if (r < 0) {
     printf("Error: cannot read next ogg_page, in rxp_decoder_decode().\n");
     return -3;
   }
 
+  /* we're reading a stream which has no new data yet */
+  if (1 == r) {
+    return 1;
+  }
+
   /* find the stream of create a new one */
   if (rxp_decoder_find_stream(decoder, &page, &stream) < 0) {
     printf("Error: cannot find stream, in rxp_decoder_decode().\n");
     return -4;
   }
 
+  /* the pages of tracks that we don't decode aren't even copied into the stream */
+  if (0 != rxp_decoder_is_stream_used(decoder, stream)) {
+    return 0;
+  }
+
   /* feed the page for this stream */
   r = ogg_stream_pagein(&stream->stream_state, &page);
   if(r != 0) {
@@ -250,23 +584,29 @@ int rxp_decoder_decode(rxp_decoder* decoder) {
   if (stream->type == RXP_NONE) {
     if (rxp_decoder_detect_stream_type(decoder, stream, &page, &packet) < 0) {
 #if !defined(NDEBUG)
-      printf("Warning: Cannot find stream type\n");
+      printf("Warning: Cannot find stream type of stream %d, we ignore it.\n", stream->serial);
 #endif
-      return 0; /* < 0 means we should fail.. we simply ignore this stream by returning 0 (= means everything is still ok).*/
+      /* we never page in its pages again, so drop what it buffered */
+      stream->is_ignored = 1;
+      ogg_stream_reset(&stream->stream_state);
+      return 0; 
+    }
+    rxp_decoder_select_stream(decoder, stream);
+    if (0 != rxp_decoder_is_stream_used(decoder, stream)) {
+      return 0;
     }
   }
 
   /* decode as many packets as possible (need to do this in a loop, else you'll leak memory) */
+  thread = rxp_decoder_get_thread(decoder, stream);
   do {
-    if (stream->type == RXP_VORBIS) {
-      rxp_decoder_decode_vorbis(decoder, stream, &packet);
-    }
-    else if (stream->type == RXP_THEORA) {
-      rxp_decoder_decode_theora(decoder, stream, &packet);
+    if (NULL != thread) {
+      if (rxp_decode_thread_push(thread, stream, &packet, decoder->late_pts) < 0) {
+        printf("Error: cannot queue a packet for the decode thread.\n");
+        return -9;
+      }
     }
-
-    else {
-      printf("Error: unknown stream type.\n");
+    else if (rxp_decoder_decode_packet(decoder, stream, &packet, decoder->late_pts) < 0) {
       return -8;
     }
   } while (ogg_stream_packetout(&stream->stream_state, &packet) == 1);
@@ -274,6 +614,138 @@ int rxp_decoder_decode(rxp_decoder* decoder) {
   return 0;
 }
 
+int rxp_decoder_demux(rxp_decoder* decoder, rxp_demux_packet* pkt) {
+
+  int r = 0;
+  int npackets = 0;
+  ogg_page page;
+  rxp_stream* stream = NULL;
+
+  if (!decoder) { return -1; }
+  if (!pkt) { return -2; }
+  if (0 != rxp_decoder_is_open(decoder)) { return -3; } 
+
+  if (0xCAFEBABE != decoder->is_init) {
+    printf("Error: trying to demux, but the decoder is not initialized.\n");
+    return -100;
+  }
+
+  /* we already returned all packets */
+  if (decoder->state & RXP_DEC_STATE_READY) {
+    return -4;
+  }
+
+  while (1) {
+
+    /* first return the packets of the last page */
+    if (NULL != decoder->demux_stream) {
+
+      stream = decoder->demux_stream;
+      r = ogg_stream_packetout(&stream->stream_state, &pkt->packet);
+
+      if (1 == r) {
+        return rxp_decoder_demux_packet(decoder, stream, pkt);
+      }
+
+      /* a gap in the data; we don't know the position until the next granulepos */
+      if (r < 0) {
+        stream->seek_state = RXP_SEEK_SYNC;
+        continue;
+      }
+
+      decoder->demux_stream = NULL;
+    }
+
+    r = rxp_decoder_read_oggpage(decoder, &page);
+    if (r < 0) {
+      if (0 == (decoder->state & RXP_DEC_STATE_READY)) {
+        printf("Error: cannot read next ogg_page, in rxp_decoder_demux().\n");
+      }
+      return r;
+    }
+
+    /* we're reading a stream which has no new data yet */
+    if (1 == r) {
+      return 1;
+    }
+
+    if (rxp_decoder_find_stream(decoder, &page, &stream) < 0) {
+      printf("Error: cannot find stream, in rxp_decoder_demux().\n");
+      return -5;
+    }
+
+    if (0 != ogg_stream_pagein(&stream->stream_state, &page)) {
+      printf("Error: cannot feed a page into the stream: %d\n", stream->serial);
+      return -6;
+    }
+
+    npackets = rxp_decoder_count_packets(&page, &stream->demux_partial);
+
+    /* 
+       after a seek the granule of the page is the frame of the last packet that 
+       ends on it; each theora packet is one frame so we can count back to the 
+       first one. The keyframe stays unknown until we see one.
+    */
+    if (RXP_THEORA == stream->type 
+        && RXP_SEEK_NONE != stream->seek_state 
+        && ogg_page_granulepos(&page) >= 0)
+      {
+        stream->demux_frame = rxp_time_theora_count(ogg_page_granulepos(&page), stream->theora.info.keyframe_granule_shift);
+        stream->demux_frame -= npackets;
+        stream->demux_keyframe = -1;
+        stream->seek_state = RXP_SEEK_NONE;
+      }
+
+    decoder->demux_stream = stream;
+  }
+
+  return 0;
+}
+
+int rxp_decoder_get_stats(rxp_decoder* decoder, rxp_decoder_stats* stats) {
+
+  if (!decoder) { return -1; }
+  if (!stats) { return -2; }
+
+  memset((char*)stats, 0x00, sizeof(rxp_decoder_stats));
+
+  /* the decoding thread stops and starts the read-ahead thread, so we must be called on it */
+  if (RXP_IO_READAHEAD == decoder->io.mode) {
+    rxp_readahead_get_stats(&decoder->io.readahead, &stats->io_nreads, &stats->io_nwaits, &stats->io_wait_time);
+  }
+
+  rxp_decode_thread_get_stats(&decoder->video_thread, &stats->video_npackets, &stats->video_nwaits, &stats->video_wait_time);
+  rxp_decode_thread_get_stats(&decoder->audio_thread, &stats->audio_npackets, &stats->audio_nwaits, &stats->audio_wait_time);
+
+  /* the video thread counts the skipped frames */
+  rxp_decode_thread_lock(&decoder->video_thread);
+  {
+    stats->nframes_skipped = decoder->nframes_skipped;
+  }
+  rxp_decode_thread_unlock(&decoder->video_thread);
+
+  return 0;
+}
+
+/* the decode thread of the stream writes the decoded pts while holding its mutex */
+int64_t rxp_decoder_get_decoded_pts(rxp_decoder* decoder, rxp_stream* stream) {
+
+  rxp_decode_thread* thread = NULL;
+  int64_t pts = 0;
+
+  if (!decoder) { return 0; }
+  if (!stream) { return 0; }
+
+  thread = rxp_decoder_get_thread(decoder, stream);
+  rxp_decode_thread_lock(thread);
+  {
+    pts = stream->decoded_pts;
+  }
+  rxp_decode_thread_unlock(thread);
+
+  return pts;
+}
+
 /* ---------------------------------------------------------------- */
 
 static int rxp_theora_init(rxp_theora* t) {
@@ -282,6 +754,12 @@ static int rxp_theora_init(rxp_theora* t) {
 
   t->setup = NULL;
   t->ctx = NULL;
+  t->nframes = -1;
+  t->is_skipping = 0;
+  t->pp_level = 0;
+  t->pp_level_max = 0;
+  t->nframes_late = 0;
+  t->nframes_on_time = 0;
 
   th_comment_init(&t->comment); 
   th_info_init(&t->info);       
@@ -302,48 +780,79 @@ static int rxp_vorbis_init(rxp_vorbis* v) {
   return 0;
 }
 
-/* returns < 0, on error or when we reached the end of the file */
+static int rxp_opus_init(rxp_opus* o) {
+
+  if (!o) { return -1; } 
+
+  o->ctx = NULL;
+  o->pcm = NULL;
+  o->planar = NULL;
+  o->channels = 0;
+  o->preskip = 0;
+  o->skip = 0;
+  o->num_header_packets = 0;
+
+  return 0;
+}
+
+/* returns < 0, on error or when we reached the end of the file. returns 1 when the 
+   source is a stream that has no new data yet; the caller should try again later. */
 static int rxp_decoder_read_oggpage(rxp_decoder* decoder, ogg_page* page) {
 
-  static size_t ntotal = 0; /* @todo - I guess we can remove this? */
   int r = 0;
-  size_t read = 0;
+  int read = 0;
+  uint32_t chunk_size = (RXP_IO_STDIO == decoder->io.mode) ? RXP_DEC_STDIO_CHUNK_SIZE : RXP_DEC_MMAP_CHUNK_SIZE;
 
   if (decoder->state & RXP_DEC_STATE_READY) { 
     printf("Error: cannot read ogg page because state is invalid, in rxp_decoder_read_oggpage().\n");
     return -1;
   }
 
-  if (!decoder->fp) {
+  if (0 != rxp_decoder_is_open(decoder)) {
     printf("Error: cannot read an oggpage, file hasn't been opened.\n");
     return -2;
   }
+
+  /* the page points into the source data; we only let the source know how far we've read */
+  if (0xCAFEBABE == decoder->framer.is_init) {
+    if (0 != rxp_framer_next(&decoder->framer, page, NULL)) {
+      return rxp_decoder_set_ready(decoder);
+    }
+    rxp_io_consume(&decoder->io, decoder->framer.pos);
+    return 0;
+  }
   
   while (ogg_sync_pageout(&decoder->sync_state, page) != 1) {
 
     /* obtain some memory that we can use to store the file data */
-    char* buffer = ogg_sync_buffer(&decoder->sync_state, 4096);
+    char* buffer = ogg_sync_buffer(&decoder->sync_state, chunk_size);
     if (!buffer) {
       printf("Error: ogg_sync_buffer returned an invalid buffer; non mem?\n");
       return -3;
     }
 
     /* read a chunk of data */
-    read = fread(buffer, 1, 4096, decoder->fp); 
-    if (read == 0) {
-      
-      decoder->state |= RXP_DEC_STATE_READY;
-      decoder->state &= ~RXP_DEC_STATE_DECODING;
+    read = rxp_io_read(&decoder->io, buffer, chunk_size);
 
-      if (rxp_decoder_trigger_event(decoder, RXP_DEC_EVENT_READY) < 0) {
-        printf("Error: something went wrong when triggering a decoder event.\n");
-        return -1;
-      }
+    /* also when all streams ended; the next link of a chained stream may still follow */
+    if (RXP_IO_AGAIN == read) {
+      decoder->state |= RXP_DEC_STATE_WAITING;
+      return 1;
+    }
 
-      return -4;
+    /* a read error also ends the decoding, but isn't the end of the file */
+    if (read < 0) {
+      printf("Error: cannot read from the source: %d, we stop decoding.\n", read);
+      rxp_decoder_set_ready(decoder);
+      return -6;
+    }
+
+    if (0 == read) {
+      return rxp_decoder_set_ready(decoder);
     }
 
-    ntotal += read;
+    decoder->state &= ~RXP_DEC_STATE_WAITING;
+
     r = ogg_sync_wrote(&decoder->sync_state, read);
 
     if (r != 0) {
@@ -354,15 +863,479 @@ static int rxp_decoder_read_oggpage(rxp_decoder* decoder, ogg_page* page) {
   return 0;
 }
 
-static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet) {
+/* a stream source only ends when it returns 0, e.g. when the writer closed the FIFO or after `stream_timeout` */
+static int rxp_decoder_set_ready(rxp_decoder* decoder) {
 
-  ogg_int64_t granulepos = -1;
-  th_ycbcr_buffer buffer;
-  int r = -1;
-  rxp_theora* theora = &decoder->theora;
-  double time_s;
+  /* we're only ready when the decode threads decoded everything we've read */
+  rxp_decoder_wait_threads(decoder, 0);
 
-  if(theora->ctx == NULL) {
+  decoder->state |= RXP_DEC_STATE_READY;
+  decoder->state &= ~RXP_DEC_STATE_DECODING;
+
+  if (rxp_decoder_trigger_event(decoder, RXP_DEC_EVENT_READY) < 0) {
+    printf("Error: something went wrong when triggering a decoder event.\n");
+    return -1;
+  }
+
+  return -4;
+}
+
+static int rxp_decoder_streams_ended(rxp_decoder* decoder) {
+
+  rxp_stream* stream = decoder->streams;
+
+  if (!stream) {
+    return -1;
+  }
+
+  while (stream) {
+    if (0 == stream->eos) {
+      return -2;
+    }
+    stream = stream->next;
+  }
+
+  return 0;
+}
+
+static int rxp_decoder_can_seek(rxp_decoder* decoder) {
+
+  if (!decoder) { return -1; }
+  if (0 != rxp_decoder_is_open(decoder)) { return -2; } 
+
+  if (!decoder->io.seek || decoder->file_size <= 0) {
+    printf("Error: cannot seek, the source is not seekable.\n");
+    return -3;
+  }
+
+  /* the queued packets are from the old position and the decode threads must not touch the codecs while we reset them */
+  rxp_decoder_wait_threads(decoder, 1);
+
+  if ((NULL == decoder->video || 0 != rxp_stream_has_video_headers(decoder->video))
+      && (NULL == decoder->audio || 0 != rxp_stream_has_audio_headers(decoder->audio)))
+    {
+      printf("Error: cannot seek before we've decoded the headers.\n");
+      return -4;
+    }
+
+  if (decoder->link > 0) {
+    printf("Error: cannot seek in a chained file after the first link.\n");
+    return -7;
+  }
+
+  return 0;
+}
+
+/* 
+   We decode from the first page that we need for both streams. For theora 
+   that is the page before the keyframe of the frame at pts. The granulepos
+   of a theora page contains the frame number of the last keyframe in the 
+   upper bits (see the granule shift) so we first find the page with the frame 
+   at pts and then the page before its keyframe. For vorbis we need one page 
+   before the pts so we can get the exact sample position and overlap; opus
+   needs RXP_DEC_OPUS_PREROLL samples before the pts. When we have a seek 
+   index we don't need to bisect.
+*/
+static int rxp_decoder_find_seek_offset(rxp_decoder* decoder, uint64_t pts, int64_t* offset) {
+
+  rxp_stream* stream = decoder->streams;
+  th_info* info = NULL;
+  int64_t stream_offset = 0;
+  int64_t frame = 0;
+  int64_t granule = 0;
+  int64_t sample = 0;
+  int shift = 0;
+
+  if (decoder->index.nstreams > 0 && 0 == rxp_index_find(&decoder->index, pts, offset)) {
+    return 0;
+  }
+
+  *offset = decoder->file_size;
+
+  while (stream) {
+
+    stream_offset = 0;
+    info = &stream->theora.info;
+
+    if (stream == decoder->video && 0 == rxp_stream_has_video_headers(stream) && info->fps_numerator > 0) {
+
+      /* find the page with the frame that should be visible at pts */
+      stream->seek_granule = -1;
+      frame = rxp_time_to_count(pts, info->fps_numerator, info->fps_denominator);
+      if (rxp_decoder_bisect(decoder, stream, frame + 1, &stream_offset) < 0) {
+        return -1;
+      }
+
+      /* the page before the keyframe of that page */
+      if (stream->seek_granule >= 0) {
+        granule = stream->seek_granule;
+        shift = info->keyframe_granule_shift;
+        frame = rxp_decoder_granule_key(stream, (granule >> shift) << shift);
+        stream_offset = 0;
+        if (rxp_decoder_bisect(decoder, stream, frame, &stream_offset) < 0) {
+          return -2;
+        }
+      }
+    }
+    else if (stream == decoder->audio && 0 == rxp_stream_has_audio_headers(stream)) {
+      sample = rxp_decoder_pts_to_sample(stream, pts);
+      if (RXP_OPUS == stream->type) {
+        sample = (sample > RXP_DEC_OPUS_PREROLL) ? (sample - RXP_DEC_OPUS_PREROLL) : 0;
+      }
+      if (rxp_decoder_bisect(decoder, stream, sample, &stream_offset) < 0) {
+        return -3;
+      }
+    }
+    else {
+      stream = stream->next;
+      continue;
+    }
+
+    if (stream_offset < *offset) {
+      *offset = stream_offset;
+    }
+
+    stream = stream->next;
+  }
+
+  if (*offset >= decoder->file_size) {
+    *offset = 0;
+  }
+
+  return 0;
+}
+
+static int rxp_decoder_bisect(rxp_decoder* decoder, rxp_stream* stream, int64_t key, int64_t* offset) {
+
+  ogg_sync_state sync;
+  ogg_page page;
+  int64_t begin = 0;
+  int64_t end = decoder->file_size;
+  int64_t mid = 0;
+  int64_t pos = 0;
+  int64_t page_offset = 0;
+  int64_t granule = 0;
+  int found = 0;
+  int r = 0;
+
+  if (0 != ogg_sync_init(&sync)) {
+    return -1;
+  }
+
+  /* bisect until the interval is small enough to scan */
+  while (end - begin > RXP_DEC_SEEK_LINEAR_SIZE) {
+
+    mid = begin + (end - begin) / 2;
+    pos = mid;
+    found = 0;
+
+    ogg_sync_reset(&sync);
+    if (rxp_io_seek(&decoder->io, mid, SEEK_SET) < 0) {
+      r = -2;
+      goto done;
+    }
+
+    while (0 == (r = rxp_decoder_next_page(decoder, &sync, &pos, end, &page, &page_offset))) {
+      if (ogg_page_serialno(&page) == stream->serial && ogg_page_granulepos(&page) >= 0) {
+        found = 1;
+        break;
+      }
+    }
+
+    if (r < 0) {
+      goto done;
+    }
+
+    if (0 == found) {
+      end = mid;
+      continue;
+    }
+
+    granule = ogg_page_granulepos(&page);
+    if (rxp_decoder_granule_key(stream, granule) < key) {
+      *offset = page_offset;
+      stream->seek_granule = granule;
+      begin = pos;
+    }
+    else {
+      end = mid;
+    }
+  }
+
+  /* scan the rest */
+  pos = begin;
+  ogg_sync_reset(&sync);
+
+  if (rxp_io_seek(&decoder->io, begin, SEEK_SET) < 0) {
+    r = -3;
+    goto done;
+  }
+
+  while (0 == (r = rxp_decoder_next_page(decoder, &sync, &pos, end, &page, &page_offset))) {
+
+    if (ogg_page_serialno(&page) != stream->serial) {
+      continue;
+    }
+
+    granule = ogg_page_granulepos(&page);
+    if (granule < 0) {
+      continue;
+    }
+
+    if (rxp_decoder_granule_key(stream, granule) >= key) {
+      break;
+    }
+
+    *offset = page_offset;
+    stream->seek_granule = granule;
+  }
+
+  r = (r < 0) ? r : 0;
+
+ done:
+  ogg_sync_clear(&sync);
+  return r;
+}
+
+static int rxp_decoder_next_page(rxp_decoder* decoder, 
+                                 ogg_sync_state* sync, 
+                                 int64_t* pos, 
+                                 int64_t end, 
+                                 ogg_page* page, 
+                                 int64_t* page_offset) 
+{
+  long n = 0;
+  int read = 0;
+  char* buffer = NULL;
+  rxp_framer framer;
+
+  /* use a copy of the framer so we don't change the decoding position */
+  if (0xCAFEBABE == decoder->framer.is_init) {
+    framer = decoder->framer;
+    if (*pos >= end || rxp_framer_seek(&framer, (uint64_t)*pos) < 0) {
+      return 1;
+    }
+    if (0 != rxp_framer_next(&framer, page, page_offset) || *page_offset >= end) {
+      *pos = end;
+      return 1;
+    }
+    *pos = (int64_t)framer.pos;
+    return 0;
+  }
+
+  while (*pos < end) {
+
+    n = ogg_sync_pageseek(sync, page);
+
+    if (n < 0) {
+      /* skipped bytes that are not part of a page */
+      *pos += -n;
+      continue;
+    }
+
+    if (n > 0) {
+      *page_offset = *pos;
+      *pos += n;
+      return 0;
+    }
+
+    buffer = ogg_sync_buffer(sync, RXP_DEC_SEEK_CHUNK_SIZE);
+    if (!buffer) {
+      return -1;
+    }
+
+    read = rxp_io_read(&decoder->io, buffer, RXP_DEC_SEEK_CHUNK_SIZE);
+    if (read <= 0) {
+      return 1;
+    }
+
+    if (0 != ogg_sync_wrote(sync, read)) {
+      return -2;
+    }
+  }
+
+  return 1;
+}
+
+static int64_t rxp_decoder_granule_key(rxp_stream* stream, int64_t granule) {
+
+  th_info* info = &stream->theora.info;
+
+  if (RXP_THEORA == stream->type) {
+    return rxp_time_theora_count(granule, info->keyframe_granule_shift) 
+      - rxp_time_theora_offset(info->version_major, info->version_minor, info->version_subminor);
+  }
+
+  /* the opus granule includes the pre-skip samples */
+  if (RXP_OPUS == stream->type) {
+    return granule - stream->opus.preskip;
+  }
+
+  return granule;
+}
+
+static int64_t rxp_decoder_pts_to_sample(rxp_stream* stream, uint64_t pts) {
+
+  if (RXP_OPUS == stream->type) {
+    return rxp_time_to_count(pts, RXP_OPUS_RATE, 1);
+  }
+
+  return rxp_time_to_count(pts, stream->vorbis.info.rate, 1);
+}
+
+/* 
+   We can only skip decoding inter frames; they are not used as reference by
+   the frames after the next keyframe. The decoder context counts the frames
+   itself so when we decode again we tell it the number of frames we skipped.
+*/
+static int rxp_decoder_skip_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts) {
+
+  rxp_theora* theora = &stream->theora;
+  int shift = theora->info.keyframe_granule_shift;
+  int64_t granule = 0;
+  uint64_t pts = 0;
+
+  if (0 == late_pts || RXP_SEEK_NONE != stream->seek_state || theora->nframes < 0) {
+    return -1;
+  }
+
+  if (1 == th_packet_iskeyframe(packet)) {
+    if (theora->is_skipping) {
+      granule = theora->nframes << shift;
+      th_decode_ctl(theora->ctx, TH_DECCTL_SET_GRANPOS, &granule, sizeof(granule));
+      theora->is_skipping = 0;
+    }
+    return -2;
+  }
+
+  if (0 == theora->is_skipping) {
+    pts = decoder->chain_pts + rxp_time_theora_ns(&theora->info, (theora->nframes + 1) << shift);
+    if (pts + RXP_DEC_LATE_DROP >= late_pts) {
+      return -3;
+    }
+    theora->is_skipping = 1;
+  }
+
+  theora->nframes++;
+  if (packet->granulepos >= 0) {
+    theora->nframes = rxp_time_theora_count(packet->granulepos, shift);
+  }
+
+  rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_theora_ns(&theora->info, theora->nframes << shift));
+
+  /* rxp_decoder_get_stats() reads it from another thread */
+  rxp_decode_thread_lock(rxp_decoder_get_thread(decoder, stream));
+  {
+    decoder->nframes_skipped++;
+  }
+  rxp_decode_thread_unlock(rxp_decoder_get_thread(decoder, stream));
+
+  return 0;
+}
+
+static void rxp_decoder_update_quality(rxp_decoder* decoder, rxp_stream* stream, uint64_t late_pts) {
+
+  rxp_theora* theora = &stream->theora;
+  int level = theora->pp_level;
+
+  if (0 == late_pts) {
+    return;
+  }
+
+  /* lower the quality quickly, but only raise it when we're on time for a while */
+  if (stream->decoded_pts < (int64_t)late_pts) {
+    theora->nframes_on_time = 0;
+    theora->nframes_late++;
+    if (level > 0 && theora->nframes_late >= RXP_DEC_PP_DOWN_FRAMES) {
+      level--;
+    }
+  }
+  else {
+    theora->nframes_late = 0;
+    theora->nframes_on_time++;
+    if (level < theora->pp_level_max && theora->nframes_on_time >= RXP_DEC_PP_UP_FRAMES) {
+      level++;
+    }
+  }
+
+  if (level == theora->pp_level) {
+    return;
+  }
+
+  if (0 != th_decode_ctl(theora->ctx, TH_DECCTL_SET_PPLEVEL, &level, sizeof(level))) {
+    return;
+  }
+
+#if !defined(NDEBUG)
+  printf("Info: changed the post-processing level from %d to %d.\n", theora->pp_level, level);
+#endif
+
+  theora->pp_level = level;
+  theora->nframes_late = 0;
+  theora->nframes_on_time = 0;
+}
+
+/* libtheora gives us the rows of 8x8 fragments, top-down */
+static void rxp_decoder_on_stripe(void* user, th_ycbcr_buffer buffer, int yfrag0, int yfrag_end) {
+
+  rxp_decoder* decoder = (rxp_decoder*)user;
+  int row_end = yfrag_end * 8;
+
+  if (row_end > buffer[0].height) {
+    row_end = buffer[0].height;
+  }
+
+  decoder->on_theora_stripe(decoder, buffer, yfrag0 * 8, row_end);
+}
+
+/* 
+   We count the packets from the segment table of the page: a lacing value < 255
+   ends a packet. When the page continues a packet of which we don't have the 
+   start (e.g. after a seek) ogg_stream_pagein() drops that part, so we skip the
+   first packet end too.
+*/
+static int rxp_decoder_count_packets(ogg_page* page, int* is_partial) {
+
+  int nsegments = page->header[26];
+  int must_skip = (ogg_page_continued(page) && 0 == *is_partial) ? 1 : 0;
+  int count = 0;
+  int i = 0;
+
+  for (i = 0; i < nsegments; ++i) {
+    if (page->header[27 + i] < 255) {
+      if (must_skip) {
+        must_skip = 0;
+      }
+      else {
+        count++;
+      }
+    }
+  }
+
+  /* when all segments were dropped we still don't have the start of a packet */
+  if (nsegments > 0) {
+    *is_partial = (255 == page->header[27 + nsegments - 1] && 0 == must_skip) ? 1 : 0;
+  }
+
+  return count;
+}
+
+/* fibonacci hashing; serials are random but we don't want to depend on that */
+static uint32_t rxp_decoder_hash_serial(int serial) {
+  return ((uint32_t)serial * 2654435769u) >> 26;
+}
+
+static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts) {
+
+  ogg_int64_t granulepos = -1;
+  th_ycbcr_buffer buffer;
+  th_stripe_callback stripe;
+  int is_dup = 0;
+  int is_seek_end = 0;
+  int r = -1;
+  rxp_theora* theora = &stream->theora;
+
+  if(theora->ctx == NULL) {
 
     /* parse all header packets; returns 0 when ready. */
     r = th_decode_headerin(&theora->info, &theora->comment, &theora->setup, packet);
@@ -374,24 +1347,64 @@ static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, o
     theora->ctx = th_decode_alloc(&theora->info, theora->setup);
     if (theora->ctx == NULL) {
       printf("Error: cannot allocate the theora decoder context.\n");
-      exit(1);
+      return -1;
+    }
+
+    /* we start with the best quality, rxp_decoder_update_quality() lowers it when we're late */
+    th_decode_ctl(theora->ctx, TH_DECCTL_GET_PPLEVEL_MAX, &theora->pp_level_max, sizeof(theora->pp_level_max));
+    if (decoder->pp_level >= 0 && decoder->pp_level < theora->pp_level_max) {
+      theora->pp_level_max = decoder->pp_level;
+    }
+
+    theora->pp_level = theora->pp_level_max;
+    th_decode_ctl(theora->ctx, TH_DECCTL_SET_PPLEVEL, &theora->pp_level, sizeof(theora->pp_level));
+
+    if (decoder->on_theora_stripe) {
+      stripe.ctx = decoder;
+      stripe.stripe_decoded = rxp_decoder_on_stripe;
+      th_decode_ctl(theora->ctx, TH_DECCTL_SET_STRIPE_CB, &stripe, sizeof(stripe));
     }
+
+    /* libtheora already rejects TH_PF_RSVD in the headers */
+    switch (theora->info.pixel_fmt) {
+      case TH_PF_422: { decoder->pix_fmt = RXP_YUV422P; break; } 
+      case TH_PF_444: { decoder->pix_fmt = RXP_YUV444P; break; } 
+      default:        { decoder->pix_fmt = RXP_YUV420P; break; } 
+    }
+
+    rxp_decoder_trigger_event(decoder, RXP_DEC_EVENT_VIDEO_INFO);
     
     return 0;
   }
 
+  /* frames that are too late to be shown aren't decoded */
+  if (0 == rxp_decoder_skip_theora(decoder, stream, packet, late_pts)) {
+    return 0;
+  }
+
   /* decoder packet */
   r = th_decode_packetin(theora->ctx, packet, &granulepos);
-  if (r != 0) {
+  if (r == TH_DUPFRAME) {
+    /* the same image as the previous frame, but it still has its own pts */
+    is_dup = 1;
+  }
+  else if (r != 0) {
     /* we must skip a bad packet. */
     if (r == TH_EBADPACKET) { 
       return 0;
     }
-    else if (r == TH_DUPFRAME) {
+    printf("Error: cannot decode the theora packet: %d = %s\n", r, rxp_decoder_theora_error_to_string(r));
+    return -2;
+  }
+
+  theora->nframes = rxp_time_theora_count(granulepos, theora->info.keyframe_granule_shift);
+
+  /* after a seek the granulepos that the decoder tracks is invalid until we set it */
+  if (RXP_SEEK_SYNC == stream->seek_state) {
+    if (packet->granulepos < 0) {
       return 0;
     }
-    printf("Error: cannot decode the theora packet: %d = %s\n", r, rxp_decoder_theora_error_to_string(r));
-    return 0;
+    stream->seek_state = RXP_SEEK_SKIP;
   }
 
   if (packet->granulepos >= 0) {
@@ -410,16 +1423,32 @@ static int rxp_decoder_decode_theora(rxp_decoder* decoder, rxp_stream* stream, o
 
   }
 
-  /* retrieve the yuv data */
+  /* the end time of the frame; th_granule_time() returns a double which loses nanoseconds in long files */
+  rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_theora_ns(&theora->info, granulepos));
+
+  /* decode, but don't present the frames before the seek pts */
+  if (RXP_SEEK_SKIP == stream->seek_state) {
+    if (stream->decoded_pts <= (int64_t)decoder->seek_pts) {
+      return 0;
+    }
+    stream->seek_state = RXP_SEEK_NONE;
+    is_seek_end = 1;
+  }
+
+  /* a duplicate only needs the pixels when it's the first frame after a seek */
+  if (is_dup && 0 == is_seek_end && decoder->on_theora_dup) {
+    decoder->on_theora_dup(decoder, stream->decoded_pts);
+    return 0;
+  }
+
+  /* retrieve the yuv data; for a duplicate this is the previous frame */
   r = th_decode_ycbcr_out(theora->ctx, buffer);
   if (r != 0) {
     printf("Error: cannot decode the theora data: %d\n", r);
-    exit(1);
+    return -3;
   }
 
-  time_s = (double)(th_granule_time(theora->ctx, granulepos)) ;
-  //stream->decoded_pts = time_s * 1000ull * 1000ull * 1000ull;
-  stream->decoded_pts = time_s * 1e9;
+  rxp_decoder_update_quality(decoder, stream, late_pts);
 
   if (decoder->on_theora) {
     decoder->on_theora(decoder, stream->decoded_pts, buffer);
@@ -432,8 +1461,13 @@ static int rxp_decoder_decode_vorbis(rxp_decoder* decoder, rxp_stream* stream, o
 
   int samples = 0;
   int r = 0;
-  rxp_vorbis* v = &decoder->vorbis;
+  int c = 0;
+  int skip = 0;
+  int64_t start = 0;
+  int64_t seek_sample = 0;
+  rxp_vorbis* v = &stream->vorbis;
   float** pcm; 
+  float* trimmed[RXP_DEC_MAX_CHANNELS];
 
   if (v->num_header_packets < 3) {
 
@@ -470,8 +1504,17 @@ static int rxp_decoder_decode_vorbis(rxp_decoder* decoder, rxp_stream* stream, o
     return 0;
   }
 
+  /* when we read the header pages again after seeking to the start; audio packets have bit 0 unset */
+  if (packet->bytes > 0 && (packet->packet[0] & 0x01)) {
+    return 0;
+  }
+
   r = vorbis_synthesis(&v->block, packet);
-  if (r != 0) {
+  if (OV_ENOTAUDIO == r || OV_EBADPACKET == r) {
+    /* like theora we skip a bad packet */
+    return 0;
+  }
+  else if (r != 0) {
     printf("Error: vorbis_synthesis failed: %d\n", r);
     return -5;
   }
@@ -484,27 +1527,303 @@ static int rxp_decoder_decode_vorbis(rxp_decoder* decoder, rxp_stream* stream, o
 
   samples = vorbis_synthesis_pcmout(&v->state, &pcm);
   if (samples <= 0) {
-    printf("Warning: no samples from vorbis: %d\n", samples);
-    return -4;
+    /* the first packet after a seek never gives samples; we may still get the position */
+    if (RXP_SEEK_SYNC == stream->seek_state && packet->granulepos >= 0) {
+      stream->decoded_frames = packet->granulepos;
+      stream->seek_state = RXP_SEEK_SKIP;
+      return 0;
+    }
+    if (RXP_SEEK_NONE == stream->seek_state && samples < 0) {
+      printf("Error: no samples from vorbis: %d\n", samples);
+      return -4;
+    }
+    /* the first packet of a stream only primes the decoder */
+    return 0;
   }
 
-  stream->decoded_frames += samples;
-  stream->decoded_pts = (1.0 / decoder->samplerate) * stream->decoded_frames * 1000ull * 1000ull * 1000ull;
-
   r = vorbis_synthesis_read(&v->state, samples);
   if (r != 0) {
     printf("Error: vorbis_synthesis_read() failed: %d\n", r);
     return -8;
   }
 
-  if (decoder->on_audio) {
-    /* @todo: samples is actually frames .. change all names */
-    decoder->on_audio(decoder, pcm, samples);
+  /* after a seek we only know the sample position at the end of a page */
+  if (RXP_SEEK_SYNC == stream->seek_state) {
+    if (packet->granulepos >= 0) {
+      stream->decoded_frames = packet->granulepos;
+      rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_ns(stream->decoded_frames, v->info.rate, 1));
+      stream->seek_state = RXP_SEEK_SKIP;
+    }
+    return 0;
   }
-  
+
+  /* drop the samples before the seek pts so we start at the exact sample */
+  if (RXP_SEEK_SKIP == stream->seek_state) {
+
+    start = (int64_t)stream->decoded_frames;
+    seek_sample = rxp_decoder_pts_to_sample(stream, decoder->seek_pts);
+    stream->decoded_frames += samples;
+    rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_ns(stream->decoded_frames, v->info.rate, 1));
+
+    if ((int64_t)stream->decoded_frames <= seek_sample) {
+      return 0;
+    }
+
+    stream->seek_state = RXP_SEEK_NONE;
+
+    if (seek_sample > start) {
+
+      skip = (int)(seek_sample - start);
+      samples -= skip;
+
+      for (c = 0; c < v->info.channels && c < RXP_DEC_MAX_CHANNELS; ++c) {
+        trimmed[c] = pcm[c] + skip;
+      }
+
+      pcm = trimmed;
+    }
+  }
+  else {
+    stream->decoded_frames += samples;
+    rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_ns(stream->decoded_frames, v->info.rate, 1));
+  }
+
+  if (decoder->on_audio) {
+    /* @todo: samples is actually frames .. change all names */
+    decoder->on_audio(decoder, pcm, samples);
+  }
+  
   return 0;    
 }
 
+#if defined(RXP_USE_OPUS)
+/* 
+   Opus packets are decoded independently of the page layout. The granulepos
+   counts 48kHz samples, including the `preskip` samples at the start that we
+   drop. The granulepos of the last page can be smaller than the decoded 
+   samples; the rest is padding that we drop too. After a seek we use the 
+   same approach as for vorbis: we decode until we know the position from a 
+   granulepos and then drop the samples before the seek pts.
+*/
+static int rxp_decoder_decode_opus(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet) {
+
+  int samples = 0;
+  int skip = 0;
+  int c = 0;
+  int i = 0;
+  int64_t start = 0;
+  int64_t end = 0;
+  int64_t seek_sample = 0;
+  rxp_opus* o = &stream->opus;
+  float* pcm = NULL;
+
+  if (o->num_header_packets < 2) {
+
+    if (0 == o->num_header_packets) {
+      if (rxp_opus_create_decoder(o, packet) < 0) {
+        return -1;
+      }
+      o->num_header_packets++;
+      return 0;
+    }
+
+    /* OpusTags, we don't use the comments */
+    o->num_header_packets++;
+
+    return rxp_decoder_set_audio_info(decoder, RXP_OPUS_RATE, o->channels);
+  }
+
+  /* when we read the header pages again after seeking to the start */
+  if (packet->bytes >= 8 
+      && (0 == memcmp(packet->packet, "OpusHead", 8) || 0 == memcmp(packet->packet, "OpusTags", 8)))
+    {
+      return 0;
+    }
+
+  samples = opus_multistream_decode_float(o->ctx, packet->packet, packet->bytes, o->pcm, RXP_OPUS_MAX_FRAMES, 0);
+  if (samples < 0) {
+    printf("Error: cannot decode the opus packet: %s\n", opus_strerror(samples));
+    return -2;
+  }
+
+  pcm = o->pcm;
+
+  /* after a seek we only know the sample position at the end of a page */
+  if (RXP_SEEK_SYNC == stream->seek_state) {
+    if (packet->granulepos >= 0) {
+      stream->decoded_frames = (packet->granulepos > o->preskip) ? (uint64_t)(packet->granulepos - o->preskip) : 0;
+      rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_ns(stream->decoded_frames, RXP_OPUS_RATE, 1));
+      stream->seek_state = RXP_SEEK_SKIP;
+    }
+    return 0;
+  }
+
+  /* the encoder delay at the start of the stream */
+  if (o->skip > 0) {
+    skip = (o->skip < samples) ? o->skip : samples;
+    o->skip -= skip;
+    pcm += skip * o->channels;
+    samples -= skip;
+  }
+
+  /* the last page tells us where the audio ends */
+  if (packet->e_o_s && packet->granulepos >= 0) {
+    end = packet->granulepos - o->preskip;
+    if ((int64_t)stream->decoded_frames + samples > end) {
+      samples = (end > (int64_t)stream->decoded_frames) ? (int)(end - (int64_t)stream->decoded_frames) : 0;
+    }
+  }
+
+  /* drop the samples before the seek pts so we start at the exact sample */
+  start = (int64_t)stream->decoded_frames;
+  stream->decoded_frames += samples;
+  rxp_decoder_set_decoded_pts(decoder, stream, decoder->chain_pts + rxp_time_ns(stream->decoded_frames, RXP_OPUS_RATE, 1));
+
+  if (RXP_SEEK_SKIP == stream->seek_state) {
+
+    seek_sample = rxp_decoder_pts_to_sample(stream, decoder->seek_pts);
+    if ((int64_t)stream->decoded_frames <= seek_sample) {
+      return 0;
+    }
+
+    stream->seek_state = RXP_SEEK_NONE;
+
+    if (seek_sample > start) {
+      skip = (int)(seek_sample - start);
+      pcm += skip * o->channels;
+      samples -= skip;
+    }
+  }
+
+  if (samples <= 0) {
+    return 0;
+  }
+
+  if (decoder->on_audio_interleaved) {
+    decoder->on_audio_interleaved(decoder, pcm, samples);
+  }
+  else if (decoder->on_audio) {
+
+    if (NULL == o->planar) {
+      o->planar = (float**)malloc(sizeof(float*) * o->channels);
+      if (NULL == o->planar) {
+        printf("Error: cannot allocate the opus channel buffers.\n");
+        return -3;
+      }
+      o->planar[0] = (float*)malloc(sizeof(float) * RXP_OPUS_MAX_FRAMES * o->channels);
+      if (NULL == o->planar[0]) {
+        printf("Error: cannot allocate the opus channel buffers.\n");
+        free(o->planar);
+        o->planar = NULL;
+        return -4;
+      }
+      for (c = 1; c < o->channels; ++c) {
+        o->planar[c] = o->planar[0] + c * RXP_OPUS_MAX_FRAMES;
+      }
+    }
+
+    for (c = 0; c < o->channels; ++c) {
+      for (i = 0; i < samples; ++i) {
+        o->planar[c][i] = pcm[i * o->channels + c];
+      }
+    }
+
+    decoder->on_audio(decoder, o->planar, samples);
+  }
+
+  return 0;
+}
+
+/* see https://tools.ietf.org/html/rfc7845#section-5.1 for the OpusHead layout */
+static int rxp_opus_create_decoder(rxp_opus* o, ogg_packet* packet) {
+
+  const unsigned char* p = packet->packet;
+  unsigned char mapping[255];
+  int16_t gain = 0;
+  int nstreams = 0;
+  int ncoupled = 0;
+  int family = 0;
+  int err = 0;
+
+  if (packet->bytes < 19 || 0 != memcmp(p, "OpusHead", 8)) {
+    printf("Error: the first opus packet is not an OpusHead.\n");
+    return -1;
+  }
+
+  /* we can decode all 0.x versions */
+  if (0 != (p[8] & 0xF0)) {
+    printf("Error: unsupported opus version: %d.\n", p[8]);
+    return -2;
+  }
+
+  o->channels = p[9];
+  o->preskip = p[10] | (p[11] << 8);
+  gain = (int16_t)(p[16] | (p[17] << 8));
+  family = p[18];
+
+  if (0 == o->channels) {
+    printf("Error: the opus stream has no channels.\n");
+    return -3;
+  }
+
+  if (0 == family) {
+    if (o->channels > 2) {
+      printf("Error: invalid opus channel count for mapping family 0: %d.\n", o->channels);
+      return -4;
+    }
+    nstreams = 1;
+    ncoupled = o->channels - 1;
+    mapping[0] = 0;
+    mapping[1] = 1;
+  }
+  else {
+    if (packet->bytes < 21 + o->channels) {
+      printf("Error: the OpusHead packet is too small for the channel mapping.\n");
+      return -5;
+    }
+    nstreams = p[19];
+    ncoupled = p[20];
+    memcpy(mapping, p + 21, o->channels);
+  }
+
+  o->ctx = opus_multistream_decoder_create(RXP_OPUS_RATE, o->channels, nstreams, ncoupled, mapping, &err);
+  if (NULL == o->ctx || OPUS_OK != err) {
+    printf("Error: cannot create the opus decoder: %s\n", opus_strerror(err));
+    o->ctx = NULL;
+    return -6;
+  }
+
+  if (0 != gain) {
+    opus_multistream_decoder_ctl(o->ctx, OPUS_SET_GAIN(gain));
+  }
+
+  o->pcm = (float*)malloc(sizeof(float) * RXP_OPUS_MAX_FRAMES * o->channels);
+  if (NULL == o->pcm) {
+    printf("Error: cannot allocate the opus output buffer.\n");
+    return -7;
+  }
+
+  o->skip = o->preskip;
+
+  return 0;
+}
+#endif
+
+/* the skeleton packets are only used for the keyframe index and the duration */
+static int rxp_decoder_decode_skeleton(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet) {
+
+  if (rxp_index_add_skeleton(&decoder->index, packet->packet, packet->bytes, decoder->file_size) < 0) {
+    /* not fatal, we can still bisect */
+    return 0;
+  }
+
+  if (decoder->index.duration > decoder->duration) {
+    decoder->duration = decoder->index.duration;
+  }
+
+  return 0;
+}
+
 static int rxp_decoder_detect_stream_type(rxp_decoder* decoder, 
                                           rxp_stream* stream, 
                                           ogg_page* page, 
@@ -517,10 +1836,16 @@ static int rxp_decoder_detect_stream_type(rxp_decoder* decoder,
     return 0;
   }
 
+  /* is this an ogg skeleton track ? */
+  if (packet->bytes >= 8 && 0 == memcmp(packet->packet, "fishead\0", 8)) {
+    stream->type = RXP_SKELETON;
+    return 0;
+  }
+
   /* is this a theora packet ? */
-  r = th_decode_headerin(&decoder->theora.info, 
-                         &decoder->theora.comment,
-                         &decoder->theora.setup,
+  r = th_decode_headerin(&stream->theora.info, 
+                         &stream->theora.comment,
+                         &stream->theora.setup,
                          packet);
 
   if (r >= 0) {
@@ -535,6 +1860,14 @@ static int rxp_decoder_detect_stream_type(rxp_decoder* decoder,
     return r;
   }
 
+#if defined(RXP_USE_OPUS)
+  /* is this an opus packet */
+  if (packet->bytes >= 19 && 0 == memcmp(packet->packet, "OpusHead", 8)) {
+    stream->type = RXP_OPUS;
+    return 1;
+  }
+#endif
+
   /* unknown type */
   return -1;
 }
@@ -547,7 +1880,23 @@ static int rxp_decoder_find_stream(rxp_decoder* decoder,
   rxp_stream* s = *stream;
   int serial = ogg_page_serialno(page);
 
-  if (ogg_page_bos(page)) {
+  /* when we seek to the start we read the bos pages again */
+  s = decoder->stream_table[rxp_decoder_hash_serial(serial)];
+  while (s) {
+    if (s->serial == serial) {
+      break;
+    }
+    s = s->hash_next;
+  }
+
+  if (ogg_page_bos(page) && NULL == s) {
+
+    /* a bos page after all streams ended starts the next link of a chained file */
+    if (0 == rxp_decoder_streams_ended(decoder)) {
+      if (rxp_decoder_start_link(decoder) < 0) {
+        return -6;
+      }
+    }
 
     /* initialize when we're at the beginning of a stream */
     s = rxp_stream_alloc();
@@ -572,16 +1921,7 @@ static int rxp_decoder_find_stream(rxp_decoder* decoder,
 
   }
   else {
-    /* find the stream for the serial */
-    rxp_stream* tail = decoder->streams;
-    while (tail) { 
-      if (tail->serial == serial) {
-        break;
-      }
-      tail = tail->next;
-    }
-    
-    *stream = tail;
+    *stream = s;
   }
 
   if (*stream == NULL) {
@@ -595,6 +1935,11 @@ static int rxp_decoder_find_stream(rxp_decoder* decoder,
 }
 
 static int rxp_decoder_add_stream(rxp_decoder* decoder, rxp_stream* stream) {
+
+  uint32_t bucket = rxp_decoder_hash_serial(stream->serial);
+
+  stream->hash_next = decoder->stream_table[bucket];
+  decoder->stream_table[bucket] = stream;
   
   if (decoder->streams == NULL) {
     /* fist stream */
@@ -614,6 +1959,462 @@ static int rxp_decoder_add_stream(rxp_decoder* decoder, rxp_stream* stream) {
   return 0;
 }
 
+static int rxp_decoder_start_link(rxp_decoder* decoder) {
+
+  rxp_stream* stream = decoder->streams;
+  rxp_stream* next_stream = NULL;
+  uint64_t end_pts = decoder->chain_pts;
+
+  /* the packets of the previous link must be decoded before we free its streams */
+  rxp_decoder_wait_threads(decoder, 0);
+
+  /* the next link starts where the longest of the decoded streams ended */
+  if (decoder->video && decoder->video->decoded_pts > (int64_t)end_pts) {
+    end_pts = decoder->video->decoded_pts;
+  }
+
+  if (decoder->audio && decoder->audio->decoded_pts > (int64_t)end_pts) {
+    end_pts = decoder->audio->decoded_pts;
+  }
+
+  while (stream) {
+    next_stream = stream->next;
+    rxp_stream_free(stream);
+    stream = next_stream;
+  }
+
+  decoder->streams = NULL;
+  memset(decoder->stream_table, 0x00, sizeof(decoder->stream_table));
+  decoder->video = NULL;
+  decoder->audio = NULL;
+  decoder->demux_stream = NULL;
+  decoder->chain_pts = end_pts;
+  decoder->link++;
+
+#if !defined(NDEBUG)
+  printf("Info: starting link %d of a chained file at %llu ns.\n", decoder->link, (unsigned long long)end_pts);
+#endif
+
+  return rxp_decoder_trigger_event(decoder, RXP_DEC_EVENT_CHAIN);
+}
+
+static int rxp_decoder_select_stream(rxp_decoder* decoder, rxp_stream* stream) {
+
+  rxp_stream* s = decoder->streams;
+  int kind = rxp_stream_kind(stream);
+  int track = 0;
+
+  if (0 == kind) {
+    return 0;
+  }
+
+  /* vorbis and opus streams share the audio track numbers */
+  while (s) {
+    if (s != stream && rxp_stream_kind(s) == kind) {
+      track++;
+    }
+    s = s->next;
+  }
+
+  stream->track = track;
+
+  if (RXP_DEC_STREAM_VIDEO == kind
+      && NULL == decoder->video 
+      && track == decoder->video_track
+      && (decoder->stream_mask & RXP_DEC_STREAM_VIDEO))
+    {
+      decoder->video = stream;
+    }
+  else if (RXP_DEC_STREAM_AUDIO == kind
+           && NULL == decoder->audio 
+           && track == decoder->audio_track
+           && (decoder->stream_mask & RXP_DEC_STREAM_AUDIO))
+    {
+      decoder->audio = stream;
+    }
+
+#if !defined(NDEBUG)
+  printf("Info: found %s track %d (serial: %d)%s.\n",
+         (RXP_THEORA == stream->type) ? "theora" : (RXP_OPUS == stream->type) ? "opus" : "vorbis", track, stream->serial,
+         (stream == decoder->video || stream == decoder->audio) ? ", decoding it" : "");
+#endif
+
+  return 0;
+}
+
+static int rxp_decoder_is_stream_used(rxp_decoder* decoder, rxp_stream* stream) {
+
+  if (stream->is_ignored) {
+    return -3;
+  }
+
+  if (RXP_THEORA == stream->type && stream != decoder->video) {
+    return -1;
+  }
+
+  if (RXP_DEC_STREAM_AUDIO == rxp_stream_kind(stream) && stream != decoder->audio) {
+    return -2;
+  }
+
+  return 0;
+}
+
+static int rxp_stream_kind(rxp_stream* stream) {
+
+  switch (stream->type) {
+    case RXP_THEORA: { return RXP_DEC_STREAM_VIDEO; } 
+    case RXP_VORBIS: { return RXP_DEC_STREAM_AUDIO; } 
+    case RXP_OPUS:   { return RXP_DEC_STREAM_AUDIO; } 
+    default:         { return 0;                    } 
+  }
+}
+
+static int rxp_stream_has_video_headers(rxp_stream* stream) {
+
+  /* the setup is parsed from the last header packet */
+  if (RXP_THEORA == stream->type && NULL != stream->theora.setup) {
+    return 0;
+  }
+
+  return -1;
+}
+
+static int rxp_stream_has_audio_headers(rxp_stream* stream) {
+
+  /* rxp_decoder_demux() parses the headers but doesn't initialize the dsp */
+  if (RXP_VORBIS == stream->type && stream->vorbis.num_header_packets >= 3) {
+    return 0;
+  }
+
+  if (RXP_OPUS == stream->type && stream->opus.num_header_packets >= 2) {
+    return 0;
+  }
+
+  return -1;
+}
+
+static int rxp_decoder_demux_packet(rxp_decoder* decoder, rxp_stream* stream, rxp_demux_packet* pkt) {
+
+  ogg_packet* packet = &pkt->packet;
+  th_info* ti = &stream->theora.info;
+  rxp_vorbis* v = &stream->vorbis;
+  int blocksize = 0;
+  int64_t nframes = 0;
+#if defined(RXP_USE_OPUS)
+  rxp_opus* o = &stream->opus;
+  int nsamples = 0;
+#endif
+
+  /* the first packet tells us the type; the theora identification header is parsed here too */
+  if (RXP_NONE == stream->type && packet->b_o_s) {
+    if (0 <= rxp_decoder_detect_stream_type(decoder, stream, NULL, packet)) {
+
+      rxp_decoder_select_stream(decoder, stream);
+
+      /* since 3.2.1 the first frame has granule 1 instead of 0 */
+      if (RXP_THEORA == stream->type) {
+        stream->demux_frame = rxp_time_theora_offset(ti->version_major, ti->version_minor, ti->version_subminor) - 1;
+        stream->demux_keyframe = stream->demux_frame;
+      }
+    }
+  }
+
+  pkt->serial = stream->serial;
+  pkt->type = stream->type;
+  pkt->track = (0 != rxp_stream_kind(stream)) ? stream->track : -1;
+  pkt->link = decoder->link;
+  pkt->granulepos = packet->granulepos;
+  pkt->pts = -1;
+  pkt->is_keyframe = 0;
+  pkt->is_header = 0;
+
+  if (RXP_THEORA == stream->type) {
+
+    /* header packets have the high bit set; we need the setup to seek */
+    if (packet->bytes > 0 && (packet->packet[0] & 0x80)) {
+      if (0 == packet->b_o_s && NULL == stream->theora.setup) {
+        th_decode_headerin(ti, &stream->theora.comment, &stream->theora.setup, packet);
+      }
+      pkt->is_header = 1;
+      pkt->granulepos = 0;
+      return 0;
+    }
+
+    stream->demux_frame++;
+
+    if (1 == th_packet_iskeyframe(packet)) {
+      pkt->is_keyframe = 1;
+      stream->demux_keyframe = stream->demux_frame;
+    }
+
+    if (packet->granulepos >= 0) {
+      stream->demux_frame = rxp_time_theora_count(packet->granulepos, ti->keyframe_granule_shift);
+      stream->demux_keyframe = packet->granulepos >> ti->keyframe_granule_shift;
+      stream->seek_state = RXP_SEEK_NONE;
+    }
+
+    if (RXP_SEEK_NONE != stream->seek_state) {
+      pkt->granulepos = -1;
+      return 0;
+    }
+
+    /* after a seek we know the frame but not its keyframe until we see one */
+    if (stream->demux_keyframe < 0) {
+      pkt->granulepos = -1;
+    }
+    else {
+      pkt->granulepos = (stream->demux_keyframe << ti->keyframe_granule_shift) + (stream->demux_frame - stream->demux_keyframe);
+    }
+
+    /* the same end time as th_granule_time() */
+    if (ti->fps_numerator > 0) {
+      nframes = stream->demux_frame + 1 - rxp_time_theora_offset(ti->version_major, ti->version_minor, ti->version_subminor);
+      pkt->pts = decoder->chain_pts + rxp_time_ns(nframes, ti->fps_numerator, ti->fps_denominator);
+    }
+  }
+  else if (RXP_VORBIS == stream->type) {
+
+    /* we need the setup header to know the blocksizes */
+    if (v->num_header_packets < 3) {
+      pkt->is_header = 1;
+      pkt->granulepos = 0;
+      if (0 != vorbis_synthesis_headerin(&v->info, &v->comment, packet)) {
+        printf("Error: cannot parse the vorbis header of stream %d.\n", stream->serial);
+        return -1;
+      }
+      v->num_header_packets++;
+      return 0;
+    }
+
+    /* when we read the header pages again after seeking to the start; audio packets have bit 0 unset */
+    if (packet->bytes > 0 && (packet->packet[0] & 0x01)) {
+      pkt->is_header = 1;
+      pkt->granulepos = 0;
+      return 0;
+    }
+
+    pkt->is_keyframe = 1;
+
+    /* a packet gives the samples between the centers of its window and the one of the previous packet */
+    blocksize = vorbis_packet_blocksize(&v->info, packet);
+    if (blocksize > 0) {
+      if (stream->demux_blocksize > 0) {
+        stream->demux_frame += (stream->demux_blocksize + blocksize) / 4;
+      }
+      stream->demux_blocksize = blocksize;
+    }
+
+    if (packet->granulepos >= 0) {
+      stream->demux_frame = packet->granulepos;
+      stream->seek_state = RXP_SEEK_NONE;
+    }
+
+    if (RXP_SEEK_NONE != stream->seek_state) {
+      pkt->granulepos = -1;
+      return 0;
+    }
+
+    pkt->granulepos = stream->demux_frame;
+    if (v->info.rate > 0) {
+      pkt->pts = decoder->chain_pts + rxp_time_ns(stream->demux_frame, v->info.rate, 1);
+    }
+  }
+#if defined(RXP_USE_OPUS)
+  else if (RXP_OPUS == stream->type) {
+
+    /* OpusHead and OpusTags; we only need the pre-skip */
+    if (o->num_header_packets < 2
+        || (packet->bytes >= 8 
+            && (0 == memcmp(packet->packet, "OpusHead", 8) || 0 == memcmp(packet->packet, "OpusTags", 8))))
+      {
+        if (0 == o->num_header_packets && packet->bytes >= 19) {
+          o->channels = packet->packet[9];
+          o->preskip = packet->packet[10] | (packet->packet[11] << 8);
+        }
+        if (o->num_header_packets < 2) {
+          o->num_header_packets++;
+        }
+        pkt->is_header = 1;
+        pkt->granulepos = 0;
+        return 0;
+      }
+
+    pkt->is_keyframe = 1;
+
+    nsamples = opus_packet_get_nb_samples(packet->packet, packet->bytes, RXP_OPUS_RATE);
+    if (nsamples > 0) {
+      stream->demux_frame += nsamples;
+    }
+
+    if (packet->granulepos >= 0) {
+      stream->demux_frame = packet->granulepos;
+      stream->seek_state = RXP_SEEK_NONE;
+    }
+
+    if (RXP_SEEK_NONE != stream->seek_state) {
+      pkt->granulepos = -1;
+      return 0;
+    }
+
+    /* the granulepos includes the pre-skip samples */
+    pkt->granulepos = stream->demux_frame;
+    nframes = (stream->demux_frame > o->preskip) ? (stream->demux_frame - o->preskip) : 0;
+    pkt->pts = decoder->chain_pts + rxp_time_ns(nframes, RXP_OPUS_RATE, 1);
+  }
+#endif
+  else if (RXP_SKELETON == stream->type) {
+    pkt->is_header = 1;
+    rxp_decoder_decode_skeleton(decoder, stream, packet);
+    return 0;
+  }
+  else {
+    /* a stream we don't know, we pass the packets as they are */
+    return 0;
+  }
+
+  /* the next link of a chained file starts where these streams end */
+  if (pkt->pts >= 0) {
+    rxp_decoder_set_decoded_pts(decoder, stream, pkt->pts);
+  }
+
+  return 0;
+}
+
+static int rxp_decoder_decode_packet(rxp_decoder* decoder, rxp_stream* stream, ogg_packet* packet, uint64_t late_pts) {
+
+  if (stream->type == RXP_VORBIS) {
+    return rxp_decoder_decode_vorbis(decoder, stream, packet);
+  }
+  else if (stream->type == RXP_THEORA) {
+    return rxp_decoder_decode_theora(decoder, stream, packet, late_pts);
+  }
+  else if (stream->type == RXP_SKELETON) {
+    return rxp_decoder_decode_skeleton(decoder, stream, packet);
+  }
+#if defined(RXP_USE_OPUS)
+  else if (stream->type == RXP_OPUS) {
+    return rxp_decoder_decode_opus(decoder, stream, packet);
+  }
+#endif
+
+  printf("Error: unknown stream type.\n");
+
+  return -1;
+}
+
+/* the decode thread keeps the first error, rxp_decoder_decode() returns it with the next call */
+static int rxp_decoder_on_thread_packet(void* user, void* stream, ogg_packet* packet, uint64_t late_pts) {
+  return rxp_decoder_decode_packet((rxp_decoder*)user, (rxp_stream*)stream, packet, late_pts);
+}
+
+static int rxp_decoder_get_thread_error(rxp_decoder* decoder) {
+
+  int r = 0;
+
+  r = rxp_decode_thread_error(&decoder->video_thread);
+  if (r < 0) {
+    printf("Error: the video decode thread failed: %d\n", r);
+    return r;
+  }
+
+  r = rxp_decode_thread_error(&decoder->audio_thread);
+  if (r < 0) {
+    printf("Error: the audio decode thread failed: %d\n", r);
+    return r;
+  }
+
+  return 0;
+}
+
+/* the skeleton and the headers we need to select the streams are handled by the thread that reads the pages */
+static rxp_decode_thread* rxp_decoder_get_thread(rxp_decoder* decoder, rxp_stream* stream) {
+
+  if (stream == decoder->video && 0xCAFEBABE == decoder->video_thread.is_init) {
+    return &decoder->video_thread;
+  }
+
+  if (stream == decoder->audio && 0xCAFEBABE == decoder->audio_thread.is_init) {
+    return &decoder->audio_thread;
+  }
+
+  return NULL;
+}
+
+/* w/o a decode thread the lock does nothing, the stream is only used by the calling thread */
+static void rxp_decoder_set_decoded_pts(rxp_decoder* decoder, rxp_stream* stream, int64_t pts) {
+
+  rxp_decode_thread* thread = rxp_decoder_get_thread(decoder, stream);
+
+  rxp_decode_thread_lock(thread);
+  {
+    stream->decoded_pts = pts;
+  }
+  rxp_decode_thread_unlock(thread);
+}
+
+static void rxp_decoder_wait_threads(rxp_decoder* decoder, int flush) {
+
+  if (0xCAFEBABE != decoder->video_thread.is_init) {
+    return;
+  }
+
+  if (flush) {
+    rxp_decode_thread_flush(&decoder->video_thread);
+    rxp_decode_thread_flush(&decoder->audio_thread);
+  }
+  else {
+    rxp_decode_thread_wait(&decoder->video_thread);
+    rxp_decode_thread_wait(&decoder->audio_thread);
+  }
+}
+
+static void rxp_stream_free(rxp_stream* stream) {
+
+  ogg_stream_clear(&stream->stream_state);
+
+  if (stream->theora.ctx) {
+    th_decode_free(stream->theora.ctx);
+    stream->theora.ctx = NULL;
+  }
+
+  if (stream->theora.setup) {
+    th_setup_free(stream->theora.setup);
+    stream->theora.setup = NULL;
+  }
+
+  th_comment_clear(&stream->theora.comment);
+  th_info_clear(&stream->theora.info);
+
+  if (0xCAFEBABE == stream->vorbis.is_dsp_init) {
+    vorbis_block_clear(&stream->vorbis.block);
+    vorbis_dsp_clear(&stream->vorbis.state);
+    stream->vorbis.is_dsp_init = 0xDEADBEEF;
+  }
+
+  vorbis_comment_clear(&stream->vorbis.comment);
+  vorbis_info_clear(&stream->vorbis.info);
+
+#if defined(RXP_USE_OPUS)
+  if (NULL != stream->opus.ctx) {
+    opus_multistream_decoder_destroy(stream->opus.ctx);
+    stream->opus.ctx = NULL;
+  }
+#endif
+
+  if (NULL != stream->opus.planar) {
+    free(stream->opus.planar[0]);
+    free(stream->opus.planar);
+    stream->opus.planar = NULL;
+  }
+
+  if (NULL != stream->opus.pcm) {
+    free(stream->opus.pcm);
+    stream->opus.pcm = NULL;
+  }
+
+  free(stream);
+}
+
 static int rxp_decoder_set_audio_info(rxp_decoder* decoder, 
                                       uint64_t samplerate, 
                                       int nchannels) 
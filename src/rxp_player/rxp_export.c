@@ -0,0 +1,513 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+#include <rxp_player/rxp_export.h>
+#include <rxp_player/rxp_decoder.h>
+#include <rxp_player/rxp_probe.h>
+#include <rxp_player/rxp_types.h>
+
+/* ---------------------------------------------------------------- */
+
+typedef struct rxp_export_frame rxp_export_frame;
+typedef struct rxp_export_worker rxp_export_worker;
+typedef struct rxp_export_job rxp_export_job;
+
+struct rxp_export_frame {                                                    /* a decoded frame in the queue of a worker */
+  uint64_t pts;                                                              /* the pts of the frame */
+  int is_end;                                                                /* 1 when this marks the end of a segment, there is no image */
+  int status;                                                                /* is_end: the result of decoding the segment, < 0 on error */
+  th_ycbcr_buffer buffer;                                                    /* the planes, they point into data */
+  uint8_t* data;                                                             /* the copy of the planes, we reuse it for the next frames */
+  size_t capacity;                                                           /* the size of data */
+};
+
+struct rxp_export_worker {
+  rxp_export_job* job;
+  rxp_decoder decoder;                                                       /* each worker has its own decoder on the file */
+  rxp_export_frame frames[RXP_EXPORT_QUEUE_FRAMES];                          /* the decoded frames that haven't been delivered yet */
+  uint32_t head;                                                             /* the slot of the next frame we decode, protected by the job mutex */
+  uint32_t tail;                                                             /* the slot of the next frame we deliver, protected by the job mutex */
+  uint32_t count;                                                            /* the number of frames in the queue, protected by the job mutex */
+  uint64_t start_pts;                                                        /* we deliver the frames with a pts in (start_pts, end_pts] */
+  uint64_t end_pts;
+  int is_segment_done;                                                       /* set to 1 when we decoded a frame after end_pts */
+  int status;                                                                /* < 0 when something went wrong with the current segment */
+  uv_thread_t thread;
+};
+
+struct rxp_export_job {                                                      /* shared by the workers of rxp_export_frames() */
+  char* filepath;
+  uint64_t* boundaries;                                                      /* segment i contains the frames with a pts in (boundaries[i], boundaries[i + 1]] */
+  int nsegments;
+  int next_segment;                                                          /* the next segment that a worker takes, protected by mutex */
+  int* segment_workers;                                                      /* the worker that decodes each segment, -1 until a worker took it */
+  rxp_export_worker* workers;
+  uv_mutex_t mutex;                                                          /* protects the queues and the segments */
+  uv_cond_t cond;                                                            /* is signalled when a frame is added or delivered or a segment is taken */
+};
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_export_create_segments(rxp_export_job* job, int nsegments);  /* sets the boundaries of the segments, on keyframes when we have an index */
+static void rxp_export_thread(void* worker);                                /* decodes segments until there are none left */
+static int rxp_export_decode_segment(rxp_export_worker* worker, int segment); /* seeks to the segment and decodes it */
+static void rxp_export_on_frame(rxp_decoder* decoder, uint64_t pts, th_ycbcr_buffer buffer); /* is called by the decoder of a worker, adds the frame to the queue */
+static rxp_export_frame* rxp_export_reserve(rxp_export_worker* worker);     /* returns the free slot at head, blocks while the queue is full */
+static void rxp_export_commit(rxp_export_worker* worker);                   /* adds the reserved slot to the queue */
+static void rxp_export_end_segment(rxp_export_worker* worker, int status);  /* adds the end marker of the current segment */
+static int rxp_export_copy_frame(rxp_export_frame* frame, th_ycbcr_buffer buffer); /* copies the planes into the frame */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_export_frames(char* filepath, int nthreads, rxp_export_callback cb, void* user) {
+
+  rxp_export_job job;
+  rxp_export_worker* worker = NULL;
+  rxp_export_frame* frame = NULL;
+  uv_cpu_info_t* cpus = NULL;
+  int ncpus = 0;
+  int nworkers = 0;
+  int segment = 0;
+  int is_end = 0;
+  int r = 0;
+  int i = 0;
+
+  if (!filepath) { return -1; }
+  if (!cb) { return -2; }
+
+  if (nthreads <= 0) {
+    nthreads = 1;
+    if (0 == uv_cpu_info(&cpus, &ncpus)) {
+      nthreads = ncpus;
+      uv_free_cpu_info(cpus, ncpus);
+    }
+  }
+
+  if (nthreads > RXP_EXPORT_MAX_THREADS) {
+    nthreads = RXP_EXPORT_MAX_THREADS;
+  }
+
+  memset((char*)&job, 0x00, sizeof(job));
+  job.filepath = filepath;
+
+  if (rxp_export_create_segments(&job, nthreads * RXP_EXPORT_SEGMENTS_PER_THREAD) < 0) {
+    r = -3;
+    goto done;
+  }
+
+  if (nthreads > job.nsegments) {
+    nthreads = job.nsegments;
+  }
+
+  job.segment_workers = (int*)malloc(sizeof(int) * job.nsegments);
+  job.workers = (rxp_export_worker*)calloc(nthreads, sizeof(rxp_export_worker));
+  if (!job.segment_workers || !job.workers) {
+    printf("Error: cannot allocate the export workers.\n");
+    r = -4;
+    goto done;
+  }
+
+  for (i = 0; i < job.nsegments; ++i) {
+    job.segment_workers[i] = -1;
+  }
+
+  if (0 != uv_mutex_init(&job.mutex)) {
+    printf("Error: cannot initialize the export mutex.\n");
+    r = -5;
+    goto done;
+  }
+
+  if (0 != uv_cond_init(&job.cond)) {
+    printf("Error: cannot initialize the export condition var.\n");
+    uv_mutex_destroy(&job.mutex);
+    r = -6;
+    goto done;
+  }
+
+  for (nworkers = 0; nworkers < nthreads; ++nworkers) {
+    job.workers[nworkers].job = &job;
+    if (0 != uv_thread_create(&job.workers[nworkers].thread, rxp_export_thread, &job.workers[nworkers])) {
+      printf("Error: cannot create export thread %d.\n", nworkers);
+      break;
+    }
+  }
+
+  /* we need at least one worker that takes the segments */
+  if (0 == nworkers) {
+    r = -7;
+    goto destroy;
+  }
+
+  /* deliver the frames segment by segment; the other workers decode ahead into their queues */
+  for (segment = 0; segment < job.nsegments; ++segment) {
+
+    uv_mutex_lock(&job.mutex);
+    {
+      while (job.segment_workers[segment] < 0) {
+        uv_cond_wait(&job.cond, &job.mutex);
+      }
+      worker = &job.workers[job.segment_workers[segment]];
+    }
+    uv_mutex_unlock(&job.mutex);
+
+    while (1) {
+
+      uv_mutex_lock(&job.mutex);
+      {
+        while (0 == worker->count) {
+          uv_cond_wait(&job.cond, &job.mutex);
+        }
+        frame = &worker->frames[worker->tail];
+      }
+      uv_mutex_unlock(&job.mutex);
+
+      /* the worker doesn't touch the frame until we removed it from the queue */
+      is_end = frame->is_end;
+      if (0 == is_end) {
+        cb(frame->pts, frame->buffer, user);
+      }
+      else if (frame->status < 0) {
+        printf("Error: cannot decode segment %d of %s.\n", segment, filepath);
+        r = -8;
+      }
+
+      uv_mutex_lock(&job.mutex);
+      {
+        worker->tail = (worker->tail + 1) % RXP_EXPORT_QUEUE_FRAMES;
+        worker->count--;
+        uv_cond_broadcast(&job.cond);
+      }
+      uv_mutex_unlock(&job.mutex);
+
+      if (is_end) {
+        break;
+      }
+    }
+  }
+
+  for (i = 0; i < nworkers; ++i) {
+    uv_thread_join(&job.workers[i].thread);
+  }
+
+ destroy:
+  uv_cond_destroy(&job.cond);
+  uv_mutex_destroy(&job.mutex);
+
+ done:
+  if (job.workers) {
+    for (i = 0; i < nthreads; ++i) {
+      for (segment = 0; segment < RXP_EXPORT_QUEUE_FRAMES; ++segment) {
+        free(job.workers[i].frames[segment].data);
+      }
+    }
+  }
+
+  free(job.workers);
+  free(job.segment_workers);
+  free(job.boundaries);
+
+  return r;
+}
+
+/* ---------------------------------------------------------------- */
+
+/*
+   The keyframe entries of the index contain the time at which the keyframe
+   starts. A segment that starts at that time contains the keyframe (its pts
+   is its end time) and the seek jumps directly to it. When the time of an
+   entry isn't exact (e.g. a rounded skeleton keypoint) the seek starts at
+   the keyframe before it; we'd decode more, but every frame is still
+   delivered by exactly one segment.
+*/
+static int rxp_export_create_segments(rxp_export_job* job, int nsegments) {
+
+  rxp_decoder decoder;
+  rxp_probe_info info;
+  rxp_index_stream* keyframes = NULL;
+  uint64_t duration = 0;
+  uint64_t target = 0;
+  uint64_t boundary = 0;
+  uint32_t entry = 0;
+  uint32_t i = 0;
+  int r = 0;
+  int n = 0;
+
+  /* we use a decoder to get the index from a sidecar or the skeleton */
+  memset((char*)&decoder, 0x00, sizeof(decoder));
+  if (rxp_decoder_init(&decoder) < 0) {
+    return -1;
+  }
+
+  rxp_decoder_enable_streams(&decoder, RXP_DEC_STREAM_VIDEO);
+
+  if (rxp_decoder_open_file(&decoder, job->filepath) < 0) {
+    printf("Error: cannot open %s for exporting.\n", job->filepath);
+    rxp_decoder_clear(&decoder);
+    return -2;
+  }
+
+  while (NULL == decoder.video || NULL == decoder.video->theora.ctx) {
+    if (rxp_decoder_decode(&decoder) < 0) {
+      printf("Error: cannot find a theora stream in %s.\n", job->filepath);
+      r = -3;
+      goto done;
+    }
+  }
+
+  for (i = 0; i < decoder.index.nstreams; ++i) {
+    if (decoder.index.streams[i].serial == decoder.video->serial && decoder.index.streams[i].nentries > 0) {
+      keyframes = &decoder.index.streams[i];
+      break;
+    }
+  }
+
+  duration = decoder.duration;
+  if (0 == duration && 0 == rxp_probe(job->filepath, &info)) {
+    duration = info.duration;
+  }
+
+  /* when we don't know the duration we can't split the file */
+  if (0 == duration) {
+    nsegments = 1;
+  }
+
+  job->boundaries = (uint64_t*)malloc(sizeof(uint64_t) * (nsegments + 1));
+  if (!job->boundaries) {
+    printf("Error: cannot allocate the export segments.\n");
+    r = -4;
+    goto done;
+  }
+
+  job->boundaries[0] = 0;
+  n = 1;
+
+  for (i = 1; i < (uint32_t)nsegments; ++i) {
+
+    target = (duration / nsegments) * i;
+    boundary = target;
+
+    /* the last keyframe that starts at or before the target */
+    if (NULL != keyframes) {
+      while (entry + 1 < keyframes->nentries && keyframes->entries[entry + 1].pts <= target) {
+        entry++;
+      }
+      boundary = keyframes->entries[entry].pts;
+    }
+
+    /* long keyframe intervals give us the same keyframe for several targets */
+    if (boundary > job->boundaries[n - 1]) {
+      job->boundaries[n] = boundary;
+      n++;
+    }
+  }
+
+  job->boundaries[n] = UINT64_MAX;
+  job->nsegments = n;
+
+#if !defined(NDEBUG)
+  printf("Info: exporting %s in %d segments, %s.\n", job->filepath, job->nsegments,
+         (NULL != keyframes) ? "starting at keyframes from the index" : "without index");
+#endif
+
+ done:
+  rxp_decoder_close_file(&decoder);
+  rxp_decoder_clear(&decoder);
+
+  return r;
+}
+
+static void rxp_export_thread(void* user) {
+
+  rxp_export_worker* worker = (rxp_export_worker*)user;
+  rxp_export_job* job = worker->job;
+  rxp_decoder* decoder = &worker->decoder;
+  int is_init = 0;
+  int is_open = 0;
+  int segment = 0;
+  int r = 0;
+
+  if (0 == rxp_decoder_init(decoder)) {
+    is_init = 1;
+    decoder->user = worker;
+    decoder->on_theora = rxp_export_on_frame;
+    rxp_decoder_enable_streams(decoder, RXP_DEC_STREAM_VIDEO);
+    is_open = (0 == rxp_decoder_open_file(decoder, job->filepath)) ? 1 : 0;
+  }
+
+  while (1) {
+
+    uv_mutex_lock(&job->mutex);
+    {
+      segment = job->next_segment;
+      if (segment < job->nsegments) {
+        job->next_segment++;
+        job->segment_workers[segment] = (int)(worker - job->workers);
+        uv_cond_broadcast(&job->cond);
+      }
+    }
+    uv_mutex_unlock(&job->mutex);
+
+    if (segment >= job->nsegments) {
+      break;
+    }
+
+    /* we still take the segments when we couldn't open the file, so they're marked as failed */
+    r = (is_open) ? rxp_export_decode_segment(worker, segment) : -1;
+
+    rxp_export_end_segment(worker, r);
+  }
+
+  if (is_open) {
+    rxp_decoder_close_file(decoder);
+  }
+
+  if (is_init) {
+    rxp_decoder_clear(decoder);
+  }
+}
+
+static int rxp_export_decode_segment(rxp_export_worker* worker, int segment) {
+
+  rxp_decoder* decoder = &worker->decoder;
+  int r = 0;
+
+  worker->start_pts = worker->job->boundaries[segment];
+  worker->end_pts = worker->job->boundaries[segment + 1];
+  worker->is_segment_done = 0;
+  worker->status = 0;
+
+  /* we can only seek when we've decoded the headers */
+  while (NULL == decoder->video || NULL == decoder->video->theora.ctx) {
+    if (rxp_decoder_decode(decoder) < 0) {
+      return -1;
+    }
+  }
+
+  /* the first segment starts at the first frame, the worker that decodes it didn't decode anything else yet */
+  if (worker->start_pts > 0 && rxp_decoder_seek(decoder, worker->start_pts) < 0) {
+    return -2;
+  }
+
+  while (0 == worker->is_segment_done && 0 == worker->status) {
+    r = rxp_decoder_decode(decoder);
+    if (r < 0) {
+      /* the end of the file ends the last segment */
+      if (0 == (decoder->state & RXP_DEC_STATE_READY)) {
+        return -3;
+      }
+      break;
+    }
+  }
+
+  return worker->status;
+}
+
+static void rxp_export_on_frame(rxp_decoder* decoder, uint64_t pts, th_ycbcr_buffer buffer) {
+
+  rxp_export_worker* worker = (rxp_export_worker*)decoder->user;
+  rxp_export_frame* frame = NULL;
+
+  if (worker->is_segment_done || pts <= worker->start_pts) {
+    return;
+  }
+
+  if (pts > worker->end_pts) {
+    worker->is_segment_done = 1;
+    return;
+  }
+
+  frame = rxp_export_reserve(worker);
+
+  if (rxp_export_copy_frame(frame, buffer) < 0) {
+    worker->status = -4;
+    return;
+  }
+
+  frame->pts = pts;
+  frame->is_end = 0;
+  frame->status = 0;
+
+  rxp_export_commit(worker);
+}
+
+static rxp_export_frame* rxp_export_reserve(rxp_export_worker* worker) {
+
+  rxp_export_job* job = worker->job;
+  rxp_export_frame* frame = NULL;
+
+  uv_mutex_lock(&job->mutex);
+  {
+    while (RXP_EXPORT_QUEUE_FRAMES == worker->count) {
+      uv_cond_wait(&job->cond, &job->mutex);
+    }
+    frame = &worker->frames[worker->head];
+  }
+  uv_mutex_unlock(&job->mutex);
+
+  return frame;
+}
+
+static void rxp_export_commit(rxp_export_worker* worker) {
+
+  rxp_export_job* job = worker->job;
+
+  uv_mutex_lock(&job->mutex);
+  {
+    worker->head = (worker->head + 1) % RXP_EXPORT_QUEUE_FRAMES;
+    worker->count++;
+    uv_cond_broadcast(&job->cond);
+  }
+  uv_mutex_unlock(&job->mutex);
+}
+
+static void rxp_export_end_segment(rxp_export_worker* worker, int status) {
+
+  rxp_export_frame* frame = rxp_export_reserve(worker);
+
+  frame->pts = 0;
+  frame->is_end = 1;
+  frame->status = status;
+
+  rxp_export_commit(worker);
+}
+
+static int rxp_export_copy_frame(rxp_export_frame* frame, th_ycbcr_buffer buffer) {
+
+  size_t nbytes = 0;
+  uint8_t* data = NULL;
+  uint8_t* dest = NULL;
+  int i = 0;
+  int y = 0;
+
+  for (i = 0; i < 3; ++i) {
+    nbytes += (size_t)buffer[i].width * buffer[i].height;
+  }
+
+  if (nbytes > frame->capacity) {
+    data = (uint8_t*)realloc(frame->data, nbytes);
+    if (!data) {
+      printf("Error: cannot allocate %llu bytes for an exported frame.\n", (unsigned long long)nbytes);
+      return -1;
+    }
+    frame->data = data;
+    frame->capacity = nbytes;
+  }
+
+  dest = frame->data;
+
+  for (i = 0; i < 3; ++i) {
+
+    frame->buffer[i].width = buffer[i].width;
+    frame->buffer[i].height = buffer[i].height;
+    frame->buffer[i].stride = buffer[i].width;
+    frame->buffer[i].data = dest;
+
+    for (y = 0; y < buffer[i].height; ++y) {
+      memcpy(dest, buffer[i].data + y * buffer[i].stride, buffer[i].width);
+      dest += buffer[i].width;
+    }
+  }
+
+  return 0;
+}
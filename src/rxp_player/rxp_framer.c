@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+#include <rxp_player/rxp_framer.h>
+
+#if defined(__AVX2__)
+#  define RXP_FRAMER_AVX2
+#  include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define RXP_FRAMER_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define RXP_FRAMER_NEON
+#  include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+/* ---------------------------------------------------------------- */
+
+static uint32_t rxp_framer_crc_table[8][256];                               /* slice-by-8 tables for the ogg crc (polynomial 0x04c11db7) */
+static uv_once_t rxp_framer_crc_once = UV_ONCE_INIT;
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_framer_crc_init(void);                                      /* creates the crc tables, called once */
+static uint32_t rxp_framer_crc(uint32_t crc, const uint8_t* data, uint64_t nbytes); /* updates the crc with the given data */
+static int rxp_framer_check_page(const uint8_t* p, const uint8_t* end, long* header_len, long* body_len); /* returns 0 when p starts a valid page */
+#if defined(RXP_FRAMER_SSE2) || defined(RXP_FRAMER_AVX2)
+static int rxp_framer_ctz(uint32_t v);                                      /* index of the lowest bit that is set, v must not be 0 */
+#endif
+
+/* ---------------------------------------------------------------- */
+
+int rxp_framer_init(rxp_framer* framer) {
+
+  if (!framer) { return -1; }
+
+  uv_once(&rxp_framer_crc_once, rxp_framer_crc_init);
+
+  framer->data = NULL;
+  framer->size = 0;
+  framer->pos = 0;
+  framer->nskipped = 0;
+  framer->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+int rxp_framer_open(rxp_framer* framer, const uint8_t* data, uint64_t nbytes) {
+
+  if (!framer) { return -1; }
+  if (!data) { return -2; }
+
+  if (rxp_framer_init(framer) < 0) {
+    return -3;
+  }
+
+  framer->data = data;
+  framer->size = nbytes;
+  framer->is_init = 0xCAFEBABE;
+
+  return 0;
+}
+
+int rxp_framer_seek(rxp_framer* framer, uint64_t pos) {
+
+  if (!framer) { return -1; }
+  if (0xCAFEBABE != framer->is_init) { return -2; }
+  if (pos > framer->size) { return -3; }
+
+  framer->pos = pos;
+
+  return 0;
+}
+
+int rxp_framer_next(rxp_framer* framer, ogg_page* page, int64_t* offset) {
+
+  const uint8_t* start = NULL;
+  const uint8_t* end = NULL;
+  const uint8_t* p = NULL;
+  long header_len = 0;
+  long body_len = 0;
+
+  if (!framer) { return -1; }
+  if (!page) { return -2; }
+  if (0xCAFEBABE != framer->is_init) { return -3; }
+
+  start = framer->data + framer->pos;
+  end = framer->data + framer->size;
+  p = start;
+
+  while (NULL != (p = rxp_framer_find_capture(p, end))) {
+
+    if (0 == rxp_framer_check_page(p, end, &header_len, &body_len)) {
+
+      /* libogg doesn't change the page data, it only wants non-const pointers */
+      page->header = (unsigned char*)p;
+      page->header_len = header_len;
+      page->body = (unsigned char*)p + header_len;
+      page->body_len = body_len;
+
+      if (offset) {
+        *offset = (int64_t)(p - framer->data);
+      }
+
+      framer->nskipped += (uint64_t)(p - start);
+      framer->pos = (uint64_t)(p - framer->data) + header_len + body_len;
+
+      return 0;
+    }
+
+    /* not a page, or a page that is cut off at the end; keep looking */
+    p++;
+  }
+
+  framer->nskipped += (uint64_t)(end - start);
+  framer->pos = framer->size;
+
+  return 1;
+}
+
+const uint8_t* rxp_framer_find_capture(const uint8_t* data, const uint8_t* end) {
+
+  const uint8_t* p = data;
+
+  if (!p || !end) { return NULL; }
+
+#if defined(RXP_FRAMER_AVX2)
+  {
+    const __m256i c0 = _mm256_set1_epi8('O');
+    const __m256i c1 = _mm256_set1_epi8('g');
+    const __m256i c3 = _mm256_set1_epi8('S');
+    __m256i m;
+    uint32_t mask;
+
+    /* we load 32 bytes at p, p+1, p+2 and p+3 */
+    while (end - p >= 35) {
+      m = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), c0);
+      m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 1)), c1));
+      m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 2)), c1));
+      m = _mm256_and_si256(m, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 3)), c3));
+      mask = (uint32_t)_mm256_movemask_epi8(m);
+      if (mask) {
+        return p + rxp_framer_ctz(mask);
+      }
+      p += 32;
+    }
+  }
+#endif
+
+#if defined(RXP_FRAMER_SSE2)
+  {
+    const __m128i c0 = _mm_set1_epi8('O');
+    const __m128i c1 = _mm_set1_epi8('g');
+    const __m128i c3 = _mm_set1_epi8('S');
+    __m128i m;
+    uint32_t mask;
+
+    while (end - p >= 19) {
+      m = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), c0);
+      m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), c1));
+      m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), c1));
+      m = _mm_and_si128(m, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 3)), c3));
+      mask = (uint32_t)_mm_movemask_epi8(m);
+      if (mask) {
+        return p + rxp_framer_ctz(mask);
+      }
+      p += 16;
+    }
+  }
+#elif defined(RXP_FRAMER_NEON)
+  {
+    const uint8x16_t c0 = vdupq_n_u8('O');
+    const uint8x16_t c1 = vdupq_n_u8('g');
+    const uint8x16_t c3 = vdupq_n_u8('S');
+    uint8x16_t m;
+    uint64x2_t m64;
+    int i;
+
+    while (end - p >= 19) {
+      m = vceqq_u8(vld1q_u8(p), c0);
+      m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 1), c1));
+      m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 2), c1));
+      m = vandq_u8(m, vceqq_u8(vld1q_u8(p + 3), c3));
+      m64 = vreinterpretq_u64_u8(m);
+      if (vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1)) {
+        /* NEON has no movemask; a match is rare so we just check the block */
+        for (i = 0; i < 16; ++i) {
+          if ('O' == p[i] && 'g' == p[i + 1] && 'g' == p[i + 2] && 'S' == p[i + 3]) {
+            return p + i;
+          }
+        }
+      }
+      p += 16;
+    }
+  }
+#endif
+
+  /* the tail, or everything when we don't have simd */
+  while (end - p >= 4) {
+    p = (const uint8_t*)memchr(p, 'O', (size_t)(end - p) - 3);
+    if (NULL == p) {
+      return NULL;
+    }
+    if ('g' == p[1] && 'g' == p[2] && 'S' == p[3]) {
+      return p;
+    }
+    p++;
+  }
+
+  return NULL;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_framer_crc_init(void) {
+
+  uint32_t r = 0;
+  int i = 0;
+  int j = 0;
+
+  for (i = 0; i < 256; ++i) {
+    r = (uint32_t)i << 24;
+    for (j = 0; j < 8; ++j) {
+      r = (r & 0x80000000) ? ((r << 1) ^ 0x04c11db7) : (r << 1);
+    }
+    rxp_framer_crc_table[0][i] = r;
+  }
+
+  for (i = 0; i < 256; ++i) {
+    r = rxp_framer_crc_table[0][i];
+    for (j = 1; j < 8; ++j) {
+      r = (r << 8) ^ rxp_framer_crc_table[0][r >> 24];
+      rxp_framer_crc_table[j][i] = r;
+    }
+  }
+}
+
+static uint32_t rxp_framer_crc(uint32_t crc, const uint8_t* data, uint64_t nbytes) {
+
+  uint32_t (*t)[256] = rxp_framer_crc_table;
+
+  while (nbytes >= 8) {
+    crc ^= ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+    crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xFF] ^ t[5][(crc >> 8) & 0xFF] ^ t[4][crc & 0xFF]
+        ^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    data += 8;
+    nbytes -= 8;
+  }
+
+  while (nbytes > 0) {
+    crc = (crc << 8) ^ t[0][(crc >> 24) ^ *data];
+    data++;
+    nbytes--;
+  }
+
+  return crc;
+}
+
+static int rxp_framer_check_page(const uint8_t* p, const uint8_t* end, long* header_len, long* body_len) {
+
+  static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+  uint64_t avail = (uint64_t)(end - p);
+  uint32_t crc = 0;
+  uint32_t page_crc = 0;
+  long nsegments = 0;
+  long i = 0;
+
+  if (avail < RXP_FRAMER_HEADER_SIZE) {
+    return -1;
+  }
+
+  /* version 0 and only the continued/bos/eos flags */
+  if (0 != p[4] || 0 != (p[5] & ~0x07)) {
+    return -2;
+  }
+
+  nsegments = p[26];
+  *header_len = RXP_FRAMER_HEADER_SIZE + nsegments;
+  if (avail < (uint64_t)*header_len) {
+    return -3;
+  }
+
+  *body_len = 0;
+  for (i = 0; i < nsegments; ++i) {
+    *body_len += p[RXP_FRAMER_HEADER_SIZE + i];
+  }
+
+  if (avail < (uint64_t)(*header_len + *body_len)) {
+    return -4;
+  }
+
+  /* the crc is calculated with the crc field set to zero */
+  page_crc = (uint32_t)p[22] | ((uint32_t)p[23] << 8) | ((uint32_t)p[24] << 16) | ((uint32_t)p[25] << 24);
+  crc = rxp_framer_crc(0, p, 22);
+  crc = rxp_framer_crc(crc, zeros, 4);
+  crc = rxp_framer_crc(crc, p + 26, (uint64_t)(*header_len + *body_len - 26));
+
+  if (crc != page_crc) {
+    return -5;
+  }
+
+  return 0;
+}
+
+#if defined(RXP_FRAMER_SSE2) || defined(RXP_FRAMER_AVX2)
+static int rxp_framer_ctz(uint32_t v) {
+#if defined(_MSC_VER)
+  unsigned long i;
+  _BitScanForward(&i, v);
+  return (int)i;
+#else
+  return __builtin_ctz(v);
+#endif
+}
+#endif
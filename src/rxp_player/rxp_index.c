@@ -0,0 +1,862 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <ogg/ogg.h>
+#include <rxp_player/rxp_index.h>
+#include <rxp_player/rxp_io.h>
+#include <rxp_player/rxp_framer.h>
+#include <rxp_player/rxp_time.h>
+#include <rxp_player/rxp_types.h>
+
+#define RXP_INDEX_MAGIC "RXPIDX\0\0"                                        /* first 8 bytes of a sidecar */
+#define RXP_INDEX_CHUNK_SIZE (64 * 1024)                                     /* number of bytes we read per call while building */
+#define RXP_INDEX_MAX_STREAMS 32                                             /* max number of streams per link we keep track of while building, we skip the others */
+#define RXP_INDEX_FISHEAD_SIZE 80                                            /* size of a skeleton 4.0 fishead packet */
+#define RXP_INDEX_FISBONE_SIZE 52                                            /* size of a skeleton fisbone packet w/o the message headers */
+#define RXP_INDEX_SKELETON_INDEX_SIZE 42                                     /* size of a skeleton index packet w/o the keypoints */
+
+/* ---------------------------------------------------------------- */
+
+typedef struct rxp_index_scan rxp_index_scan;
+
+struct rxp_index_scan {                                                      /* the state per stream while building the index */
+  uint32_t stream;                                                           /* index into rxp_index.streams; we don't store a pointer because the array is reallocated */
+  int is_indexed;                                                            /* 1 when we add entries for this stream, 0 for the streams of the next links of a chained file */
+  int type;                                                                  /* RXP_THEORA or RXP_VORBIS */
+  int serial;                                                                /* the serial of the logical stream */
+  uint64_t fps_numerator;                                                    /* theora */
+  uint64_t fps_denominator;                                                  /* theora */
+  int shift;                                                                 /* theora, the keyframe granule shift */
+  int frame_offset;                                                          /* theora, 1 for bitstreams >= 3.2.1 where the granule of the first frame is 1 */
+  int64_t last_keyframe;                                                     /* theora, the keyframe part of the last granule */
+  uint64_t samplerate;                                                       /* vorbis */
+  int64_t last_offset;                                                       /* offset of the last page of this stream with a granule */
+};
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_index_next_page(rxp_io* io, rxp_framer* framer, ogg_sync_state* sync, int64_t* pos, ogg_page* page, int64_t* page_offset); /* reads the next page, returns 1 at the end of the file */
+static int rxp_index_add_scan(rxp_index* index, rxp_index_scan* scans, int* nscans, ogg_page* page, int link); /* checks if the bos page is a theora or vorbis stream and adds it; we only index the streams of the first link */
+static int rxp_index_scan_page(rxp_index* index, rxp_index_scan* scan, ogg_page* page, int64_t page_offset, uint64_t chain_pts); /* adds an entry when necessary and updates the duration */
+static int rxp_index_stat(char* filepath, uint64_t* size, int64_t* mtime);  /* get the size and modification time of a file */
+static int rxp_index_find_entry(rxp_index_stream* stream, uint64_t pts);    /* returns the entry we need to decode from for pts, or -1 */
+static int rxp_index_add_fisbone(rxp_index* index, const unsigned char* data, long nbytes); /* adds a stream for a theora or vorbis fisbone */
+static int rxp_index_add_keypoints(rxp_index* index, const unsigned char* data, long nbytes, int64_t file_size); /* adds the keypoints of a skeleton index packet */
+static const unsigned char* rxp_index_read_varint(const unsigned char* p, const unsigned char* end, int64_t* result); /* reads a variable length skeleton number */
+static uint16_t rxp_index_read_u16(const unsigned char* p);                 /* skeleton values are little endian */
+static uint32_t rxp_index_read_u32(const unsigned char* p);
+static int64_t rxp_index_read_s64(const unsigned char* p);
+
+/* ---------------------------------------------------------------- */
+
+int rxp_index_init(rxp_index* index) {
+
+  if (!index) { return -1; }
+
+  index->streams = NULL;
+  index->nstreams = 0;
+  index->file_size = 0;
+  index->mtime = 0;
+  index->duration = 0;
+  index->is_skeleton_valid = 0;
+  index->is_init = 0xCAFEBABE;
+
+  return 0;
+}
+
+int rxp_index_clear(rxp_index* index) {
+
+  uint32_t i;
+
+  if (!index) { return -1; }
+
+  for (i = 0; i < index->nstreams; ++i) {
+    if (index->streams[i].entries) {
+      free(index->streams[i].entries);
+    }
+  }
+
+  if (index->streams) {
+    free(index->streams);
+  }
+
+  return rxp_index_init(index);
+}
+
+int rxp_index_build(rxp_index* index, char* filepath) {
+
+  rxp_io io;
+  rxp_framer framer;
+  ogg_sync_state sync;
+  ogg_page page;
+  rxp_index_scan scans[RXP_INDEX_MAX_STREAMS];
+  int nscans = 0;
+  int link = 0;
+  int is_data = 0;
+  uint64_t chain_pts = 0;
+  int64_t pos = 0;
+  int64_t page_offset = 0;
+  const uint8_t* data = NULL;
+  uint64_t nbytes = 0;
+  int serial = 0;
+  int i = 0;
+  int r = 0;
+
+  if (!index) { return -1; }
+  if (!filepath) { return -2; }
+
+  if (index->nstreams > 0) {
+    printf("Error: the index is already used, first call rxp_index_clear().\n");
+    return -3;
+  }
+
+  if (rxp_index_stat(filepath, &index->file_size, &index->mtime) < 0) {
+    return -4;
+  }
+
+  if (rxp_io_open_file(&io, filepath, RXP_IO_MMAP, RXP_READAHEAD_DEFAULT_SIZE) < 0) {
+    printf("Error: cannot open %s to build the index.\n", filepath);
+    return -5;
+  }
+
+  if (0 != ogg_sync_init(&sync)) {
+    rxp_io_close(&io);
+    return -6;
+  }
+
+  /* when the file is mapped we find the pages in place */
+  rxp_framer_init(&framer);
+  data = rxp_io_get_data(&io, &nbytes);
+  if (NULL != data) {
+    rxp_framer_open(&framer, data, nbytes);
+  }
+
+  while (0 == (r = rxp_index_next_page(&io, &framer, &sync, &pos, &page, &page_offset))) {
+
+    if (ogg_page_bos(&page)) {
+
+      /* a bos page after data pages starts the next link of a chained file; 
+         we can't seek into those links, so we only keep scanning them for the duration */
+      if (1 == is_data) {
+        chain_pts = index->duration;
+        nscans = 0;
+        is_data = 0;
+        link++;
+      }
+
+      if (rxp_index_add_scan(index, scans, &nscans, &page, link) < 0) {
+        r = -7;
+        break;
+      }
+      continue;
+    }
+
+    is_data = 1;
+    serial = ogg_page_serialno(&page);
+
+    for (i = 0; i < nscans; ++i) {
+      if (scans[i].serial == serial) {
+        rxp_index_scan_page(index, &scans[i], &page, page_offset, chain_pts);
+        break;
+      }
+    }
+  }
+
+  ogg_sync_clear(&sync);
+  rxp_io_close(&io);
+
+  if (r < 0) {
+    printf("Error: failed to build the index for %s.\n", filepath);
+    rxp_index_clear(index);
+    return -8;
+  }
+
+#if !defined(NDEBUG)
+  printf("Info: created an index with %u streams, duration: %llu ns.\n", index->nstreams, (unsigned long long)index->duration);
+#endif
+
+  return 0;
+}
+
+int rxp_index_save(rxp_index* index, char* indexpath) {
+
+  FILE* fp = NULL;
+  uint32_t version = RXP_INDEX_VERSION;
+  uint32_t i = 0;
+  int32_t serial = 0;
+  int32_t type = 0;
+  int ok = 1;
+
+  if (!index) { return -1; }
+  if (!indexpath) { return -2; }
+
+  fp = fopen(indexpath, "wb");
+  if (!fp) {
+    printf("Error: cannot open %s to save the index.\n", indexpath);
+    return -3;
+  }
+
+  ok &= (1 == fwrite(RXP_INDEX_MAGIC, 8, 1, fp));
+  ok &= (1 == fwrite(&version, sizeof(version), 1, fp));
+  ok &= (1 == fwrite(&index->file_size, sizeof(index->file_size), 1, fp));
+  ok &= (1 == fwrite(&index->mtime, sizeof(index->mtime), 1, fp));
+  ok &= (1 == fwrite(&index->duration, sizeof(index->duration), 1, fp));
+  ok &= (1 == fwrite(&index->nstreams, sizeof(index->nstreams), 1, fp));
+
+  for (i = 0; i < index->nstreams && ok; ++i) {
+    serial = index->streams[i].serial;
+    type = index->streams[i].type;
+    ok &= (1 == fwrite(&serial, sizeof(serial), 1, fp));
+    ok &= (1 == fwrite(&type, sizeof(type), 1, fp));
+    ok &= (1 == fwrite(&index->streams[i].nentries, sizeof(uint32_t), 1, fp));
+    if (index->streams[i].nentries > 0) {
+      ok &= (index->streams[i].nentries == fwrite(index->streams[i].entries, sizeof(rxp_index_entry), index->streams[i].nentries, fp));
+    }
+  }
+
+  if (0 != fclose(fp)) {
+    ok = 0;
+  }
+
+  if (!ok) {
+    printf("Error: failed to write the index to %s.\n", indexpath);
+    remove(indexpath);
+    return -4;
+  }
+
+  return 0;
+}
+
+int rxp_index_load(rxp_index* index, char* indexpath, char* filepath) {
+
+  FILE* fp = NULL;
+  char magic[8];
+  uint32_t version = 0;
+  uint32_t nstreams = 0;
+  uint32_t nentries = 0;
+  uint32_t i = 0;
+  int32_t serial = 0;
+  int32_t type = 0;
+  uint64_t file_size = 0;
+  int64_t mtime = 0;
+  uint64_t index_size = 0;
+  int64_t index_mtime = 0;
+  long pos = 0;
+  rxp_index_stream* stream = NULL;
+  int ok = 1;
+
+  if (!index) { return -1; }
+  if (!indexpath) { return -2; }
+  if (!filepath) { return -3; }
+
+  if (index->nstreams > 0) {
+    printf("Error: the index is already used, first call rxp_index_clear().\n");
+    return -4;
+  }
+
+  if (rxp_index_stat(filepath, &file_size, &mtime) < 0) {
+    return -5;
+  }
+
+  fp = fopen(indexpath, "rb");
+  if (!fp) {
+    /* not an error, there is just no sidecar */
+    return -6;
+  }
+
+  /* we use the size of the sidecar to validate the number of entries before we allocate them */
+  if (rxp_index_stat(indexpath, &index_size, &index_mtime) < 0) {
+    fclose(fp);
+    return -7;
+  }
+
+  ok &= (1 == fread(magic, sizeof(magic), 1, fp));
+  ok &= (1 == fread(&version, sizeof(version), 1, fp));
+  ok &= (1 == fread(&index->file_size, sizeof(index->file_size), 1, fp));
+  ok &= (1 == fread(&index->mtime, sizeof(index->mtime), 1, fp));
+  ok &= (1 == fread(&index->duration, sizeof(index->duration), 1, fp));
+  ok &= (1 == fread(&nstreams, sizeof(nstreams), 1, fp));
+
+  if (!ok || 0 != memcmp(magic, RXP_INDEX_MAGIC, sizeof(magic)) || RXP_INDEX_VERSION != version) {
+    printf("Error: %s is not a valid index.\n", indexpath);
+    goto error;
+  }
+
+  if (index->file_size != file_size || index->mtime != mtime) {
+#if !defined(NDEBUG)
+    printf("Info: the index %s is outdated, ignoring it.\n", indexpath);
+#endif
+    goto error;
+  }
+
+  for (i = 0; i < nstreams; ++i) {
+
+    ok &= (1 == fread(&serial, sizeof(serial), 1, fp));
+    ok &= (1 == fread(&type, sizeof(type), 1, fp));
+    ok &= (1 == fread(&nentries, sizeof(nentries), 1, fp));
+    if (!ok) {
+      goto error;
+    }
+
+    pos = ftell(fp);
+    if (pos < 0 || (uint64_t)pos > index_size || nentries > (index_size - (uint64_t)pos) / sizeof(rxp_index_entry)) {
+      printf("Error: the index %s is corrupt, it cannot contain %u entries.\n", indexpath, nentries);
+      goto error;
+    }
+
+    if (rxp_index_add_stream(index, serial, type, &stream) < 0) {
+      goto error;
+    }
+
+    if (nentries > 0) {
+
+      stream->entries = (rxp_index_entry*)malloc(nentries * sizeof(rxp_index_entry));
+      if (!stream->entries) {
+        printf("Error: cannot allocate the index entries.\n");
+        goto error;
+      }
+
+      stream->capacity = nentries;
+
+      if (nentries != fread(stream->entries, sizeof(rxp_index_entry), nentries, fp)) {
+        printf("Error: the index %s is truncated.\n", indexpath);
+        goto error;
+      }
+
+      stream->nentries = nentries;
+    }
+  }
+
+  fclose(fp);
+
+  return 0;
+
+ error:
+  fclose(fp);
+  rxp_index_clear(index);
+  return -7;
+}
+
+int rxp_index_create(char* filepath) {
+
+  rxp_index index;
+  char indexpath[1024];
+  int r = 0;
+
+  if (!filepath) { return -1; }
+
+  if (rxp_index_get_path(filepath, indexpath, sizeof(indexpath)) < 0) {
+    return -2;
+  }
+
+  rxp_index_init(&index);
+
+  if (rxp_index_build(&index, filepath) < 0) {
+    return -3;
+  }
+
+  r = rxp_index_save(&index, indexpath);
+
+  rxp_index_clear(&index);
+
+  return (r < 0) ? -4 : 0;
+}
+
+int rxp_index_get_path(char* filepath, char* dest, size_t nbytes) {
+
+  if (!filepath) { return -1; }
+  if (!dest) { return -2; }
+
+  if (strlen(filepath) + strlen(RXP_INDEX_EXTENSION) + 1 > nbytes) {
+    printf("Error: the filepath is too long for the index path.\n");
+    return -3;
+  }
+
+  sprintf(dest, "%s%s", filepath, RXP_INDEX_EXTENSION);
+
+  return 0;
+}
+
+int rxp_index_add_stream(rxp_index* index, int serial, int type, rxp_index_stream** stream) {
+
+  rxp_index_stream* streams = NULL;
+  uint32_t i = 0;
+
+  if (!index) { return -1; }
+  if (!stream) { return -2; }
+
+  for (i = 0; i < index->nstreams; ++i) {
+    if (index->streams[i].serial == serial) {
+      *stream = &index->streams[i];
+      return 0;
+    }
+  }
+
+  streams = (rxp_index_stream*)realloc(index->streams, (index->nstreams + 1) * sizeof(rxp_index_stream));
+  if (!streams) {
+    printf("Error: cannot allocate an index stream.\n");
+    return -3;
+  }
+
+  index->streams = streams;
+
+  *stream = &index->streams[index->nstreams];
+  (*stream)->serial = serial;
+  (*stream)->type = type;
+  (*stream)->nentries = 0;
+  (*stream)->capacity = 0;
+  (*stream)->entries = NULL;
+
+  index->nstreams++;
+
+  return 0;
+}
+
+int rxp_index_add_entry(rxp_index_stream* stream, int64_t offset, int64_t granule, uint64_t pts) {
+
+  rxp_index_entry* entries = NULL;
+  uint32_t capacity = 0;
+
+  if (!stream) { return -1; }
+
+  if (stream->nentries == stream->capacity) {
+
+    capacity = (stream->capacity == 0) ? 256 : stream->capacity * 2;
+
+    entries = (rxp_index_entry*)realloc(stream->entries, capacity * sizeof(rxp_index_entry));
+    if (!entries) {
+      printf("Error: cannot grow the index entries.\n");
+      return -2;
+    }
+
+    stream->entries = entries;
+    stream->capacity = capacity;
+  }
+
+  stream->entries[stream->nentries].offset = offset;
+  stream->entries[stream->nentries].granule = granule;
+  stream->entries[stream->nentries].pts = pts;
+  stream->nentries++;
+
+  return 0;
+}
+
+int rxp_index_find(rxp_index* index, uint64_t pts, int64_t* offset) {
+
+  uint32_t i = 0;
+  int entry = 0;
+  int64_t stream_offset = 0;
+
+  if (!index) { return -1; }
+  if (!offset) { return -2; }
+  if (0 == index->nstreams) { return -3; }
+
+  *offset = -1;
+
+  for (i = 0; i < index->nstreams; ++i) {
+
+    if (0 == index->streams[i].nentries) {
+      continue;
+    }
+
+    entry = rxp_index_find_entry(&index->streams[i], pts);
+    stream_offset = (entry < 0) ? 0 : index->streams[i].entries[entry].offset;
+
+    if (*offset < 0 || stream_offset < *offset) {
+      *offset = stream_offset;
+    }
+  }
+
+  return (*offset < 0) ? -4 : 0;
+}
+
+int rxp_index_add_skeleton(rxp_index* index, const unsigned char* data, long nbytes, int64_t file_size) {
+
+  if (!index) { return -1; }
+  if (!data) { return -2; }
+
+  if (nbytes >= RXP_INDEX_FISHEAD_SIZE && 0 == memcmp(data, "fishead\0", 8)) {
+
+    /* we need version 4.0 for the index; the segment length tells us if the file changed after muxing */
+    if (rxp_index_read_u16(data + 8) < 4) {
+#if !defined(NDEBUG)
+      printf("Info: the skeleton track has no keyframe index (version %u).\n", rxp_index_read_u16(data + 8));
+#endif
+      return 0;
+    }
+
+    if (file_size > 0 && rxp_index_read_s64(data + 64) != file_size) {
+#if !defined(NDEBUG)
+      printf("Info: the file size doesn't match the skeleton segment length, ignoring its index.\n");
+#endif
+      return 0;
+    }
+
+    index->is_skeleton_valid = 1;
+    return 0;
+  }
+
+  if (0 == index->is_skeleton_valid) {
+    return 0;
+  }
+
+  if (nbytes >= RXP_INDEX_FISBONE_SIZE && 0 == memcmp(data, "fisbone\0", 8)) {
+    return rxp_index_add_fisbone(index, data, nbytes);
+  }
+
+  if (nbytes >= RXP_INDEX_SKELETON_INDEX_SIZE && 0 == memcmp(data, "index\0", 6)) {
+    return rxp_index_add_keypoints(index, data, nbytes, file_size);
+  }
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_index_next_page(rxp_io* io, rxp_framer* framer, ogg_sync_state* sync, int64_t* pos, ogg_page* page, int64_t* page_offset) {
+
+  long n = 0;
+  int read = 0;
+  char* buffer = NULL;
+
+  if (0xCAFEBABE == framer->is_init) {
+    if (0 != rxp_framer_next(framer, page, page_offset)) {
+      return 1;
+    }
+    rxp_io_consume(io, framer->pos);
+    return 0;
+  }
+
+  while (1) {
+
+    n = ogg_sync_pageseek(sync, page);
+
+    if (n < 0) {
+      *pos += -n;
+      continue;
+    }
+
+    if (n > 0) {
+      *page_offset = *pos;
+      *pos += n;
+      return 0;
+    }
+
+    buffer = ogg_sync_buffer(sync, RXP_INDEX_CHUNK_SIZE);
+    if (!buffer) {
+      return -1;
+    }
+
+    read = rxp_io_read(io, buffer, RXP_INDEX_CHUNK_SIZE);
+    if (read <= 0) {
+      return 1;
+    }
+
+    if (0 != ogg_sync_wrote(sync, read)) {
+      return -2;
+    }
+  }
+}
+
+/* the bos page only contains the identification header, so we can parse the page body */
+static int rxp_index_add_scan(rxp_index* index, rxp_index_scan* scans, int* nscans, ogg_page* page, int link) {
+
+  unsigned char* b = page->body;
+  long len = page->body_len;
+  rxp_index_scan* scan = NULL;
+  rxp_index_stream* stream = NULL;
+  int type = RXP_NONE;
+
+  if (len >= 42 && 0x80 == b[0] && 0 == memcmp(b + 1, "theora", 6)) {
+    type = RXP_THEORA;
+  }
+  else if (len >= 16 && 0x01 == b[0] && 0 == memcmp(b + 1, "vorbis", 6)) {
+    type = RXP_VORBIS;
+  }
+  else {
+    return 0;
+  }
+
+  if (*nscans >= RXP_INDEX_MAX_STREAMS) {
+#if !defined(NDEBUG)
+    printf("Warning: too many streams in link %d, skipping stream %d.\n", link, ogg_page_serialno(page));
+#endif
+    return 0;
+  }
+
+  scan = &scans[*nscans];
+  memset(scan, 0x00, sizeof(rxp_index_scan));
+
+  scan->serial = ogg_page_serialno(page);
+  scan->type = type;
+
+  if (0 == link) {
+    if (rxp_index_add_stream(index, scan->serial, type, &stream) < 0) {
+      return -2;
+    }
+    scan->stream = (uint32_t)(stream - index->streams);
+    scan->is_indexed = 1;
+  }
+
+  if (RXP_THEORA == type) {
+    scan->fps_numerator = ((uint64_t)b[22] << 24) | (b[23] << 16) | (b[24] << 8) | b[25];
+    scan->fps_denominator = ((uint64_t)b[26] << 24) | (b[27] << 16) | (b[28] << 8) | b[29];
+    scan->shift = ((b[40] & 0x03) << 3) | (b[41] >> 5);
+    scan->frame_offset = rxp_time_theora_offset(b[7], b[8], b[9]);
+    if (0 == scan->fps_numerator || 0 == scan->fps_denominator) {
+      printf("Error: invalid theora frame rate.\n");
+      return -3;
+    }
+  }
+  else {
+    scan->samplerate = (uint64_t)b[12] | ((uint64_t)b[13] << 8) | ((uint64_t)b[14] << 16) | ((uint64_t)b[15] << 24);
+    if (0 == scan->samplerate) {
+      printf("Error: invalid vorbis samplerate.\n");
+      return -4;
+    }
+  }
+
+  (*nscans)++;
+
+  return 0;
+}
+
+static int rxp_index_scan_page(rxp_index* index, rxp_index_scan* scan, ogg_page* page, int64_t page_offset, uint64_t chain_pts) {
+
+  int64_t granule = ogg_page_granulepos(page);
+  int64_t keyframe = 0;
+  int64_t frame = 0;
+  uint64_t pts = 0;
+  uint64_t end_pts = 0;
+  rxp_index_stream* stream = (1 == scan->is_indexed) ? &index->streams[scan->stream] : NULL;
+
+  if (granule < 0) {
+    return 0;
+  }
+
+  if (RXP_THEORA == scan->type) {
+
+    keyframe = granule >> scan->shift;
+    frame = rxp_time_theora_count(granule, scan->shift) - scan->frame_offset;
+
+    /* a new keyframe ended on this page; it may have started on the previous page with a granule */
+    if (NULL != stream && keyframe > scan->last_keyframe) {
+      pts = (uint64_t)rxp_time_ns(keyframe - scan->frame_offset, scan->fps_numerator, scan->fps_denominator);
+      if (rxp_index_add_entry(stream, scan->last_offset, keyframe << scan->shift, pts) < 0) {
+        return -1;
+      }
+      scan->last_keyframe = keyframe;
+    }
+
+    end_pts = (uint64_t)rxp_time_ns(frame + 1, scan->fps_numerator, scan->fps_denominator);
+  }
+  else {
+
+    end_pts = (uint64_t)rxp_time_ns(granule, scan->samplerate, 1);
+
+    if (NULL != stream
+        && (0 == stream->nentries
+            || end_pts >= stream->entries[stream->nentries - 1].pts + RXP_INDEX_AUDIO_INTERVAL))
+    {
+      if (rxp_index_add_entry(stream, page_offset, granule, end_pts) < 0) {
+        return -2;
+      }
+    }
+  }
+
+  /* the links of a chained file are played after each other */
+  end_pts += chain_pts;
+  if (end_pts > index->duration) {
+    index->duration = end_pts;
+  }
+
+  scan->last_offset = page_offset;
+
+  return 0;
+}
+
+static int rxp_index_stat(char* filepath, uint64_t* size, int64_t* mtime) {
+
+  struct stat st;
+
+  if (0 != stat(filepath, &st)) {
+    printf("Error: cannot stat %s.\n", filepath);
+    return -1;
+  }
+
+  *size = (uint64_t)st.st_size;
+  *mtime = (int64_t)st.st_mtime;
+
+  return 0;
+}
+
+/* theora: the last keyframe that is presented at or before pts, vorbis: the last page that ends before pts */
+static int rxp_index_find_entry(rxp_index_stream* stream, uint64_t pts) {
+
+  int lo = 0;
+  int hi = 0;
+  int mid = 0;
+  int found = -1;
+  uint64_t entry_pts = 0;
+
+  if (!stream) { return -1; }
+
+  hi = (int)stream->nentries - 1;
+
+  while (lo <= hi) {
+
+    mid = lo + (hi - lo) / 2;
+    entry_pts = stream->entries[mid].pts;
+
+    if ((RXP_THEORA == stream->type && entry_pts <= pts)
+        || (RXP_THEORA != stream->type && entry_pts < pts))
+    {
+      found = mid;
+      lo = mid + 1;
+    }
+    else {
+      hi = mid - 1;
+    }
+  }
+
+  return found;
+}
+
+/* we only index the streams that we can decode, the content type is one of the message headers */
+static int rxp_index_add_fisbone(rxp_index* index, const unsigned char* data, long nbytes) {
+
+  rxp_index_stream* stream = NULL;
+  const unsigned char* p = NULL;
+  const unsigned char* end = data + nbytes;
+  uint32_t headers_offset = rxp_index_read_u32(data + 8);
+  int type = RXP_NONE;
+
+  if (headers_offset > (uint32_t)(nbytes - 8)) {
+    printf("Error: invalid skeleton fisbone.\n");
+    return -1;
+  }
+
+  for (p = data + 8 + headers_offset; p + 12 <= end; ++p) {
+    if (0 == memcmp(p, "video/theora", 12)) {
+      type = RXP_THEORA;
+      break;
+    }
+    if (0 == memcmp(p, "audio/vorbis", 12)) {
+      type = RXP_VORBIS;
+      break;
+    }
+  }
+
+  if (RXP_NONE == type) {
+    return 0;
+  }
+
+  if (rxp_index_add_stream(index, (int)rxp_index_read_u32(data + 12), type, &stream) < 0) {
+    return -2;
+  }
+
+  return 0;
+}
+
+static int rxp_index_add_keypoints(rxp_index* index, const unsigned char* data, long nbytes, int64_t file_size) {
+
+  rxp_index_stream* stream = NULL;
+  const unsigned char* p = data + RXP_INDEX_SKELETON_INDEX_SIZE;
+  const unsigned char* end = data + nbytes;
+  int serial = (int)rxp_index_read_u32(data + 6);
+  int64_t nkeypoints = rxp_index_read_s64(data + 10);
+  int64_t denominator = rxp_index_read_s64(data + 18);
+  int64_t last_time = rxp_index_read_s64(data + 34);
+  int64_t offset = 0;
+  int64_t time = 0;
+  int64_t delta = 0;
+  int64_t i = 0;
+  uint32_t j = 0;
+
+  for (j = 0; j < index->nstreams; ++j) {
+    if (index->streams[j].serial == serial) {
+      stream = &index->streams[j];
+      break;
+    }
+  }
+
+  /* not a stream we decode or we already have entries */
+  if (NULL == stream || stream->nentries > 0) {
+    return 0;
+  }
+
+  /* each keypoint uses at least two bytes */
+  if (denominator <= 0 || nkeypoints < 0 || nkeypoints > (nbytes - RXP_INDEX_SKELETON_INDEX_SIZE) / 2) {
+    printf("Error: invalid skeleton index for stream %d.\n", serial);
+    return -1;
+  }
+
+  for (i = 0; i < nkeypoints; ++i) {
+
+    p = rxp_index_read_varint(p, end, &delta);
+    offset += delta;
+    p = rxp_index_read_varint(p, end, &delta);
+    time += delta;
+
+    if (NULL == p || offset < 0 || time < 0 || (file_size > 0 && offset > file_size)) {
+      printf("Error: invalid keypoint in the skeleton index for stream %d.\n", serial);
+      stream->nentries = 0;
+      return -2;
+    }
+
+    if (rxp_index_add_entry(stream, offset, -1, (uint64_t)rxp_time_ns(time, denominator, 1)) < 0) {
+      stream->nentries = 0;
+      return -3;
+    }
+  }
+
+  if (last_time > 0) {
+    time = rxp_time_ns(last_time, denominator, 1);
+    if ((uint64_t)time > index->duration) {
+      index->duration = (uint64_t)time;
+    }
+  }
+
+#if !defined(NDEBUG)
+  printf("Info: using the skeleton index for stream %d, %u keypoints.\n", serial, stream->nentries);
+#endif
+
+  return 1;
+}
+
+/* 7 bits per byte, least significant first; the last byte has the high bit set. */
+static const unsigned char* rxp_index_read_varint(const unsigned char* p, const unsigned char* end, int64_t* result) {
+
+  int shift = 0;
+
+  *result = 0;
+
+  if (NULL == p) {
+    return NULL;
+  }
+
+  while (p < end && shift < 63) {
+    *result |= (int64_t)(*p & 0x7F) << shift;
+    shift += 7;
+    if (*p++ & 0x80) {
+      return p;
+    }
+  }
+
+  return NULL;
+}
+
+static uint16_t rxp_index_read_u16(const unsigned char* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rxp_index_read_u32(const unsigned char* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int64_t rxp_index_read_s64(const unsigned char* p) {
+  return (int64_t)((uint64_t)rxp_index_read_u32(p) | ((uint64_t)rxp_index_read_u32(p + 4) << 32));
+}
+
@@ -0,0 +1,710 @@
+#define _FILE_OFFSET_BITS 64
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <rxp_player/rxp_io.h>
+#include <rxp_player/rxp_types.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#  define rxp_fseek _fseeki64
+#  define rxp_ftell _ftelli64
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <poll.h>
+#  include <errno.h>
+#  define rxp_fseek fseeko
+#  define rxp_ftell ftello
+#endif
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_open_stdio(rxp_io* io, char* filepath);                 /* opens the file with fopen() and determines the size */
+static int rxp_io_resolve_offset(int64_t pos, int64_t size, int64_t offset, int whence, int64_t* result); /* converts offset + whence into an absolute position */
+
+static int rxp_io_stdio_read(rxp_io* io, void* dest, uint32_t nbytes);
+static int rxp_io_stdio_seek(rxp_io* io, int64_t offset, int whence);
+static int64_t rxp_io_stdio_tell(rxp_io* io);
+static int64_t rxp_io_stdio_size(rxp_io* io);
+static int rxp_io_stdio_close(rxp_io* io);
+
+static int rxp_io_mmap_read(rxp_io* io, void* dest, uint32_t nbytes);
+static int rxp_io_mmap_seek(rxp_io* io, int64_t offset, int whence);
+static int64_t rxp_io_mmap_tell(rxp_io* io);
+static int64_t rxp_io_mmap_size(rxp_io* io);
+static int rxp_io_mmap_close(rxp_io* io);
+
+static int rxp_io_readahead_read(rxp_io* io, void* dest, uint32_t nbytes);
+static int rxp_io_readahead_seek(rxp_io* io, int64_t offset, int whence);
+static int64_t rxp_io_readahead_tell(rxp_io* io);
+static int rxp_io_readahead_close(rxp_io* io);
+
+static int rxp_io_open_stream(rxp_io* io, char* filepath);                /* opens a FIFO, pipe or growing file for non-blocking reads */
+static int rxp_io_stream_read(rxp_io* io, void* dest, uint32_t nbytes);
+static int64_t rxp_io_stream_tell(rxp_io* io);
+static int64_t rxp_io_stream_size(rxp_io* io);
+static int rxp_io_stream_close(rxp_io* io);
+static int rxp_io_stream_wait(rxp_io* io);                                /* waits at most RXP_IO_STREAM_POLL_TIMEOUT ms for new data */
+
+static int rxp_io_memory_read(rxp_io* io, void* dest, uint32_t nbytes);
+static int rxp_io_memory_seek(rxp_io* io, int64_t offset, int whence);
+static int64_t rxp_io_memory_tell(rxp_io* io);
+static int64_t rxp_io_memory_size(rxp_io* io);
+
+/* ---------------------------------------------------------------- */
+
+int rxp_io_init(rxp_io* io) {
+
+  if (!io) { return -1; }
+
+  io->user = NULL;
+  io->read = NULL;
+  io->seek = NULL;
+  io->tell = NULL;
+  io->size = NULL;
+  io->close = NULL;
+  io->is_stream = 0;
+  io->mode = RXP_NONE;
+  io->fp = NULL;
+  io->mem = NULL;
+  io->mem_size = 0;
+  io->pos = 0;
+  io->file_size = 0;
+  io->readahead_size = RXP_READAHEAD_DEFAULT_SIZE;
+  io->is_readahead_paused = 0;
+  io->fd = -1;
+  io->fd_flags = -1;
+  io->is_fifo = 0;
+  io->got_data = 0;
+  io->stream_timeout = RXP_IO_STREAM_DEFAULT_TIMEOUT;
+  io->last_data_time = 0;
+
+  if (rxp_mmap_init(&io->map) < 0) {
+    return -2;
+  }
+
+  if (rxp_readahead_init(&io->readahead) < 0) {
+    return -3;
+  }
+
+  return 0;
+}
+
+int rxp_io_open_file(rxp_io* io, char* filepath, int mode, uint32_t readahead_size) {
+
+  if (!io) { return -1; }
+  if (!filepath) { return -2; }
+
+  if (rxp_io_init(io) < 0) {
+    return -3;
+  }
+
+  if (RXP_IO_MMAP == mode) {
+
+    if (rxp_mmap_open(&io->map, filepath) == 0) {
+      io->mode = RXP_IO_MMAP;
+      io->read = rxp_io_mmap_read;
+      io->seek = rxp_io_mmap_seek;
+      io->tell = rxp_io_mmap_tell;
+      io->size = rxp_io_mmap_size;
+      io->close = rxp_io_mmap_close;
+      return 0;
+    }
+
+#if !defined(NDEBUG)
+    printf("Info: cannot memory map %s, falling back to the read-ahead thread.\n", filepath);
+#endif
+    mode = RXP_IO_READAHEAD;
+  }
+
+  if (RXP_IO_STREAM == mode) {
+
+    if (rxp_io_open_stream(io, filepath) < 0) {
+      return -5;
+    }
+
+    io->mode = RXP_IO_STREAM;
+    io->is_stream = 1;
+    io->read = rxp_io_stream_read;
+    io->tell = rxp_io_stream_tell;
+    io->size = rxp_io_stream_size;
+    io->close = rxp_io_stream_close;
+    return 0;
+  }
+
+  if (rxp_io_open_stdio(io, filepath) < 0) {
+    return -4;
+  }
+
+  io->mode = RXP_IO_STDIO;
+  io->read = rxp_io_stdio_read;
+  io->seek = rxp_io_stdio_seek;
+  io->tell = rxp_io_stdio_tell;
+  io->size = rxp_io_stdio_size;
+  io->close = rxp_io_stdio_close;
+
+  /* the read-ahead thread is started on the first read so the rxp_io can still be copied (e.g. into the open file task) */
+  if (RXP_IO_READAHEAD == mode) {
+    io->mode = RXP_IO_READAHEAD;
+    io->readahead_size = readahead_size;
+    io->read = rxp_io_readahead_read;
+    io->seek = rxp_io_readahead_seek;
+    io->tell = rxp_io_readahead_tell;
+    io->close = rxp_io_readahead_close;
+  }
+
+  return 0;
+}
+
+int rxp_io_open_memory(rxp_io* io, const void* data, uint64_t nbytes) {
+
+  if (!io) { return -1; }
+  if (!data) { return -2; }
+  if (!nbytes) { return -3; }
+
+  if (rxp_io_init(io) < 0) {
+    return -4;
+  }
+
+  io->mode = RXP_IO_MEMORY;
+  io->mem = (const uint8_t*)data;
+  io->mem_size = nbytes;
+  io->pos = 0;
+  io->read = rxp_io_memory_read;
+  io->seek = rxp_io_memory_seek;
+  io->tell = rxp_io_memory_tell;
+  io->size = rxp_io_memory_size;
+
+  return 0;
+}
+
+int rxp_io_read(rxp_io* io, void* dest, uint32_t nbytes) {
+  if (!io) { return -1; }
+  if (!io->read) { return -2; }
+  return io->read(io, dest, nbytes);
+}
+
+int rxp_io_seek(rxp_io* io, int64_t offset, int whence) {
+  if (!io) { return -1; }
+  if (!io->seek) { return -2; }
+  return io->seek(io, offset, whence);
+}
+
+int64_t rxp_io_tell(rxp_io* io) {
+  if (!io) { return -1; }
+  if (!io->tell) { return -2; }
+  return io->tell(io);
+}
+
+int64_t rxp_io_size(rxp_io* io) {
+  if (!io) { return -1; }
+  if (!io->size) { return -2; }
+  return io->size(io);
+}
+
+int rxp_io_close(rxp_io* io) {
+
+  int r = 0;
+
+  if (!io) { return -1; }
+  if (0 != rxp_io_is_open(io)) { return -2; }
+
+  if (io->close) {
+    r = io->close(io);
+  }
+
+  rxp_io_init(io);
+
+  return (r < 0) ? -3 : 0;
+}
+
+int rxp_io_is_open(rxp_io* io) {
+  if (!io) { return -1; }
+  return (io->read) ? 0 : -2;
+}
+
+/* we check the callbacks and not the mode, so a user that overrides them gets the copying path */
+const uint8_t* rxp_io_get_data(rxp_io* io, uint64_t* nbytes) {
+
+  if (!io) { return NULL; }
+  if (!nbytes) { return NULL; }
+
+  if (rxp_io_mmap_read == io->read && 0xCAFEBABE == io->map.is_init) {
+    *nbytes = io->map.size;
+    return io->map.data;
+  }
+
+  if (rxp_io_memory_read == io->read && NULL != io->mem) {
+    *nbytes = io->mem_size;
+    return io->mem;
+  }
+
+  return NULL;
+}
+
+int rxp_io_pause_readahead(rxp_io* io, int paused) {
+
+  if (!io) { return -1; }
+
+  if (RXP_IO_READAHEAD != io->mode || NULL == io->fp) {
+    return 0;
+  }
+
+  if (0 == paused) {
+    io->is_readahead_paused = 0;
+    return 0;
+  }
+
+  if (0xCAFEBABE == io->readahead.is_init) {
+
+    if (rxp_readahead_stop(&io->readahead) < 0) {
+      return -2;
+    }
+
+    /* the reader thread has read past our position */
+    if (0 != rxp_fseek(io->fp, (int64_t)io->pos, SEEK_SET)) {
+      printf("Error: cannot seek back to %llu after pausing the read-ahead.\n", (unsigned long long)io->pos);
+      return -3;
+    }
+  }
+
+  io->is_readahead_paused = 1;
+
+  return 0;
+}
+
+int rxp_io_consume(rxp_io* io, uint64_t pos) {
+
+  if (!io) { return -1; }
+
+  if (rxp_io_mmap_read == io->read) {
+    return rxp_mmap_consume(&io->map, pos);
+  }
+
+  if (rxp_io_memory_read == io->read) {
+    if (pos > io->mem_size) {
+      return -2;
+    }
+    io->pos = pos;
+    return 0;
+  }
+
+  return -3;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_open_stdio(rxp_io* io, char* filepath) {
+
+  int64_t size = 0;
+
+  io->fp = fopen(filepath, "rb");
+  if (!io->fp) {
+    printf("Error: cannot read file: %s\n", filepath);
+    return -1;
+  }
+
+  if (0 != rxp_fseek(io->fp, 0, SEEK_END)) {
+    printf("Error: failed to seek the end of the video file.\n");
+    goto error;
+  }
+
+  size = rxp_ftell(io->fp);
+  if (-1 == size) {
+    printf("Error: failed to get the SEEK_END position from the video file.\n");
+    goto error;
+  }
+
+  if (0 != rxp_fseek(io->fp, 0, SEEK_SET)) {
+    printf("Error: failed to set the SEEK_SET position of the video file.\n");
+    goto error;
+  }
+
+  if (size <= 0) {
+    printf("Error: the file is empty.\n");
+    goto error;
+  }
+
+  io->file_size = (uint64_t)size;
+
+  return 0;
+
+ error:
+  fclose(io->fp);
+  io->fp = NULL;
+  return -2;
+}
+
+static int rxp_io_resolve_offset(int64_t pos, int64_t size, int64_t offset, int whence, int64_t* result) {
+
+  switch (whence) {
+    case SEEK_SET: { *result = offset;         break; }
+    case SEEK_CUR: { *result = pos + offset;   break; }
+    case SEEK_END: { *result = size + offset;  break; }
+    default:       { return -1;                       }
+  }
+
+  if (*result < 0 || *result > size) {
+    return -2;
+  }
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_stdio_read(rxp_io* io, void* dest, uint32_t nbytes) {
+  return (int)fread(dest, 1, nbytes, io->fp);
+}
+
+static int rxp_io_stdio_seek(rxp_io* io, int64_t offset, int whence) {
+  return (0 == rxp_fseek(io->fp, offset, whence)) ? 0 : -1;
+}
+
+static int64_t rxp_io_stdio_tell(rxp_io* io) {
+  return rxp_ftell(io->fp);
+}
+
+static int64_t rxp_io_stdio_size(rxp_io* io) {
+  return (int64_t)io->file_size;
+}
+
+static int rxp_io_stdio_close(rxp_io* io) {
+
+  if (0 != fclose(io->fp)) {
+    printf("Error: fclose() failed in rxp_io_stdio_close().\n");
+    io->fp = NULL;
+    return -1;
+  }
+
+  io->fp = NULL;
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_mmap_read(rxp_io* io, void* dest, uint32_t nbytes) {
+  return rxp_mmap_read(&io->map, dest, nbytes);
+}
+
+static int rxp_io_mmap_seek(rxp_io* io, int64_t offset, int whence) {
+
+  int64_t pos = 0;
+
+  if (rxp_io_resolve_offset((int64_t)io->map.pos, (int64_t)io->map.size, offset, whence, &pos) < 0) {
+    return -1;
+  }
+
+  return rxp_mmap_seek(&io->map, (uint64_t)pos);
+}
+
+static int64_t rxp_io_mmap_tell(rxp_io* io) {
+  return (int64_t)io->map.pos;
+}
+
+static int64_t rxp_io_mmap_size(rxp_io* io) {
+  return (int64_t)io->map.size;
+}
+
+static int rxp_io_mmap_close(rxp_io* io) {
+  return rxp_mmap_close(&io->map);
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_readahead_read(rxp_io* io, void* dest, uint32_t nbytes) {
+
+  int r = 0;
+
+  if (1 == io->is_readahead_paused) {
+    r = (int)fread(dest, 1, nbytes, io->fp);
+    if (r < (int)nbytes && ferror(io->fp)) {
+      printf("Error: cannot read from the file while the read-ahead is paused.\n");
+      return -2;
+    }
+    io->pos += r;
+    return r;
+  }
+
+  if (0xCAFEBABE != io->readahead.is_init) {
+    if (rxp_readahead_start(&io->readahead, io->fp, io->readahead_size) < 0) {
+      printf("Error: cannot start the read-ahead thread.\n");
+      return -1;
+    }
+  }
+
+  r = rxp_readahead_read(&io->readahead, dest, nbytes);
+
+  if (r > 0) {
+    io->pos += r;
+  }
+
+  return r;
+}
+
+/* the reader thread is already ahead of us, so we stop it and seek; the next read restarts it unless we're paused. */
+static int rxp_io_readahead_seek(rxp_io* io, int64_t offset, int whence) {
+
+  int64_t pos = 0;
+
+  if (rxp_io_resolve_offset((int64_t)io->pos, (int64_t)io->file_size, offset, whence, &pos) < 0) {
+    return -1;
+  }
+
+  if (0xCAFEBABE == io->readahead.is_init) {
+    if (rxp_readahead_stop(&io->readahead) < 0) {
+      return -2;
+    }
+  }
+
+  if (0 != rxp_fseek(io->fp, pos, SEEK_SET)) {
+    printf("Error: cannot seek in the file for the read-ahead thread.\n");
+    return -3;
+  }
+
+  io->pos = (uint64_t)pos;
+
+  return 0;
+}
+
+static int64_t rxp_io_readahead_tell(rxp_io* io) {
+  return (int64_t)io->pos;
+}
+
+static int rxp_io_readahead_close(rxp_io* io) {
+  if (0xCAFEBABE == io->readahead.is_init) {
+    rxp_readahead_stop(&io->readahead);
+  }
+  return rxp_io_stdio_close(io);
+}
+
+/* ---------------------------------------------------------------- */
+
+#if defined(_WIN32)
+
+/* there is no poll() for files and anonymous pipes on Windows, so we read growing files with stdio */
+static int rxp_io_open_stream(rxp_io* io, char* filepath) {
+
+  io->fp = (0 == strcmp(filepath, "-")) ? stdin : fopen(filepath, "rb");
+  if (!io->fp) {
+    printf("Error: cannot open stream: %s\n", filepath);
+    return -1;
+  }
+
+  io->last_data_time = uv_hrtime();
+
+  return 0;
+}
+
+static int rxp_io_stream_read(rxp_io* io, void* dest, uint32_t nbytes) {
+
+  size_t nread = fread(dest, 1, nbytes, io->fp);
+
+  if (nread > 0) {
+    io->pos += nread;
+    io->got_data = 1;
+    io->last_data_time = uv_hrtime();
+    return (int)nread;
+  }
+
+  if (ferror(io->fp)) {
+    printf("Error: cannot read from the stream.\n");
+    return -1;
+  }
+
+  /* reset the eof flag so the next fread() sees the appended data */
+  clearerr(io->fp);
+
+  return rxp_io_stream_wait(io);
+}
+
+static int rxp_io_stream_close(rxp_io* io) {
+
+  if (io->fp != stdin) {
+    fclose(io->fp);
+  }
+
+  io->fp = NULL;
+
+  return 0;
+}
+
+static int rxp_io_stream_wait(rxp_io* io) {
+
+  if (uv_hrtime() - io->last_data_time > io->stream_timeout) {
+#if !defined(NDEBUG)
+    printf("Info: no new data on the stream, we assume it has ended.\n");
+#endif
+    return 0;
+  }
+
+  Sleep(RXP_IO_STREAM_POLL_TIMEOUT);
+
+  return RXP_IO_AGAIN;
+}
+
+static int64_t rxp_io_stream_size(rxp_io* io) {
+  return -1;
+}
+
+#else
+
+static int rxp_io_open_stream(rxp_io* io, char* filepath) {
+
+  struct stat st;
+  int flags;
+
+  if (0 == strcmp(filepath, "-")) {
+    io->fd = STDIN_FILENO;
+    flags = fcntl(io->fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(io->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+      printf("Error: cannot make stdin non-blocking.\n");
+      io->fd = -1;
+      return -1;
+    }
+    io->fd_flags = flags;
+  }
+  else {
+    /* O_NONBLOCK makes sure we don't block until a writer opens the FIFO */
+    io->fd = open(filepath, O_RDONLY | O_NONBLOCK);
+    if (io->fd < 0) {
+      printf("Error: cannot open stream: %s\n", filepath);
+      return -2;
+    }
+  }
+
+  if (0 != fstat(io->fd, &st)) {
+    printf("Error: cannot stat the stream: %s\n", filepath);
+    rxp_io_stream_close(io);
+    return -3;
+  }
+
+  io->is_fifo = S_ISREG(st.st_mode) ? 0 : 1;
+  io->last_data_time = uv_hrtime();
+
+  return 0;
+}
+
+static int rxp_io_stream_read(rxp_io* io, void* dest, uint32_t nbytes) {
+
+  ssize_t nread;
+
+  nread = read(io->fd, dest, nbytes);
+
+  if (nread > 0) {
+    io->pos += nread;
+    io->got_data = 1;
+    io->last_data_time = uv_hrtime();
+    return (int)nread;
+  }
+
+  if (nread < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+    printf("Error: cannot read from the stream: %d.\n", errno);
+    return -1;
+  }
+
+  /* the writer closed the FIFO; before we got data there may just not be a writer yet */
+  if (0 == nread && io->is_fifo && io->got_data) {
+    return 0;
+  }
+
+  return rxp_io_stream_wait(io);
+}
+
+static int rxp_io_stream_close(rxp_io* io) {
+
+  if (io->fd != STDIN_FILENO) {
+    close(io->fd);
+  }
+  else if (io->fd_flags >= 0) {
+    /* give stdin back to the application the way we got it */
+    fcntl(io->fd, F_SETFL, io->fd_flags);
+  }
+
+  io->fd = -1;
+  io->fd_flags = -1;
+
+  return 0;
+}
+
+/* for a FIFO we sleep in poll() until data arrives; a regular file is always readable so we just sleep */
+static int rxp_io_stream_wait(rxp_io* io) {
+
+  struct pollfd pfd;
+
+  if (uv_hrtime() - io->last_data_time > io->stream_timeout) {
+#if !defined(NDEBUG)
+    printf("Info: no new data on the stream, we assume it has ended.\n");
+#endif
+    return 0;
+  }
+
+  pfd.fd = io->fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  poll((io->is_fifo) ? &pfd : NULL, (io->is_fifo) ? 1 : 0, RXP_IO_STREAM_POLL_TIMEOUT);
+
+  return RXP_IO_AGAIN;
+}
+
+static int64_t rxp_io_stream_size(rxp_io* io) {
+
+  struct stat st;
+
+  if (io->is_fifo || 0 != fstat(io->fd, &st)) {
+    return -1;
+  }
+
+  return (int64_t)st.st_size;
+}
+
+#endif
+
+static int64_t rxp_io_stream_tell(rxp_io* io) {
+  return (int64_t)io->pos;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_io_memory_read(rxp_io* io, void* dest, uint32_t nbytes) {
+
+  uint64_t left = io->mem_size - io->pos;
+
+  if (nbytes > left) {
+    nbytes = (uint32_t)left;
+  }
+
+  if (0 == nbytes) {
+    return 0;
+  }
+
+  memcpy(dest, io->mem + io->pos, nbytes);
+  io->pos += nbytes;
+
+  return (int)nbytes;
+}
+
+static int rxp_io_memory_seek(rxp_io* io, int64_t offset, int whence) {
+
+  int64_t pos = 0;
+
+  if (rxp_io_resolve_offset((int64_t)io->pos, (int64_t)io->mem_size, offset, whence, &pos) < 0) {
+    return -1;
+  }
+
+  io->pos = (uint64_t)pos;
+
+  return 0;
+}
+
+static int64_t rxp_io_memory_tell(rxp_io* io) {
+  return (int64_t)io->pos;
+}
+
+static int64_t rxp_io_memory_size(rxp_io* io) {
+  return (int64_t)io->mem_size;
+}
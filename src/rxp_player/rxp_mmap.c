@@ -0,0 +1,262 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <rxp_player/rxp_mmap.h>
+
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_mmap_advise(rxp_mmap* map);                               /* asks the kernel to prefetch the next part of the file when we crossed the previous read-ahead mark */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_mmap_init(rxp_mmap* map) {
+
+  if (!map) { return -1; }
+
+  map->data = NULL;
+  map->size = 0;
+  map->pos = 0;
+  map->advised = 0;
+#if defined(_WIN32)
+  map->file = NULL;
+  map->mapping = NULL;
+#else
+  map->fd = -1;
+#endif
+  map->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+#if defined(_WIN32)
+
+int rxp_mmap_open(rxp_mmap* map, char* filepath) {
+
+  LARGE_INTEGER size;
+  HANDLE file;
+  HANDLE mapping;
+  void* data;
+
+  if (!map) { return -1; }
+  if (!filepath) { return -2; }
+
+  if (0xCAFEBABE == map->is_init) {
+    printf("Error: the rxp_mmap is already used, first call rxp_mmap_close().\n");
+    return -3;
+  }
+
+  file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (INVALID_HANDLE_VALUE == file) {
+    return -4;
+  }
+
+  if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+    CloseHandle(file);
+    return -5;
+  }
+
+  if ((uint64_t)size.QuadPart > (uint64_t)SIZE_MAX) {
+    CloseHandle(file);
+    return -6;
+  }
+
+  mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (NULL == mapping) {
+    CloseHandle(file);
+    return -7;
+  }
+
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (NULL == data) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return -8;
+  }
+
+  map->file = file;
+  map->mapping = mapping;
+  map->data = (uint8_t*)data;
+  map->size = (uint64_t)size.QuadPart;
+  map->pos = 0;
+  map->advised = 0;
+  map->is_init = 0xCAFEBABE;
+
+  return 0;
+}
+
+int rxp_mmap_close(rxp_mmap* map) {
+
+  if (!map) { return -1; }
+  if (0xCAFEBABE != map->is_init) { return -2; }
+
+  UnmapViewOfFile(map->data);
+  CloseHandle((HANDLE)map->mapping);
+  CloseHandle((HANDLE)map->file);
+
+  return rxp_mmap_init(map);
+}
+
+#else
+
+int rxp_mmap_open(rxp_mmap* map, char* filepath) {
+
+  struct stat st;
+  void* data;
+  int fd;
+
+  if (!map) { return -1; }
+  if (!filepath) { return -2; }
+
+  if (0xCAFEBABE == map->is_init) {
+    printf("Error: the rxp_mmap is already used, first call rxp_mmap_close().\n");
+    return -3;
+  }
+
+  fd = open(filepath, O_RDONLY);
+  if (fd < 0) {
+    return -4;
+  }
+
+  /* we can only map regular files; pipes etc.. must use stdio */
+  if (0 != fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    close(fd);
+    return -5;
+  }
+
+  if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+    close(fd);
+    return -6;
+  }
+
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (MAP_FAILED == data) {
+    close(fd);
+    return -7;
+  }
+
+#if defined(MADV_SEQUENTIAL)
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+
+  map->fd = fd;
+  map->data = (uint8_t*)data;
+  map->size = (uint64_t)st.st_size;
+  map->pos = 0;
+  map->advised = 0;
+  map->is_init = 0xCAFEBABE;
+
+  rxp_mmap_advise(map);
+
+  return 0;
+}
+
+int rxp_mmap_close(rxp_mmap* map) {
+
+  if (!map) { return -1; }
+  if (0xCAFEBABE != map->is_init) { return -2; }
+
+  if (0 != munmap(map->data, (size_t)map->size)) {
+    printf("Error: munmap() failed in rxp_mmap_close().\n");
+  }
+
+  close(map->fd);
+
+  return rxp_mmap_init(map);
+}
+
+#endif
+
+int rxp_mmap_read(rxp_mmap* map, void* dest, uint32_t nbytes) {
+
+  uint64_t left;
+
+  if (!map) { return -1; }
+  if (!dest) { return -2; }
+  if (0xCAFEBABE != map->is_init) { return -3; }
+
+  left = map->size - map->pos;
+  if (nbytes > left) {
+    nbytes = (uint32_t)left;
+  }
+
+  if (0 == nbytes) {
+    return 0;
+  }
+
+  memcpy(dest, map->data + map->pos, nbytes);
+  map->pos += nbytes;
+
+  rxp_mmap_advise(map);
+
+  return (int)nbytes;
+}
+
+int rxp_mmap_seek(rxp_mmap* map, uint64_t pos) {
+
+  if (!map) { return -1; }
+  if (0xCAFEBABE != map->is_init) { return -2; }
+  if (pos > map->size) { return -3; }
+
+  map->pos = pos;
+  map->advised = pos;
+
+  rxp_mmap_advise(map);
+
+  return 0;
+}
+
+int rxp_mmap_consume(rxp_mmap* map, uint64_t pos) {
+
+  if (!map) { return -1; }
+  if (0xCAFEBABE != map->is_init) { return -2; }
+  if (pos > map->size) { return -3; }
+
+  map->pos = pos;
+
+  rxp_mmap_advise(map);
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_mmap_advise(rxp_mmap* map) {
+
+#if !defined(_WIN32) && defined(MADV_WILLNEED)
+  uint64_t page_size;
+  uint64_t start;
+  uint64_t end;
+
+  /* only advise again when we've consumed half of the previous window */
+  if (map->pos + (RXP_MMAP_WILLNEED_SIZE / 2) < map->advised) {
+    return;
+  }
+
+  if (map->advised >= map->size) {
+    return;
+  }
+
+  /* madvise() wants a page aligned address */
+  page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+  start = map->pos - (map->pos % page_size);
+  end = map->pos + RXP_MMAP_WILLNEED_SIZE;
+  if (end > map->size) {
+    end = map->size;
+  }
+
+  madvise(map->data + start, (size_t)(end - start), MADV_WILLNEED);
+  map->advised = end;
+#else
+  (void)map;
+#endif
+}
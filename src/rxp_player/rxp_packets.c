@@ -8,6 +8,10 @@ int rxp_img_init(rxp_img* img) {
   img->width = 0;
   img->height = 0;
   img->stride = 0;
+  img->pic_x = 0;
+  img->pic_y = 0;
+  img->pic_width = 0;
+  img->pic_height = 0;
   img->data = NULL;
   return 0;
 }
@@ -20,8 +24,11 @@ int rxp_packet_dealloc(rxp_packet* pkt) {
   pkt->prev = NULL;
   pkt->next = NULL;
   pkt->type = RXP_NONE;
+  pkt->pix_fmt = RXP_NONE;
   pkt->pts = 0;
+  pkt->repeat_pts = 0;
   pkt->size = 0;
+  pkt->capacity = 0;
   pkt->is_free = 0;
 
   rxp_img_init(&pkt->img[0]);
@@ -51,8 +58,11 @@ rxp_packet* rxp_packet_alloc() {
   pkt->next = NULL;
   pkt->data = NULL;
   pkt->type = RXP_NONE;
+  pkt->pix_fmt = RXP_NONE;
   pkt->pts = 0;
+  pkt->repeat_pts = 0;
   pkt->size = 0;
+  pkt->capacity = 0;
   pkt->is_free = 1;
 
   rxp_img_init(&pkt->img[0]);
@@ -200,6 +210,36 @@ rxp_packet* rxp_packet_queue_find_free_packet(rxp_packet_queue* q) {
   return NULL;
 }
 
+int rxp_packet_queue_requeue(rxp_packet_queue* q, rxp_packet* pkt) {
+
+  if (!q) { return -1; } 
+  if (!pkt) { return -2; } 
+
+  uv_mutex_lock(&q->mutex);
+  {
+    if (pkt != q->last_packet) {
+
+      /* unlink */
+      if (pkt->prev) {
+        pkt->prev->next = pkt->next;
+      }
+      else {
+        q->packets = pkt->next;
+      }
+      pkt->next->prev = pkt->prev;
+
+      /* append */
+      pkt->prev = q->last_packet;
+      pkt->next = NULL;
+      q->last_packet->next = pkt;
+      q->last_packet = pkt;
+    }
+  }
+  uv_mutex_unlock(&q->mutex);
+
+  return 0;
+}
+
 void rxp_packet_queue_lock(rxp_packet_queue* q) {
   if (!q) { return ; }
   uv_mutex_lock(&q->mutex);
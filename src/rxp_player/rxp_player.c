@@ -1,17 +1,49 @@
 #include <string.h>
 #include <rxp_player/rxp_player.h>
+#include <rxp_player/rxp_time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define RXP_PLAYER_SSE2
+#  include <emmintrin.h>
+#endif
+
+#define RXP_PLAYER_ALIGN 16                                                                          /* the planes in the packets are aligned on this many bytes */
+#define RXP_PLAYER_ALIGN_SIZE(n) (((n) + (RXP_PLAYER_ALIGN - 1)) & ~(RXP_PLAYER_ALIGN - 1))
+#define RXP_PLAYER_ALIGN_PTR(p) ((uint8_t*)(((uintptr_t)(p) + (RXP_PLAYER_ALIGN - 1)) & ~(uintptr_t)(RXP_PLAYER_ALIGN - 1)))
 
 /* ---------------------------------------------------------------- */
 
-static int rxp_player_on_open_file(rxp_scheduler* scheduler, char* file);                           /* is called when the scheduler is handling the open file task. */
+static int rxp_player_on_open_file(rxp_scheduler* scheduler, char* file, rxp_io* io);               /* is called when the scheduler is handling the open file task. */
+static int rxp_player_on_reopen_file(rxp_scheduler* scheduler, char* file, rxp_io* io);             /* is called when the scheduler is handling the reopen file task. */
 static int rxp_player_on_close_file(rxp_scheduler* scheduler);                                      /* is called when the scheduler is handling the close file task. */
 static int rxp_player_on_stop(rxp_scheduler* scheduler);                                            /* is called when the scheduler thread stopped. */
 static int rxp_player_on_play(rxp_scheduler* scheduler);                                            /* is called by the scheduler when it handles a play task. */
+static int rxp_player_on_seek(rxp_scheduler* scheduler, uint64_t pts);                              /* is called by the scheduler when it handles a seek task. */
 static void rxp_player_on_decoder_event(rxp_decoder* decoder, int event);                           /* is called by the decoder when something "special" happens. */
 static int rxp_player_on_decode(rxp_scheduler* scheduler, uint64_t goalpts);                        /* is called by the scheduler when we need to decode a frame (audio and/or video). */
 static void rxp_player_on_theora_frame(rxp_decoder* decoder, uint64_t pts, th_ycbcr_buffer buffer); /* is called by the decoder when it decoded a theora frame */
+static void rxp_player_on_theora_stripe(rxp_decoder* decoder, th_ycbcr_buffer buffer, int row0, int row_end); /* is called by the decoder when it decoded a part of a theora frame, see `copy_mode` */
+static void rxp_player_on_theora_dup(rxp_decoder* decoder, uint64_t pts);                           /* is called by the decoder when a frame is the same as the previous one */
+static rxp_packet* rxp_player_get_video_packet(rxp_player* player);                                 /* returns a free packet with enough space for a frame and sets up the planes */
+static void rxp_player_setup_planes(rxp_player* player, th_info* info);                             /* sets up the layout of the planes in the packets for a video stream and selects the copy kernels */
+static void rxp_player_select_copy(rxp_player* player);                                             /* selects the copy kernels for the planes */
+static void rxp_player_copy_rows(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int nbytes, int nrows); /* copies nrows rows of nbytes with memcpy */
+#if defined(RXP_PLAYER_SSE2)
+static void rxp_player_copy_rows_nt16(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int nbytes, int nrows); /* non-temporal stores, dst must be aligned and nbytes a multiple of 16 */
+static void rxp_player_copy_rows_nt(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int nbytes, int nrows); /* non-temporal stores, dst must be aligned */
+static void rxp_player_copy_rows_ntu(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride, int nbytes, int nrows); /* non-temporal stores, for rows that aren't aligned */
+#endif
 static void rxp_player_on_audio(rxp_decoder* decoder, float** pcm, int nsamples);                   /* is called by the decoder when it decoded some audio samples */
+static void rxp_player_on_audio_interleaved(rxp_decoder* decoder, float* pcm, int nframes);         /* is called by the decoder when it decoded some interleaved audio samples (opus) */
+static void rxp_player_write_audio(rxp_player* player, float* pcm, int nframes);                    /* writes interleaved samples into the audio buffer and updates the decoded pts */
 static void rxp_player_reset(rxp_player* player);                                                   /* when we're ready playing all video/audio packets this cleans up internal state */
+static int rxp_player_update_buffering(rxp_player* player);                                         /* when playing a stream, this halts the clock when we ran out of data and continues when the jitter buffer is filled. returns 1 while we're buffering */
+static void rxp_player_set_stream(rxp_player* player, int is_stream);                               /* sets up the jitter buffer when we open a stream */
+static void rxp_player_pad_audio(rxp_player* player, uint64_t pts);                                 /* writes silence into the audio buffer until the audio reaches pts */
+static int rxp_player_begin_reopen(rxp_player* player, int is_stream);                               /* resets the playback state before we add a reopen task and makes sure the scheduler thread runs */
+static void rxp_player_drop_decoded(rxp_player* player);                                             /* marks all video packets as free and empties the audio buffer, w/o freeing them */
+static void rxp_player_reset_audio(rxp_player* player);                                              /* empties the audio buffer and switches to the last audio format; the player must be locked */
+static int rxp_player_apply_audio_formats(rxp_player* player, int keep_format);                     /* switches to the queued audio formats that the playback reached; returns 1 when the samplerate or channels changed. with keep_format we stop at a format that changes them. the player must be locked */
 
 /* ---------------------------------------------------------------- */
 
@@ -54,19 +86,43 @@ int rxp_player_init(rxp_player* player) {
   }
 
   player->decoder.user = player;
+  player->decoder.use_threads = 1;
   player->decoder.on_theora = rxp_player_on_theora_frame;
+  player->decoder.on_theora_dup = rxp_player_on_theora_dup;
   player->decoder.on_audio = rxp_player_on_audio;
+  player->decoder.on_audio_interleaved = rxp_player_on_audio_interleaved;
   player->decoder.on_event = rxp_player_on_decoder_event;
   player->scheduler.user = player;
   player->scheduler.open_file = rxp_player_on_open_file;
+  player->scheduler.reopen_file = rxp_player_on_reopen_file;
   player->scheduler.close_file = rxp_player_on_close_file;
   player->scheduler.stop = rxp_player_on_stop;
   player->scheduler.play = rxp_player_on_play;
+  player->scheduler.seek = rxp_player_on_seek;
   player->scheduler.decode = rxp_player_on_decode;
   player->last_used_pts = 0;
   player->total_audio_frames = 0;
   player->samplerate = 0;
   player->nchannels = 0;
+  player->write_samplerate = 0;
+  player->write_nchannels = 0;
+  player->naudio_formats = 0;
+  player->audio_nwritten = 0;
+  player->audio_nread = 0;
+  player->is_stream = 0;
+  player->jitter_min = RXP_PLAYER_JITTER_MIN;
+  player->jitter_max = RXP_PLAYER_JITTER_MAX;
+  player->copy_mode = RXP_COPY_FRAME;
+  player->stripe_pkt = NULL;
+  player->pix_fmt = RXP_YUV420P;
+  player->copy_plane[0] = rxp_player_copy_rows;
+  player->copy_plane[1] = rxp_player_copy_rows;
+  player->copy_plane[2] = rxp_player_copy_rows;
+  player->crop = 0;
+  player->plane_bytes = 0;
+  player->adaptive_quality = 1;
+  player->nframes_missed = 0;
+  player->nreopen = 0;
   player->must_stop = 0;
   player->on_video_frame = NULL;
   player->on_event = NULL;
@@ -154,6 +210,25 @@ int rxp_player_clear(rxp_player* player) {
   player->total_audio_frames = 0;
   player->samplerate = 0;
   player->nchannels = 0;
+  player->write_samplerate = 0;
+  player->write_nchannels = 0;
+  player->naudio_formats = 0;
+  player->audio_nwritten = 0;
+  player->audio_nread = 0;
+  player->is_stream = 0;
+  player->jitter_min = RXP_PLAYER_JITTER_MIN;
+  player->jitter_max = RXP_PLAYER_JITTER_MAX;
+  player->copy_mode = RXP_COPY_FRAME;
+  player->stripe_pkt = NULL;
+  player->pix_fmt = RXP_YUV420P;
+  player->copy_plane[0] = rxp_player_copy_rows;
+  player->copy_plane[1] = rxp_player_copy_rows;
+  player->copy_plane[2] = rxp_player_copy_rows;
+  player->crop = 0;
+  player->plane_bytes = 0;
+  player->adaptive_quality = 1;
+  player->nframes_missed = 0;
+  player->nreopen = 0;
   player->must_stop = 0;
   player->user = NULL;
   player->on_video_frame = NULL;
@@ -173,9 +248,79 @@ int rxp_player_open(rxp_player* player, char* file) {
     return -3;
   }
 
+  rxp_player_set_stream(player, (RXP_IO_STREAM == player->decoder.io_mode) ? 1 : 0);
+
   return rxp_scheduler_open_file(&player->scheduler, file);
 }
 
+int rxp_player_open_io(rxp_player* player, rxp_io* io) {
+  if (!player) { return -1; } 
+  if (!io) { return -2; }
+
+  /* get current state */
+  if (player->state != RXP_PSTATE_NONE) {
+    printf("Error: cannot open ogg stream becasue player has state: %d.\n", player->state);
+    return -3;
+  }
+
+  rxp_player_set_stream(player, io->is_stream);
+
+  return rxp_scheduler_open_io(&player->scheduler, io);
+}
+
+int rxp_player_reopen(rxp_player* player, char* file) {
+  if (!player) { return -1; } 
+  if (!file) { return -2; }
+
+  if (rxp_player_begin_reopen(player, (RXP_IO_STREAM == player->decoder.io_mode) ? 1 : 0) < 0) {
+    return -3;
+  }
+
+  return rxp_scheduler_reopen_file(&player->scheduler, file);
+}
+
+int rxp_player_reopen_io(rxp_player* player, rxp_io* io) {
+  if (!player) { return -1; } 
+  if (!io) { return -2; }
+
+  if (rxp_player_begin_reopen(player, io->is_stream) < 0) {
+    return -3;
+  }
+
+  return rxp_scheduler_reopen_io(&player->scheduler, io);
+}
+
+int rxp_player_select_track(rxp_player* player, int type, int track) {
+  if (!player) { return -1; }
+
+  if (player->state != RXP_PSTATE_NONE) {
+    printf("Error: cannot select a track because player has state: %d.\n", player->state);
+    return -2;
+  }
+
+  return rxp_decoder_select_track(&player->decoder, type, track);
+}
+
+int rxp_player_enable_streams(rxp_player* player, int mask) {
+  if (!player) { return -1; }
+
+  if (player->state != RXP_PSTATE_NONE) {
+    printf("Error: cannot change the streams because player has state: %d.\n", player->state);
+    return -2;
+  }
+
+  if (rxp_decoder_enable_streams(&player->decoder, mask) < 0) {
+    return -3;
+  }
+
+  /* w/o audio nothing drives an audio clock */
+  if (0 == (mask & RXP_DEC_STREAM_AUDIO)) {
+    rxp_clock_init(&player->clock);
+  }
+
+  return 0;
+}
+
 int rxp_player_play(rxp_player* player) {
 
   int state = 0;
@@ -220,6 +365,18 @@ int rxp_player_play(rxp_player* player) {
   return r;
 }
 
+int rxp_player_seek(rxp_player* player, uint64_t pts) {
+
+  if (!player) { return -1; } 
+
+  if (0 != rxp_decoder_is_open(&player->decoder)) {
+    printf("Error: cannot seek because we didn't open a file or we're ready decoding.\n");
+    return -2;
+  }
+
+  return rxp_scheduler_seek(&player->scheduler, pts);
+}
+
 int rxp_player_stop(rxp_player* player) {
 
   int r = 0;
@@ -247,7 +404,7 @@ int rxp_player_stop(rxp_player* player) {
     return r;
   }
 
-  if (player->decoder.fp != NULL) {
+  if (0 == rxp_decoder_is_open(&player->decoder)) {
     /* when file is already open, we need to close it first */
     if(rxp_scheduler_close_file(&player->scheduler) < 0) {
       printf("Erorr: failed to close the file through the scheduler.\n");
@@ -273,7 +430,7 @@ int rxp_player_pause(rxp_player* player) {
 
   rxp_player_lock(player);
   {
-    if (player->state != RXP_PSTATE_PLAYING) {
+    if (0 == (player->state & RXP_PSTATE_PLAYING)) {
       printf("Warning: trying to pause the player, but we're not playing.\n");
       r = -1;
     }
@@ -296,6 +453,7 @@ void rxp_player_update(rxp_player* player) {
   uint64_t curr_time = 0;
   rxp_packet* video_pkt = NULL;
   int state = player->state;
+  int format_changed = 0;
 
   /* do we need to reset / clear? (by audio callback) */
   if(player->must_stop) {
@@ -308,9 +466,24 @@ void rxp_player_update(rxp_player* player) {
     return ;
   }
 
-  /* update the current clock/time */
-  rxp_clock_update(&player->clock);
-  curr_time = player->clock.time; 
+  /* update the current clock/time, the scheduler thread reads it too; the audio callback waits for us to switch to the next audio format */
+  rxp_player_lock(player);
+  {
+    format_changed = rxp_player_apply_audio_formats(player, 0);
+    rxp_clock_update(&player->clock);
+    curr_time = player->clock.time; 
+  }
+  rxp_player_unlock(player);
+
+  if (1 == format_changed && player->on_event) {
+    player->on_event(player, RXP_PLAYER_EVENT_AUDIO_FORMAT);
+  }
+
+  /* when a stream ran out of data we wait until the jitter buffer is filled again */
+  if (player->is_stream && 1 == rxp_player_update_buffering(player)) {
+    rxp_scheduler_update(&player->scheduler);
+    return;
+  }
 
   /* do we have packets that need to be displayed. */
   rxp_packet_queue_lock(&player->packets);
@@ -323,6 +496,9 @@ void rxp_player_update(rxp_player* player) {
 
       if (tail->pts <= player->last_used_pts) {
         /* @todo: this shouldn't actually happen.. these frames can/should be removed directly */
+        if (0 == tail->is_free && tail->pts < player->last_used_pts && RXP_REPEAT_FRAME != tail->type) {
+          player->nframes_missed++;
+        }
         tail->is_free = 1;
         tail = tail->next;
         continue;
@@ -353,7 +529,7 @@ void rxp_player_update(rxp_player* player) {
     /* this is where we cleanup everything when we've reached the last packet. */
     /* @todo: make an is_decode_ready() function? */
     if(state & RXP_PSTATE_DECODE_READY 
-       && video_pkt->pts >= player->scheduler.decoded_pts)
+       && ((RXP_REPEAT_FRAME == video_pkt->type) ? video_pkt->repeat_pts : video_pkt->pts) >= rxp_scheduler_get_decoded_pts(&player->scheduler))
     {
       player->must_stop = 1;
       return;
@@ -403,18 +579,53 @@ int rxp_player_fill_audio_buffer(rxp_player* player,
 {
   int r = 0;
   uint32_t bytes_needed = 0;
+  uint32_t bytes_read = 0;
+  uint64_t bytes_left = 0;
+  int i = 0;
 
   rxp_player_lock(player);
   {
-    if (player->state & RXP_PSTATE_PLAYING) {
+    if ((player->state & RXP_PSTATE_PLAYING) && 0 == (player->state & RXP_PSTATE_BUFFERING)) {
+
+      /* the next link of a chained file may start in the audio buffer; when its format differs we stop there until rxp_player_update() switched */
+      rxp_player_apply_audio_formats(player, 1);
+
       /* read audio */
       bytes_needed = nsamples * sizeof(float) * player->nchannels;
-      rxp_clock_add_samples(&player->clock, nsamples);
+      bytes_read = (bytes_needed < player->audio_buffer.nbytes) ? bytes_needed : player->audio_buffer.nbytes;
+
+      /* we don't read past the first format that differs */
+      for (i = 0; i < player->naudio_formats; ++i) {
+        if (player->audio_formats[i].samplerate != player->samplerate || player->audio_formats[i].nchannels != player->nchannels) {
+          bytes_left = player->audio_formats[i].offset - player->audio_nread;
+          if (bytes_read > bytes_left) {
+            bytes_read = (uint32_t)bytes_left;
+          }
+          break;
+        }
+      }
 
-      if (rxp_ringbuffer_read(&player->audio_buffer, buffer, bytes_needed) < 0) {
+      if (0 == player->audio_buffer.nbytes) {
         memset(buffer, 0x00, bytes_needed);     
-        player->must_stop = 1;
-        r = -1;
+        /* a stream may just be late; rxp_player_update() will start buffering */
+        if (0 == player->is_stream || (player->state & RXP_PSTATE_DECODE_READY)) {
+          player->must_stop = 1;
+          r = -1;
+        }
+      }
+      else if (bytes_read < bytes_needed && i < player->naudio_formats) {
+        /* we play the end of the previous link and silence until we switched to the next format */
+        if (bytes_read > 0) {
+          rxp_ringbuffer_read(&player->audio_buffer, buffer, bytes_read);
+          player->audio_nread += bytes_read;
+        }
+        memset((uint8_t*)buffer + bytes_read, 0x00, bytes_needed - bytes_read);
+        rxp_clock_add_samples(&player->clock, bytes_read / (sizeof(float) * player->nchannels));
+      }
+      else {
+        rxp_ringbuffer_read(&player->audio_buffer, buffer, bytes_needed);
+        player->audio_nread += bytes_read;
+        rxp_clock_add_samples(&player->clock, nsamples);
       }
     }
     else {
@@ -500,11 +711,50 @@ int rxp_player_get_state(rxp_player* p) {
 
 /* ---------------------------------------------------------------- */
 
-static int rxp_player_on_open_file(rxp_scheduler* scheduler, char* file) {
+static int rxp_player_on_open_file(rxp_scheduler* scheduler, char* file, rxp_io* io) {
   rxp_player* p = (rxp_player*) scheduler->user;
+
+  p->stripe_pkt = NULL;
+  p->decoder.on_theora_stripe = (RXP_COPY_FRAME == p->copy_mode) ? NULL : rxp_player_on_theora_stripe;
+
+  if (io) {
+    return rxp_decoder_open_io(&p->decoder, io);
+  }
   return rxp_decoder_open_file(&p->decoder, file);
 }
 
+/* 
+   gets called by the scheduler thread when the user reopens the player. The 
+   decoder closes the previous file and drops its streams and codecs, but keeps
+   its threads; we keep the packets and the audio buffer and only drop what they
+   contain.
+*/
+static int rxp_player_on_reopen_file(rxp_scheduler* scheduler, char* file, rxp_io* io) {
+
+  rxp_player* p = (rxp_player*) scheduler->user;
+
+  if (rxp_decoder_reset(&p->decoder) < 0) {
+    printf("Error: cannot reset the decoder in rxp_player_on_reopen_file.\n");
+    return -1;
+  }
+
+  /* the previous file may have decoded some more data after rxp_player_reopen() */
+  rxp_player_drop_decoded(p);
+
+  rxp_player_lock(p);
+  {
+    p->samplerate = 0;
+    p->write_samplerate = 0;
+    p->state &= ~RXP_PSTATE_DECODE_READY;
+    if (p->nreopen > 0) {
+      p->nreopen--;
+    }
+  }
+  rxp_player_unlock(p);
+
+  return rxp_player_on_open_file(scheduler, file, io);
+}
+
 /* when we are asked to close the file (by the scheduler) it means we're ready 
    with decoding everything and our next step is to close the file and stop the 
    scheduler */
@@ -527,6 +777,42 @@ static int rxp_player_on_play(rxp_scheduler* scheduler) {
   return 0;
 }
 
+/* 
+   gets called by the scheduler thread when the user wants to seek. When the decoder 
+   found the new position we drop all decoded video and audio and set the clock to 
+   the seek pts. The decoder only gives us frames and samples from the pts on.
+*/
+static int rxp_player_on_seek(rxp_scheduler* scheduler, uint64_t pts) {
+
+  rxp_player* p = (rxp_player*) scheduler->user;
+  rxp_packet* pkt = NULL;
+
+  if (rxp_decoder_seek(&p->decoder, pts) < 0) {
+    return -1;
+  }
+
+  rxp_packet_queue_lock(&p->packets);
+  {
+    pkt = p->packets.packets;
+    while (pkt) {
+      pkt->is_free = 1;
+      pkt = pkt->next;
+    }
+    p->last_used_pts = 0;
+  }
+  rxp_packet_queue_unlock(&p->packets);
+
+  rxp_player_lock(p);
+  {
+    rxp_player_reset_audio(p);
+    rxp_clock_seek(&p->clock, pts);
+    p->total_audio_frames = (uint64_t)rxp_time_to_count(pts, p->write_samplerate, 1);
+  }
+  rxp_player_unlock(p);
+
+  return 0;
+}
+
 /* gets called by the scheduler when it's stopped. */
 static int rxp_player_on_stop(rxp_scheduler* scheduler) {
   rxp_player* p = (rxp_player*) scheduler->user;
@@ -541,34 +827,47 @@ static int rxp_player_on_decode(rxp_scheduler* scheduler, uint64_t goalpts) {
 
   rxp_player* p = (rxp_player*) scheduler->user;
   rxp_decoder* decoder = &p->decoder;
-  rxp_stream* stream = NULL;
+  rxp_stream* streams[2];
   int r = 0;
+  int i = 0;
   int did_reach_goal = 0;
   int has_valid_streams = 0;
 
+  /* tell the decoder which frames are too late to be shown */
+  rxp_player_lock(p);
+  {
+    decoder->late_pts = 0;
+    if (p->adaptive_quality
+        && (p->state & RXP_PSTATE_PLAYING)
+        && 0 == (p->state & (RXP_PSTATE_PAUSED | RXP_PSTATE_BUFFERING)))
+      {
+        decoder->late_pts = p->clock.time;
+      }
+  }
+  rxp_player_unlock(p);
+
   do {
 
     r = rxp_decoder_decode(decoder);
 
-    /* check if all streams reached the goal pts */
+    /* check if the streams we play reached the goal pts; the pages of other tracks are dropped */
     did_reach_goal = 1;
-    stream = decoder->streams;
+    streams[0] = decoder->video;
+    streams[1] = decoder->audio;
 
-    while(stream) {
+    for (i = 0; i < 2; ++i) {
 
-      /* unsupported stream, or already ended? -> skip */
-      if(stream->type == RXP_NONE || stream->eos) {
-        stream = stream->next;
+      /* not found yet (e.g. at the start of a link), or already ended? -> skip */
+      if (NULL == streams[i] || streams[i]->eos) {
         continue;
       }
       
       /* when the stream decoded_pts hasn't reached the goal yet, we continue decoding */
       has_valid_streams = 1;
-      if (stream->decoded_pts <= goalpts) {
+      if (rxp_decoder_get_decoded_pts(decoder, streams[i]) <= (int64_t)goalpts) {
         did_reach_goal = 0;
         break;
       }
-      stream = stream->next;
     }
     
     /* did all streams reach the goal pts? */
@@ -583,11 +882,146 @@ static int rxp_player_on_decode(rxp_scheduler* scheduler, uint64_t goalpts) {
 
 static void rxp_player_on_theora_frame(rxp_decoder* decoder, uint64_t pts, th_ycbcr_buffer buffer) {
   
-  int y_bytes, u_bytes, v_bytes, nbytes;
+  int i;
+  rxp_player* p = (rxp_player*) decoder->user;
+  rxp_packet* pkt = NULL;
+
+  if (NULL != p->stripe_pkt) {
+
+    /* the stripes have already been copied */
+    pkt = p->stripe_pkt;
+    p->stripe_pkt = NULL;
+
+  }
+  else {
+    pkt = rxp_player_get_video_packet(p);
+    for (i = 0; i < 3; ++i) {
+      p->copy_plane[i](pkt->img[i].data, pkt->img[i].stride, 
+                       buffer[i].data + p->plane_y[i] * buffer[i].stride + p->plane_x[i], buffer[i].stride,
+                       pkt->img[i].width, pkt->img[i].height);
+    }
+  }
+
+#if defined(RXP_PLAYER_SSE2)
+  /* non-temporal stores must be visible before another thread reads the packet */
+  if (RXP_COPY_STRIPES_NT == p->copy_mode) {
+    _mm_sfence();
+  }
+#endif
+
+  pkt->type = p->pix_fmt;
+  pkt->pix_fmt = p->pix_fmt;
+  pkt->pts = pts;
+  pkt->is_free = 0;
+
+  /* tell the scheduler what pts we decoded. */
+  rxp_scheduler_update_decode_pts(&p->scheduler, pts);
+}
+
+static void rxp_player_on_theora_stripe(rxp_decoder* decoder, th_ycbcr_buffer buffer, int row0, int row_end) {
+
+  rxp_player* p = (rxp_player*) decoder->user;
+  rxp_packet* pkt = p->stripe_pkt;
+  int ydec = 0;
+  int y0 = 0;
+  int y1 = 0;
+  int i;
+
+  /* the first stripe of a frame */
+  if (NULL == pkt) {
+    pkt = rxp_player_get_video_packet(p);
+    p->stripe_pkt = pkt;
+  }
+
+  for (i = 0; i < 3; ++i) {
+
+    /* the rows of the stripe that we copy */
+    ydec = (0 != i && RXP_YUV420P == p->pix_fmt) ? 1 : 0;
+    y0 = row0 >> ydec;
+    y1 = row_end >> ydec;
+    if (y0 < p->plane_y[i]) {
+      y0 = p->plane_y[i];
+    }
+    if (y1 > p->plane_y[i] + pkt->img[i].height) {
+      y1 = p->plane_y[i] + pkt->img[i].height;
+    }
+    if (y1 <= y0) {
+      continue;
+    }
+
+    p->copy_plane[i](pkt->img[i].data + (y0 - p->plane_y[i]) * pkt->img[i].stride, pkt->img[i].stride,
+                     buffer[i].data + y0 * buffer[i].stride + p->plane_x[i], buffer[i].stride,
+                     pkt->img[i].width, y1 - y0);
+  }
+}
+
+/* 
+   A duplicate frame doesn't need a copy; we queue a marker that tells the
+   user to keep showing the previous frame. Consecutive duplicates extend the
+   marker that hasn't been shown yet, so static scenes don't use any packets.
+*/
+static void rxp_player_on_theora_dup(rxp_decoder* decoder, uint64_t pts) {
+
   rxp_player* p = (rxp_player*) decoder->user;
-  rxp_packet* pkt = rxp_packet_queue_find_free_packet(&p->packets);
+  rxp_packet* pkt = NULL;
+
+  rxp_packet_queue_lock(&p->packets);
+  {
+    pkt = p->packets.last_packet;
+    if (pkt 
+        && 0 == pkt->is_free 
+        && RXP_REPEAT_FRAME == pkt->type 
+        && pkt->pts > p->last_used_pts) 
+      {
+        pkt->repeat_pts = pts;
+      }
+    else {
+      pkt = NULL;
+    }
+  }
+  rxp_packet_queue_unlock(&p->packets);
+
+  if (NULL == pkt) {
+
+    pkt = rxp_packet_queue_find_free_packet(&p->packets);
+    if (NULL != pkt) {
+      rxp_packet_queue_requeue(&p->packets, pkt);
+    }
+    else {
+      pkt = rxp_packet_alloc();
+      if (!pkt) {
+        printf("Error: cannot allocate a new rxp_packet.\n");
+        exit(1);
+      }
+      if (rxp_packet_queue_add(&p->packets, pkt) < 0) {
+        printf("Error: cannot add the new packet to the queue.\n");
+        exit(1);
+      }
+    }
+
+    /* we keep the data of a reused packet for the next frame, but there is no image */
+    pkt->type = RXP_REPEAT_FRAME;
+    pkt->pix_fmt = p->pix_fmt;
+    pkt->size = 0;
+    rxp_img_init(&pkt->img[0]);
+    rxp_img_init(&pkt->img[1]);
+    rxp_img_init(&pkt->img[2]);
+    pkt->pts = pts;
+    pkt->repeat_pts = pts;
+    pkt->is_free = 0;
+  }
+
+  rxp_scheduler_update_decode_pts(&p->scheduler, pts);
+}
+
+static rxp_packet* rxp_player_get_video_packet(rxp_player* player) {
+
+  int nbytes = player->plane_bytes;
+  int i;
+  uint8_t* tmp = NULL;
+  rxp_packet* pkt = rxp_packet_queue_find_free_packet(&player->packets);
   
-  /* allocate a new packet when no free one was found. */
+  /* allocate a new packet when no free one was found, a reused packet is moved to the end. */
   if (!pkt) {
     pkt = rxp_packet_alloc();
 
@@ -595,91 +1029,308 @@ static void rxp_player_on_theora_frame(rxp_decoder* decoder, uint64_t pts, th_yc
       printf("Error: cannot allocate a new rxp_packet.\n");
       exit(1);
     }
-  }
 
-  y_bytes = buffer[0].stride * buffer[0].height;
-  u_bytes = buffer[1].stride * buffer[1].height;
-  v_bytes = buffer[2].stride * buffer[2].height;
-
-  nbytes = y_bytes + u_bytes + v_bytes;
+    if (rxp_packet_queue_add(&player->packets, pkt) < 0) {
+      printf("Error: cannot add the new packet to the queue.\n");
+      exit(1);
+    }
+  }
+  else {
+    rxp_packet_queue_requeue(&player->packets, pkt);
+  }
 
-  /* @todo: we should check if the nbytes is somewhat valid. */
-  if (pkt->size < nbytes && !pkt->data) {
+  /* @todo: we should check if the nbytes is somewhat valid. 
+     a new packet and a reused repeat marker don't have data yet. */
+  if (!pkt->data) {
 
-    pkt->data = (void*)malloc(nbytes);
+    pkt->data = (void*)malloc(nbytes + RXP_PLAYER_ALIGN - 1);
     if (!pkt->data) {
       printf("Error: cannot allocate data for the packet.\n");
       exit(1);
     }
 
-    if (rxp_packet_queue_add(&p->packets, pkt) < 0) {
-      printf("Error: cannot add the new packet to the queue.\n");
+    pkt->capacity = nbytes;
+  }
+  else if (nbytes > pkt->capacity) {
+
+    /* the frame size changed, e.g. in the next link of a chained file */
+    tmp = (uint8_t*)realloc(pkt->data, nbytes + RXP_PLAYER_ALIGN - 1);
+    if (!tmp) {
+      printf("Error: cannot reallocate data for the packet.\n");
       exit(1);
     }
+
+    pkt->data = tmp;
+    pkt->capacity = nbytes;
   }
-  else {
-    if (nbytes > pkt->size) {
-      printf("@todo: we need to either realloc, or make sure we have a ringbuffer with enough space.\n");
+
+  pkt->size = nbytes;
+
+  for (i = 0; i < 3; ++i) {
+    pkt->img[i] = player->planes[i];
+    pkt->img[i].data = (0 == i) 
+      ? RXP_PLAYER_ALIGN_PTR(pkt->data)
+      : RXP_PLAYER_ALIGN_PTR(pkt->img[i - 1].data + (pkt->img[i - 1].stride * pkt->img[i - 1].height));
+  }
+
+  return pkt;
+}
+
+/* 
+   Sets up the planes from the frame size and the picture region of the 
+   stream. The strides of libtheora can be negative (bottom-up), ours are
+   always positive. W/o `crop` we keep each row aligned, with `crop` the 
+   rows are tightly packed. The chroma picture includes the chroma pixels
+   that are only partly covered by the luma picture.
+*/
+static void rxp_player_setup_planes(rxp_player* player, th_info* info) {
+
+  int xdec = (RXP_YUV444P == player->pix_fmt) ? 0 : 1;
+  int ydec = (RXP_YUV420P == player->pix_fmt) ? 1 : 0;
+  int x0 = 0;
+  int y0 = 0;
+  int x1 = 0;
+  int y1 = 0;
+  int i;
+  rxp_img* img = NULL;
+
+  player->plane_bytes = 0;
+
+  for (i = 0; i < 3; ++i) {
+
+    /* the V plane has the same picture as the U plane */
+    if (0 == i) {
+      x0 = info->pic_x;
+      y0 = info->pic_y;
+      x1 = info->pic_x + info->pic_width;
+      y1 = info->pic_y + info->pic_height;
+    }
+    else if (1 == i) {
+      x0 = info->pic_x >> xdec;
+      y0 = info->pic_y >> ydec;
+      x1 = (info->pic_x + info->pic_width + xdec) >> xdec;
+      y1 = (info->pic_y + info->pic_height + ydec) >> ydec;
+    }
+
+    img = &player->planes[i];
+    rxp_img_init(img);
+
+    if (player->crop) {
+      img->width = x1 - x0;
+      img->height = y1 - y0;
+      img->stride = img->width;
+      img->pic_width = img->width;
+      img->pic_height = img->height;
+      player->plane_x[i] = x0;
+      player->plane_y[i] = y0;
     }
+    else {
+      img->width = (0 == i) ? info->frame_width : (info->frame_width >> xdec);
+      img->height = (0 == i) ? info->frame_height : (info->frame_height >> ydec);
+      img->stride = RXP_PLAYER_ALIGN_SIZE(img->width);
+      img->pic_x = x0;
+      img->pic_y = y0;
+      img->pic_width = x1 - x0;
+      img->pic_height = y1 - y0;
+      player->plane_x[i] = 0;
+      player->plane_y[i] = 0;
+    }
+
+    player->plane_bytes += RXP_PLAYER_ALIGN_SIZE(img->stride * img->height);
   }
-  
-  memcpy(pkt->data, buffer[0].data, y_bytes);
-  memcpy(pkt->data + y_bytes, buffer[1].data, u_bytes);
-  memcpy(pkt->data + y_bytes + u_bytes, buffer[2].data, v_bytes);
 
-  pkt->type = RXP_YUV420P;
-  pkt->pts = pts;
-  pkt->size = nbytes;
-  pkt->is_free = 0;
-  
-  pkt->img[0].width = buffer[0].width;
-  pkt->img[0].height = buffer[0].height;
-  pkt->img[0].stride = buffer[0].stride;
-  pkt->img[0].data = pkt->data;
+  rxp_player_select_copy(player);
+}
 
-  pkt->img[1].width = buffer[1].width;
-  pkt->img[1].height = buffer[1].height;
-  pkt->img[1].stride = buffer[1].stride;
-  pkt->img[1].data = pkt->img[0].data + (pkt->img[0].stride * pkt->img[0].height);
+/* 
+   The kernels are selected once for each video stream so we don't have to 
+   check the copy mode and alignment for each row. Each plane starts at an
+   aligned address (see rxp_player_get_video_packet()); when the stride is a
+   multiple of 16 each row does, and the non-temporal stores don't need a 
+   head. When the width is a multiple of 16 too, they don't need a tail. 
+   W/o `crop` this is true for the luma plane and the chroma planes of 4:4:4,
+   because the width of a theora frame is a multiple of 16.
+*/
+static void rxp_player_select_copy(rxp_player* player) {
 
-  pkt->img[2].width = buffer[2].width;
-  pkt->img[2].height = buffer[2].height;
-  pkt->img[2].stride = buffer[2].stride;
-  pkt->img[2].data = pkt->img[1].data + (pkt->img[1].stride * pkt->img[1].height);
+  int i;
 
-  /* tell the scheduler what pts we decoded. */
-  rxp_scheduler_update_decode_pts(&p->scheduler, pts);
+  for (i = 0; i < 3; ++i) {
+
+    player->copy_plane[i] = rxp_player_copy_rows;
+
+#if defined(RXP_PLAYER_SSE2)
+    if (RXP_COPY_STRIPES_NT == player->copy_mode) {
+      if (0 != (player->planes[i].stride & 15)) {
+        player->copy_plane[i] = rxp_player_copy_rows_ntu;
+      }
+      else if (0 != (player->planes[i].width & 15)) {
+        player->copy_plane[i] = rxp_player_copy_rows_nt;
+      }
+      else {
+        player->copy_plane[i] = rxp_player_copy_rows_nt16;
+      }
+    }
+#endif
+  }
+}
+
+static void rxp_player_copy_rows(uint8_t* dst, 
+                                 int dst_stride, 
+                                 const uint8_t* src, 
+                                 int src_stride, 
+                                 int nbytes, 
+                                 int nrows)
+{
+  int i;
+
+  for (i = 0; i < nrows; ++i) {
+    memcpy(dst + (ptrdiff_t)i * dst_stride, src + (ptrdiff_t)i * src_stride, nbytes);
+  }
+}
+
+#if defined(RXP_PLAYER_SSE2)
+static void rxp_player_copy_rows_nt16(uint8_t* dst, 
+                                      int dst_stride, 
+                                      const uint8_t* src, 
+                                      int src_stride, 
+                                      int nbytes, 
+                                      int nrows)
+{
+  int i = 0;
+  int n = 0;
+  uint8_t* d = NULL;
+  const uint8_t* s = NULL;
+
+  for (i = 0; i < nrows; ++i) {
+
+    d = dst + (ptrdiff_t)i * dst_stride;
+    s = src + (ptrdiff_t)i * src_stride;
+    n = nbytes;
+
+    while (n >= 64) {
+      _mm_stream_si128((__m128i*)(d +  0), _mm_loadu_si128((const __m128i*)(s +  0)));
+      _mm_stream_si128((__m128i*)(d + 16), _mm_loadu_si128((const __m128i*)(s + 16)));
+      _mm_stream_si128((__m128i*)(d + 32), _mm_loadu_si128((const __m128i*)(s + 32)));
+      _mm_stream_si128((__m128i*)(d + 48), _mm_loadu_si128((const __m128i*)(s + 48)));
+      d += 64;
+      s += 64;
+      n -= 64;
+    }
+
+    while (n >= 16) {
+      _mm_stream_si128((__m128i*)d, _mm_loadu_si128((const __m128i*)s));
+      d += 16;
+      s += 16;
+      n -= 16;
+    }
+  }
+}
+
+static void rxp_player_copy_rows_nt(uint8_t* dst, 
+                                    int dst_stride, 
+                                    const uint8_t* src, 
+                                    int src_stride, 
+                                    int nbytes, 
+                                    int nrows)
+{
+  int n = nbytes & ~15;
+
+  rxp_player_copy_rows_nt16(dst, dst_stride, src, src_stride, n, nrows);
+
+  if (n != nbytes) {
+    rxp_player_copy_rows(dst + n, dst_stride, src + n, src_stride, nbytes - n, nrows);
+  }
+}
+
+static void rxp_player_copy_rows_ntu(uint8_t* dst, 
+                                     int dst_stride, 
+                                     const uint8_t* src, 
+                                     int src_stride, 
+                                     int nbytes, 
+                                     int nrows)
+{
+  int i = 0;
+  int head = 0;
+  uint8_t* d = NULL;
+  const uint8_t* s = NULL;
+
+  for (i = 0; i < nrows; ++i) {
+
+    d = dst + (ptrdiff_t)i * dst_stride;
+    s = src + (ptrdiff_t)i * src_stride;
+
+    /* the stream stores need an aligned destination */
+    head = (int)((16 - ((uintptr_t)d & 15)) & 15);
+    if (head > nbytes) {
+      head = nbytes;
+    }
+
+    memcpy(d, s, head);
+    rxp_player_copy_rows_nt(d + head, 0, s + head, 0, nbytes - head, 1);
+  }
 }
+#endif
 
 /* called when the decoder decoded some audio samples */
 static void rxp_player_on_audio(rxp_decoder* decoder, float** pcm, int nframes) {
 
-  static float tmp[4096] = { 0 } ;
-  uint64_t pts  = 0;
   rxp_player* player = (rxp_player*)decoder->user;
+  float* tmp = player->audio_tmp;
+  int max_frames = 0;
+  int count = 0;
+  int offset = 0;
   int dx = 0;
   int i,c;
 
-  int needed = player->nchannels * nframes;
-
-  if (needed > 4096) {
-    printf("Error: our current tmp buffer is not big enough ...\n");
-    exit(0);
+  if (0 == player->write_nchannels) {
+    return;
   }
 
   /* reformat the channels, the incoming data is not interleaved
-     which we will do here. */
-  for (i = 0; i < nframes; ++i) {
-    for (c = 0; c < player->nchannels; ++c) {
-      tmp[dx++] = pcm[c][i]; 
+     which we will do here. this is called on the audio decode thread 
+     so we use a buffer of the player; a block of 5.1 audio doesn't fit
+     at once, so we interleave it in parts. */
+  max_frames = RXP_PLAYER_AUDIO_TMP / player->write_nchannels;
+
+  while (offset < nframes) {
+
+    count = nframes - offset;
+    if (count > max_frames) {
+      count = max_frames;
     }
+
+    dx = 0;
+    for (i = offset; i < offset + count; ++i) {
+      for (c = 0; c < player->write_nchannels; ++c) {
+        tmp[dx++] = pcm[c][i]; 
+      }
+    }
+
+    rxp_player_write_audio(player, tmp, count);
+    offset += count;
   }
+}
+
+/* opus decodes interleaved samples, so we can write them directly */
+static void rxp_player_on_audio_interleaved(rxp_decoder* decoder, float* pcm, int nframes) {
+  rxp_player_write_audio((rxp_player*)decoder->user, pcm, nframes);
+}
+
+static void rxp_player_write_audio(rxp_player* player, float* pcm, int nframes) {
+
+  uint64_t pts = 0;
+  uint32_t nbytes = 0;
  
   rxp_player_lock(player);
   {
+    /* the clock may still play the previous link, so we use the samplerate of what we write */
+    nbytes = nframes * player->write_nchannels * sizeof(float);
     player->total_audio_frames += nframes;
-    pts = rxp_clock_calculate_audio_time(&player->clock, player->total_audio_frames);
-    rxp_ringbuffer_write(&player->audio_buffer, tmp, needed * sizeof(float));
+    pts = (uint64_t)rxp_time_ns((int64_t)player->total_audio_frames, player->write_samplerate, 1);
+    if (0 == rxp_ringbuffer_write(&player->audio_buffer, pcm, nbytes)) {
+      player->audio_nwritten += nbytes;
+    }
   }
   rxp_player_unlock(player);
   
@@ -690,28 +1341,62 @@ static void rxp_player_on_audio(rxp_decoder* decoder, float** pcm, int nframes)
 static void rxp_player_on_decoder_event(rxp_decoder* decoder, int event) {
 
   rxp_player* player = (rxp_player*)decoder->user;
+  int r = 0;
 
   /* make sure update the state */
   if (event == RXP_DEC_EVENT_READY) { 
 
+    /* when the file will be replaced, the reopen task closes it */
     rxp_player_lock(player);
-      player->state |= RXP_PSTATE_DECODE_READY;
+    {
+      r = player->nreopen;
+      if (0 == r) {
+        player->state |= RXP_PSTATE_DECODE_READY;
+      }
+    }
     rxp_player_unlock(player);
     
-    if (rxp_scheduler_close_file(&player->scheduler) < 0) {
+    if (0 == r && rxp_scheduler_close_file(&player->scheduler) < 0) {
       printf("Error: cannot stop the scheduler.\n");
     }
     
   }
   else if (event == RXP_DEC_EVENT_AUDIO_INFO) {
 
-    /* Make sure we're going to use the audio clock by setting the samplerate */
+    /* 
+       We write the new format directly, but the clock and the audio callback 
+       switch when the playback reaches it; the audio buffer may still contain 
+       the end of the previous link of a chained file. 
+    */
     rxp_player_lock(player);
     {
-      player->samplerate = decoder->samplerate;
-      player->nchannels = decoder->nchannels;
-      rxp_clock_set_samplerate(&player->clock, decoder->samplerate);
-      rxp_ringbuffer_allocate(&player->audio_buffer, 1024 * 1024 * 5); 
+      if (0 != player->write_samplerate && player->write_samplerate != decoder->samplerate) {
+        /* the decoded pts continues from the same time at the new samplerate */
+        player->total_audio_frames = (player->total_audio_frames * decoder->samplerate) / player->write_samplerate;
+      }
+
+      player->write_samplerate = decoder->samplerate;
+      player->write_nchannels = decoder->nchannels;
+
+      if (rxp_ringbuffer_allocate(&player->audio_buffer, RXP_PLAYER_AUDIO_BUFFER_SIZE) < 0) {
+        printf("Error: cannot allocate the audio buffer.\n");
+      }
+
+      if (player->naudio_formats >= RXP_PLAYER_AUDIO_FORMATS) {
+        /* many short links with different formats; we play this one in the previous format */
+        printf("Error: too many audio formats in the audio buffer.\n");
+      }
+      else {
+        player->audio_formats[player->naudio_formats].offset = player->audio_nwritten;
+        player->audio_formats[player->naudio_formats].samplerate = decoder->samplerate;
+        player->audio_formats[player->naudio_formats].nchannels = decoder->nchannels;
+        player->naudio_formats++;
+      }
+
+      /* when we don't play anything of the previous format we can switch now; e.g. the first link */
+      if (player->audio_nread == player->audio_nwritten) {
+        rxp_player_reset_audio(player);
+      }
     }
     rxp_player_unlock(player);
 
@@ -720,6 +1405,23 @@ static void rxp_player_on_decoder_event(rxp_decoder* decoder, int event) {
 #endif
     
   }
+  else if (event == RXP_DEC_EVENT_VIDEO_INFO) {
+
+    /* the decoder thread is the only one that copies frames, the lock is for pix_fmt and the planes */
+    rxp_player_lock(player);
+    {
+      player->pix_fmt = decoder->pix_fmt;
+      player->stripe_pkt = NULL;
+      if (NULL != decoder->video) {
+        rxp_player_setup_planes(player, &decoder->video->theora.info);
+      }
+    }
+    rxp_player_unlock(player);
+  }
+  else if (event == RXP_DEC_EVENT_CHAIN) {
+    /* when the audio of the previous link was shorter than its video we add silence to stay in sync */
+    rxp_player_pad_audio(player, decoder->chain_pts);
+  }
 
   /* dispatch the event to a external, user defined listener */
   if (player->on_event) {
@@ -733,7 +1435,8 @@ static void rxp_player_reset(rxp_player* player) {
 
   rxp_player_lock(player);
   {
-    player->state &= ~(RXP_PSTATE_PLAYING | RXP_PSTATE_PAUSED);
+    player->state &= ~(RXP_PSTATE_PLAYING | RXP_PSTATE_PAUSED | RXP_PSTATE_BUFFERING);
+    player->nreopen = 0; /* the scheduler thread stopped, so it dropped the reopen tasks */
     rxp_clock_stop(&player->clock);
   }
   rxp_player_unlock(player);
@@ -745,3 +1448,221 @@ static void rxp_player_reset(rxp_player* player) {
   player->must_stop = 0;
 }
 
+static void rxp_player_set_stream(rxp_player* player, int is_stream) {
+
+  player->is_stream = is_stream;
+
+  if (is_stream) {
+    player->scheduler.decode_ahead = player->jitter_max;
+  }
+  else {
+    player->scheduler.decode_ahead = RXP_SCHED_DECODE_AHEAD;
+  }
+}
+
+/*
+   Switching to another file w/o rxp_player_clear() and rxp_player_init(): we 
+   stop the playback directly, so rxp_player_update() and the audio callback 
+   stop using the data of the previous file, and let the scheduler thread replace
+   the file. When the previous file ended, rxp_player_stop() joined the scheduler
+   thread and we start it again.
+*/
+static int rxp_player_begin_reopen(rxp_player* player, int is_stream) {
+
+  if (0xCAFEBABE != player->is_init) {
+    printf("Error: cannot reopen because the player is not initialized.\n");
+    return -1;
+  }
+
+  rxp_player_lock(player);
+  {
+    player->state = RXP_PSTATE_NONE;
+    player->nreopen++;
+    player->must_stop = 0;
+    rxp_clock_stop(&player->clock);
+  }
+  rxp_player_unlock(player);
+
+  rxp_player_drop_decoded(player);
+  rxp_player_set_stream(player, is_stream);
+
+  if (rxp_scheduler_start(&player->scheduler) < 0) {
+    printf("Error: cannot restart the scheduler thread.\n");
+    rxp_player_lock(player);
+      player->nreopen--;
+    rxp_player_unlock(player);
+    return -2;
+  }
+
+  return 0;
+}
+
+static void rxp_player_drop_decoded(rxp_player* player) {
+
+  rxp_packet* pkt = NULL;
+
+  rxp_packet_queue_lock(&player->packets);
+  {
+    pkt = player->packets.packets;
+    while (pkt) {
+      pkt->is_free = 1;
+      pkt = pkt->next;
+    }
+    player->last_used_pts = 0;
+  }
+  rxp_packet_queue_unlock(&player->packets);
+
+  rxp_player_lock(player);
+  {
+    rxp_player_reset_audio(player);
+    player->total_audio_frames = 0;
+  }
+  rxp_player_unlock(player);
+}
+
+static void rxp_player_reset_audio(rxp_player* player) {
+
+  rxp_ringbuffer_reset(&player->audio_buffer);
+
+  player->audio_nread = player->audio_nwritten;
+  rxp_player_apply_audio_formats(player, 0);
+
+  player->audio_nread = 0;
+  player->audio_nwritten = 0;
+}
+
+/* 
+   The formats are queued at the offset in the audio buffer where their samples 
+   start. When the samplerate changes we keep the current time of the clock and 
+   continue counting samples at the new rate.
+*/
+static int rxp_player_apply_audio_formats(rxp_player* player, int keep_format) {
+
+  rxp_player_audio_format* format = NULL;
+  uint64_t time = 0;
+  int is_paused = 0;
+  int changed = 0;
+  int i = 0;
+
+  while (player->naudio_formats > 0 && player->audio_formats[0].offset <= player->audio_nread) {
+
+    format = &player->audio_formats[0];
+
+    if (format->samplerate != player->samplerate || format->nchannels != player->nchannels) {
+
+      if (keep_format) {
+        break;
+      }
+
+      if (format->samplerate != player->samplerate) {
+        if (RXP_CLOCK_AUDIO == player->clock.type) {
+          time = rxp_clock_calculate_audio_time(&player->clock, player->clock.nsamples);
+          is_paused = player->clock.is_paused;
+          rxp_clock_set_samplerate(&player->clock, format->samplerate);
+          rxp_clock_seek(&player->clock, time);
+          if (is_paused) {
+            rxp_clock_pause(&player->clock);
+          }
+        }
+        else {
+          rxp_clock_set_samplerate(&player->clock, format->samplerate);
+        }
+      }
+
+      player->samplerate = format->samplerate;
+      player->nchannels = format->nchannels;
+      changed = 1;
+    }
+
+    for (i = 1; i < player->naudio_formats; ++i) {
+      player->audio_formats[i - 1] = player->audio_formats[i];
+    }
+
+    player->naudio_formats--;
+  }
+
+  return changed;
+}
+
+/* 
+   The links of a chained file are played back to back. The audio is written
+   into the same ringbuffer and the audio clock just continues, but when the 
+   audio of a link ended before its video the next link would be out of sync;
+   we fill the gap with silence.
+*/
+static void rxp_player_pad_audio(rxp_player* player, uint64_t pts) {
+
+  static float silence[4096] = { 0 };
+  uint64_t target = 0;
+  uint64_t nframes = 0;
+  uint64_t max_frames = 0;
+
+  rxp_player_lock(player);
+  {
+    if (0 != player->write_samplerate && 0 != player->write_nchannels) {
+
+      target = (uint64_t)rxp_time_to_count(pts, player->write_samplerate, 1);
+      max_frames = 4096 / player->write_nchannels;
+
+      while (player->total_audio_frames < target) {
+        nframes = target - player->total_audio_frames;
+        if (nframes > max_frames) {
+          nframes = max_frames;
+        }
+        if (rxp_ringbuffer_write(&player->audio_buffer, silence, nframes * player->write_nchannels * sizeof(float)) < 0) {
+          break;
+        }
+        player->total_audio_frames += nframes;
+        player->audio_nwritten += nframes * player->write_nchannels * sizeof(float);
+      }
+    }
+  }
+  rxp_player_unlock(player);
+}
+
+/* 
+   When a stream runs dry, the decoded pts stops growing while the clock 
+   continues. Instead of showing frames late and stopping because the audio 
+   buffer is empty we halt the clock until we have `jitter_min` nanoseconds
+   of new data. 
+*/
+static int rxp_player_update_buffering(rxp_player* player) {
+
+  uint64_t decoded_pts = rxp_scheduler_get_decoded_pts(&player->scheduler);
+  uint64_t curr_time = 0;
+  int event = RXP_NONE;
+  int r = 0;
+
+  rxp_player_lock(player);
+  {
+    curr_time = player->clock.time;
+
+    if (player->state & RXP_PSTATE_BUFFERING) {
+      if ((player->state & RXP_PSTATE_DECODE_READY) 
+          || decoded_pts >= curr_time + player->jitter_min) 
+      {
+        player->state &= ~RXP_PSTATE_BUFFERING;
+        rxp_clock_resume(&player->clock);
+        event = RXP_PLAYER_EVENT_BUFFERED;
+      }
+      else {
+        r = 1;
+      }
+    }
+    else if (0 == (player->state & RXP_PSTATE_DECODE_READY) 
+             && decoded_pts <= curr_time)
+    {
+      player->state |= RXP_PSTATE_BUFFERING;
+      rxp_clock_pause(&player->clock);
+      event = RXP_PLAYER_EVENT_BUFFERING;
+      r = 1;
+    }
+  }
+  rxp_player_unlock(player);
+
+  if (event != RXP_NONE && player->on_event) {
+    player->on_event(player, event);
+  }
+
+  return r;
+}
@@ -0,0 +1,579 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ogg/ogg.h>
+#include <theora/theoradec.h>
+#include <vorbis/codec.h>
+#include <rxp_player/rxp_probe.h>
+#include <rxp_player/rxp_framer.h>
+#include <rxp_player/rxp_time.h>
+#include <rxp_player/rxp_types.h>
+
+/* ---------------------------------------------------------------- */
+
+typedef struct rxp_probe_stream rxp_probe_stream;
+typedef struct rxp_probe_reader rxp_probe_reader;
+typedef struct rxp_probe_batch rxp_probe_batch;
+
+struct rxp_probe_stream {
+  int serial;                                                                /* serial of the logical stream */
+  int type;                                                                  /* RXP_THEORA or RXP_VORBIS */
+  uint64_t fps_numerator;                                                    /* theora */
+  uint64_t fps_denominator;                                                  /* theora */
+  int shift;                                                                 /* theora, keyframe granule shift */
+  int frame_offset;                                                          /* theora, 1 for bitstreams >= 3.2.1 */
+  uint64_t samplerate;                                                       /* vorbis */
+};
+
+struct rxp_probe_reader {                                                    /* reads pages in place with the framer or through the ogg sync layer */
+  rxp_io* io;
+  rxp_framer framer;
+  ogg_sync_state sync;
+  int serials[RXP_PROBE_MAX_STREAMS];                                        /* the serials of all streams of the first link, also the ones we don't decode */
+  int nserials;                                                              /* number of serials, -1 when the first link has more streams than we can store */
+};
+
+struct rxp_probe_batch {                                                     /* shared by the threads of rxp_probe_files() */
+  char** filepaths;
+  int nfiles;
+  int next;                                                                  /* the next file to probe, protected by mutex */
+  rxp_probe_callback cb;
+  void* user;
+  uv_mutex_t mutex;                                                          /* protects next and serializes the callbacks */
+};
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_probe_thread(void* batch);                                  /* probes files until there are none left */
+static int rxp_probe_json_string(char* dest, size_t nbytes, const char* str); /* writes str as an escaped JSON string, returns the number of bytes or < 0 */
+static const char* rxp_probe_pix_fmt_name(int pix_fmt);
+static int rxp_probe_read_headers(rxp_probe_reader* reader, rxp_probe_info* info, rxp_probe_stream* streams, int* nstreams); /* parses the identification headers on the bos pages */
+static int rxp_probe_read_duration(rxp_probe_reader* reader, rxp_probe_info* info, rxp_probe_stream* streams, int nstreams); /* finds the duration using the last pages */
+static int rxp_probe_next_page(rxp_probe_reader* reader, ogg_page* page);   /* returns 0 when we read a page, 1 at the end */
+static int rxp_probe_seek(rxp_probe_reader* reader, int64_t pos);           /* continue reading pages at pos */
+static uint64_t rxp_probe_end_time(rxp_probe_stream* stream, int64_t granule); /* converts the granule of a page into the end time in ns */
+static int rxp_probe_pix_fmt(th_pixel_fmt fmt);                             /* converts a theora pixel format into RXP_YUV* */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_probe(char* filepath, rxp_probe_info* info) {
+
+  rxp_io io;
+  int r = 0;
+
+  if (!filepath) { return -1; }
+  if (!info) { return -2; }
+
+  /* we only read a couple of pages, stdio doesn't make the kernel read ahead megabytes like mmap/read-ahead do */
+  if (rxp_io_open_file(&io, filepath, RXP_IO_STDIO, 0) < 0) {
+    printf("Error: cannot open %s for probing.\n", filepath);
+    return -3;
+  }
+
+  r = rxp_probe_io(&io, info);
+
+  rxp_io_close(&io);
+
+  return (r < 0) ? -4 : 0;
+}
+
+int rxp_probe_io(rxp_io* io, rxp_probe_info* info) {
+
+  rxp_probe_reader reader;
+  rxp_probe_stream streams[RXP_PROBE_MAX_STREAMS];
+  const uint8_t* data = NULL;
+  uint64_t nbytes = 0;
+  int nstreams = 0;
+  int r = 0;
+
+  if (!io) { return -1; }
+  if (!info) { return -2; }
+
+  if (0 != rxp_io_is_open(io)) {
+    printf("Error: cannot probe, the io source is not opened.\n");
+    return -3;
+  }
+
+  memset(info, 0x00, sizeof(rxp_probe_info));
+  info->file_size = rxp_io_size(io);
+
+  reader.io = io;
+  reader.nserials = 0;
+  rxp_framer_init(&reader.framer);
+  if (0 != ogg_sync_init(&reader.sync)) {
+    return -4;
+  }
+
+  data = rxp_io_get_data(io, &nbytes);
+  if (NULL != data) {
+    rxp_framer_open(&reader.framer, data, nbytes);
+  }
+
+  if (rxp_probe_read_headers(&reader, info, streams, &nstreams) < 0) {
+    r = -5;
+    goto done;
+  }
+
+  if (0 == info->has_video && 0 == info->has_audio) {
+    printf("Error: no theora or vorbis stream found.\n");
+    r = -6;
+    goto done;
+  }
+
+  if (rxp_probe_read_duration(&reader, info, streams, nstreams) < 0) {
+    r = -7;
+    goto done;
+  }
+
+ done:
+  ogg_sync_clear(&reader.sync);
+  return r;
+}
+
+int rxp_probe_files(char** filepaths, int nfiles, int nthreads, rxp_probe_callback cb, void* user) {
+
+  rxp_probe_batch batch;
+  uv_thread_t threads[RXP_PROBE_MAX_THREADS];
+  uv_cpu_info_t* cpus = NULL;
+  int ncpus = 0;
+  int i = 0;
+
+  if (!filepaths) { return -1; }
+  if (!cb) { return -2; }
+  if (nfiles <= 0) { return 0; }
+
+  if (nthreads <= 0) {
+    nthreads = 1;
+    if (0 == uv_cpu_info(&cpus, &ncpus)) {
+      nthreads = ncpus;
+      uv_free_cpu_info(cpus, ncpus);
+    }
+  }
+
+  if (nthreads > RXP_PROBE_MAX_THREADS) {
+    nthreads = RXP_PROBE_MAX_THREADS;
+  }
+
+  if (nthreads > nfiles) {
+    nthreads = nfiles;
+  }
+
+  if (0 != uv_mutex_init(&batch.mutex)) {
+    printf("Error: cannot initialize the probe mutex.\n");
+    return -3;
+  }
+
+  batch.filepaths = filepaths;
+  batch.nfiles = nfiles;
+  batch.next = 0;
+  batch.cb = cb;
+  batch.user = user;
+
+  for (i = 0; i < nthreads; ++i) {
+    if (0 != uv_thread_create(&threads[i], rxp_probe_thread, &batch)) {
+      printf("Error: cannot create probe thread %d.\n", i);
+      break;
+    }
+  }
+
+  /* when we couldn't create any thread, we probe on this one */
+  if (0 == i) {
+    rxp_probe_thread(&batch);
+  }
+
+  nthreads = i;
+  for (i = 0; i < nthreads; ++i) {
+    uv_thread_join(&threads[i]);
+  }
+
+  uv_mutex_destroy(&batch.mutex);
+
+  return 0;
+}
+
+int rxp_probe_to_json(rxp_probe_result* result, char* dest, size_t nbytes) {
+
+  rxp_probe_info* info = NULL;
+  size_t len = 0;
+  int n = 0;
+
+  if (!result) { return -1; }
+  if (!dest) { return -2; }
+
+  info = &result->info;
+
+#define RXP_PROBE_APPEND(...)                                           \
+  n = snprintf(dest + len, nbytes - len, __VA_ARGS__);                  \
+  if (n < 0 || (size_t)n >= nbytes - len) { return -3; }                \
+  len += (size_t)n;
+
+  RXP_PROBE_APPEND("{\"file\":");
+
+  n = rxp_probe_json_string(dest + len, nbytes - len, result->filepath);
+  if (n < 0) {
+    return -4;
+  }
+  len += (size_t)n;
+
+  RXP_PROBE_APPEND(",\"ok\":%s,\"probe_ms\":%.3f", (0 == result->status) ? "true" : "false", result->time / 1e6);
+
+  if (0 == result->status) {
+
+    if (info->is_chained) {
+      RXP_PROBE_APPEND(",\"size\":%lld,\"duration\":null,\"chained\":true", (long long)info->file_size);
+    }
+    else {
+      RXP_PROBE_APPEND(",\"size\":%lld,\"duration\":%.6f", (long long)info->file_size, info->duration / 1e9);
+    }
+
+    if (info->has_video) {
+      RXP_PROBE_APPEND(",\"video\":{\"width\":%d,\"height\":%d,\"frame_width\":%d,\"frame_height\":%d,"
+                       "\"fps_num\":%u,\"fps_den\":%u,\"fps\":%.3f,\"pix_fmt\":\"%s\"}",
+                       info->width, info->height, info->frame_width, info->frame_height,
+                       info->fps_numerator, info->fps_denominator,
+                       (double)info->fps_numerator / info->fps_denominator,
+                       rxp_probe_pix_fmt_name(info->pix_fmt));
+    }
+
+    if (info->has_audio) {
+      RXP_PROBE_APPEND(",\"audio\":{\"samplerate\":%llu,\"channels\":%d}",
+                       (unsigned long long)info->samplerate, info->nchannels);
+    }
+  }
+
+  RXP_PROBE_APPEND("}");
+
+#undef RXP_PROBE_APPEND
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_probe_thread(void* user) {
+
+  rxp_probe_batch* batch = (rxp_probe_batch*)user;
+  rxp_probe_result result;
+  uint64_t start = 0;
+  int i = 0;
+
+  while (1) {
+
+    uv_mutex_lock(&batch->mutex);
+    {
+      i = batch->next;
+      if (i < batch->nfiles) {
+        batch->next++;
+      }
+    }
+    uv_mutex_unlock(&batch->mutex);
+
+    if (i >= batch->nfiles) {
+      return;
+    }
+
+    start = uv_hrtime();
+    result.filepath = batch->filepaths[i];
+    result.status = rxp_probe(result.filepath, &result.info);
+    result.time = uv_hrtime() - start;
+
+    uv_mutex_lock(&batch->mutex);
+    {
+      batch->cb(&result, batch->user);
+    }
+    uv_mutex_unlock(&batch->mutex);
+  }
+}
+
+static int rxp_probe_json_string(char* dest, size_t nbytes, const char* str) {
+
+  size_t len = 0;
+  unsigned char c = 0;
+
+  if (nbytes < 3) {
+    return -1;
+  }
+
+  dest[len++] = '"';
+
+  for (; *str; ++str) {
+
+    c = (unsigned char)*str;
+
+    /* we need at most 6 bytes for a character, plus the closing quote and 0 */
+    if (len + 8 > nbytes) {
+      return -2;
+    }
+
+    if ('"' == c || '\\' == c) {
+      dest[len++] = '\\';
+      dest[len++] = (char)c;
+    }
+    else if (c < 0x20) {
+      len += (size_t)sprintf(dest + len, "\\u%04x", c);
+    }
+    else {
+      dest[len++] = (char)c;
+    }
+  }
+
+  dest[len++] = '"';
+  dest[len] = '\0';
+
+  return (int)len;
+}
+
+static const char* rxp_probe_pix_fmt_name(int pix_fmt) {
+
+  switch (pix_fmt) {
+    case RXP_YUV422P: { return "yuv422p"; }
+    case RXP_YUV444P: { return "yuv444p"; }
+    default:          { return "yuv420p"; }
+  }
+}
+
+static int rxp_probe_read_headers(rxp_probe_reader* reader, rxp_probe_info* info, rxp_probe_stream* streams, int* nstreams) {
+
+  ogg_page page;
+  ogg_packet packet;
+  ogg_stream_state stream_state;
+  th_info theora_info;
+  th_comment theora_comment;
+  th_setup_info* theora_setup = NULL;
+  vorbis_info vorbis_info;
+  vorbis_comment vorbis_comment;
+  rxp_probe_stream* stream = NULL;
+  int r = 0;
+
+  while (0 == (r = rxp_probe_next_page(reader, &page))) {
+
+    /* all bos pages come before the other pages */
+    if (0 == ogg_page_bos(&page)) {
+      break;
+    }
+
+    /* the duration scan uses these to detect the next links of a chained file */
+    if (reader->nserials >= 0 && reader->nserials < RXP_PROBE_MAX_STREAMS) {
+      reader->serials[reader->nserials++] = ogg_page_serialno(&page);
+    }
+    else {
+      reader->nserials = -1;
+    }
+
+    if (*nstreams >= RXP_PROBE_MAX_STREAMS) {
+      continue;
+    }
+
+    /* the bos page contains exactly one packet: the identification header */
+    if (0 != ogg_stream_init(&stream_state, ogg_page_serialno(&page))) {
+      return -1;
+    }
+
+    if (0 != ogg_stream_pagein(&stream_state, &page) || 1 != ogg_stream_packetout(&stream_state, &packet)) {
+      ogg_stream_clear(&stream_state);
+      continue;
+    }
+
+    stream = &streams[*nstreams];
+    memset(stream, 0x00, sizeof(rxp_probe_stream));
+    stream->serial = ogg_page_serialno(&page);
+
+    th_info_init(&theora_info);
+    th_comment_init(&theora_comment);
+    theora_setup = NULL;
+
+    if (th_decode_headerin(&theora_info, &theora_comment, &theora_setup, &packet) > 0
+        && theora_info.fps_numerator > 0 && theora_info.fps_denominator > 0)
+      {
+        stream->type = RXP_THEORA;
+        stream->fps_numerator = theora_info.fps_numerator;
+        stream->fps_denominator = theora_info.fps_denominator;
+        stream->shift = theora_info.keyframe_granule_shift;
+        stream->frame_offset = rxp_time_theora_offset(theora_info.version_major, theora_info.version_minor, theora_info.version_subminor);
+
+        if (0 == info->has_video) {
+          info->has_video = 1;
+          info->width = theora_info.pic_width;
+          info->height = theora_info.pic_height;
+          info->frame_width = theora_info.frame_width;
+          info->frame_height = theora_info.frame_height;
+          info->fps_numerator = theora_info.fps_numerator;
+          info->fps_denominator = theora_info.fps_denominator;
+          info->pix_fmt = rxp_probe_pix_fmt(theora_info.pixel_fmt);
+        }
+      }
+
+    if (theora_setup) {
+      th_setup_free(theora_setup);
+    }
+    th_comment_clear(&theora_comment);
+    th_info_clear(&theora_info);
+
+    if (RXP_NONE == stream->type && 1 == vorbis_synthesis_idheader(&packet)) {
+
+      vorbis_info_init(&vorbis_info);
+      vorbis_comment_init(&vorbis_comment);
+
+      if (0 == vorbis_synthesis_headerin(&vorbis_info, &vorbis_comment, &packet) && vorbis_info.rate > 0) {
+
+        stream->type = RXP_VORBIS;
+        stream->samplerate = (uint64_t)vorbis_info.rate;
+
+        if (0 == info->has_audio) {
+          info->has_audio = 1;
+          info->samplerate = (uint64_t)vorbis_info.rate;
+          info->nchannels = vorbis_info.channels;
+        }
+      }
+
+      vorbis_comment_clear(&vorbis_comment);
+      vorbis_info_clear(&vorbis_info);
+    }
+
+    ogg_stream_clear(&stream_state);
+
+    if (RXP_NONE != stream->type) {
+      (*nstreams)++;
+    }
+  }
+
+  return (r < 0) ? -2 : 0;
+}
+
+static int rxp_probe_read_duration(rxp_probe_reader* reader, rxp_probe_info* info, rxp_probe_stream* streams, int nstreams) {
+
+  ogg_page page;
+  int64_t size = info->file_size;
+  int64_t tail = RXP_PROBE_TAIL_SIZE;
+  int64_t start = 0;
+  int64_t granule = 0;
+  uint64_t end_time = 0;
+  int found = 0;
+  int serial = 0;
+  int is_known = 0;
+  int i = 0;
+
+  if (size <= 0 || !reader->io->seek) {
+    return 0;
+  }
+
+  /* pages of the streams are ordered by time, so the last page with a granule gives a good duration */
+  while (0 == found) {
+
+    start = (size > tail) ? (size - tail) : 0;
+
+    if (rxp_probe_seek(reader, start) < 0) {
+      return -1;
+    }
+
+    while (0 == rxp_probe_next_page(reader, &page)) {
+
+      serial = ogg_page_serialno(&page);
+
+      /* a page of a stream that isn't part of the first link: the file is chained */
+      is_known = (reader->nserials < 0) ? 1 : 0;
+      for (i = 0; i < reader->nserials && 0 == is_known; ++i) {
+        is_known = (reader->serials[i] == serial) ? 1 : 0;
+      }
+
+      if (0 == is_known) {
+#if !defined(NDEBUG)
+        printf("Info: the file is chained, we don't know its duration.\n");
+#endif
+        info->is_chained = 1;
+        info->duration = 0;
+        return 0;
+      }
+
+      granule = ogg_page_granulepos(&page);
+      if (granule < 0) {
+        continue;
+      }
+
+      for (i = 0; i < nstreams; ++i) {
+        if (streams[i].serial == serial) {
+          end_time = rxp_probe_end_time(&streams[i], granule);
+          if (end_time > info->duration) {
+            info->duration = end_time;
+          }
+          found = 1;
+          break;
+        }
+      }
+    }
+
+    if (0 == start || tail >= RXP_PROBE_MAX_TAIL_SIZE) {
+      break;
+    }
+
+    tail *= 2;
+  }
+
+  return 0;
+}
+
+static int rxp_probe_next_page(rxp_probe_reader* reader, ogg_page* page) {
+
+  char* buffer = NULL;
+  int read = 0;
+
+  if (0xCAFEBABE == reader->framer.is_init) {
+    return (0 == rxp_framer_next(&reader->framer, page, NULL)) ? 0 : 1;
+  }
+
+  while (1 != ogg_sync_pageout(&reader->sync, page)) {
+
+    buffer = ogg_sync_buffer(&reader->sync, RXP_PROBE_CHUNK_SIZE);
+    if (!buffer) {
+      return -1;
+    }
+
+    read = rxp_io_read(reader->io, buffer, RXP_PROBE_CHUNK_SIZE);
+    if (read <= 0) {
+      return 1;
+    }
+
+    if (0 != ogg_sync_wrote(&reader->sync, read)) {
+      return -2;
+    }
+  }
+
+  return 0;
+}
+
+static int rxp_probe_seek(rxp_probe_reader* reader, int64_t pos) {
+
+  if (0xCAFEBABE == reader->framer.is_init) {
+    return rxp_framer_seek(&reader->framer, (uint64_t)pos);
+  }
+
+  if (rxp_io_seek(reader->io, pos, SEEK_SET) < 0) {
+    printf("Error: cannot seek to %lld while probing.\n", (long long)pos);
+    return -1;
+  }
+
+  ogg_sync_reset(&reader->sync);
+
+  return 0;
+}
+
+static uint64_t rxp_probe_end_time(rxp_probe_stream* stream, int64_t granule) {
+
+  int64_t frame = 0;
+
+  if (RXP_THEORA == stream->type) {
+    frame = rxp_time_theora_count(granule, stream->shift) - stream->frame_offset;
+    return (uint64_t)rxp_time_ns(frame + 1, stream->fps_numerator, stream->fps_denominator);
+  }
+
+  return (uint64_t)rxp_time_ns(granule, stream->samplerate, 1);
+}
+
+static int rxp_probe_pix_fmt(th_pixel_fmt fmt) {
+
+  switch (fmt) {
+    case TH_PF_422: { return RXP_YUV422P; }
+    case TH_PF_444: { return RXP_YUV444P; }
+    default:        { return RXP_YUV420P; }
+  }
+}
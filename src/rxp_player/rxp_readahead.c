@@ -0,0 +1,273 @@
+#include <stdlib.h>
+#include <string.h>
+#include <rxp_player/rxp_readahead.h>
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_readahead_thread(void* readahead);                        /* the thread function which fills the buffer */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_readahead_init(rxp_readahead* ra) {
+
+  if (!ra) { return -1; }
+
+  ra->fp = NULL;
+  ra->buffer = NULL;
+  ra->capacity = 0;
+  ra->head = 0;
+  ra->tail = 0;
+  ra->nbytes = 0;
+  ra->eof = 0;
+  ra->error = 0;
+  ra->must_stop = 0;
+  ra->nreads = 0;
+  ra->nwaits = 0;
+  ra->wait_time = 0;
+  ra->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+int rxp_readahead_start(rxp_readahead* ra, FILE* fp, uint32_t nbytes) {
+
+  if (!ra) { return -1; }
+  if (!fp) { return -2; }
+
+  if (0xCAFEBABE == ra->is_init) {
+    printf("Error: the read-ahead thread is already running.\n");
+    return -3;
+  }
+
+  if (nbytes < RXP_READAHEAD_CHUNK_SIZE) {
+    nbytes = RXP_READAHEAD_CHUNK_SIZE;
+  }
+
+  ra->buffer = (uint8_t*)malloc(nbytes);
+  if (!ra->buffer) {
+    printf("Error: cannot allocate the read-ahead buffer.\n");
+    return -4;
+  }
+
+  if (uv_mutex_init(&ra->mutex) != 0) {
+    printf("Error: cannot initialize the read-ahead mutex.\n");
+    free(ra->buffer);
+    ra->buffer = NULL;
+    return -5;
+  }
+
+  if (uv_cond_init(&ra->cond) != 0) {
+    printf("Error: cannot initialize the read-ahead condition var.\n");
+    uv_mutex_destroy(&ra->mutex);
+    free(ra->buffer);
+    ra->buffer = NULL;
+    return -6;
+  }
+
+  ra->fp = fp;
+  ra->capacity = nbytes;
+  ra->head = 0;
+  ra->tail = 0;
+  ra->nbytes = 0;
+  ra->eof = 0;
+  ra->error = 0;
+  ra->must_stop = 0;
+  ra->nreads = 0;
+  ra->nwaits = 0;
+  ra->wait_time = 0;
+  ra->is_init = 0xCAFEBABE;
+
+  if (uv_thread_create(&ra->thread, rxp_readahead_thread, (void*)ra) != 0) {
+    printf("Error: cannot create the read-ahead thread.\n");
+    uv_cond_destroy(&ra->cond);
+    uv_mutex_destroy(&ra->mutex);
+    free(ra->buffer);
+    ra->buffer = NULL;
+    ra->fp = NULL;
+    ra->capacity = 0;
+    ra->is_init = 0xDEADBEEF;
+    return -7;
+  }
+
+  return 0;
+}
+
+int rxp_readahead_stop(rxp_readahead* ra) {
+
+  if (!ra) { return -1; }
+  if (0xCAFEBABE != ra->is_init) { return -2; }
+
+  uv_mutex_lock(&ra->mutex);
+  {
+    ra->must_stop = 1;
+    uv_cond_signal(&ra->cond);
+  }
+  uv_mutex_unlock(&ra->mutex);
+
+  uv_thread_join(&ra->thread);
+
+#if !defined(NDEBUG)
+  printf("Info: read-ahead stats, reads: %llu, decoder waited %llu times for %llu ns.\n",
+         (unsigned long long)ra->nreads,
+         (unsigned long long)ra->nwaits,
+         (unsigned long long)ra->wait_time);
+#endif
+
+  uv_cond_destroy(&ra->cond);
+  uv_mutex_destroy(&ra->mutex);
+
+  free(ra->buffer);
+  ra->buffer = NULL;
+  ra->fp = NULL;
+  ra->capacity = 0;
+  ra->is_init = 0xDEADBEEF;
+
+  return 0;
+}
+
+int rxp_readahead_get_stats(rxp_readahead* ra, uint64_t* nreads, uint64_t* nwaits, uint64_t* wait_time) {
+
+  if (!ra) { return -1; }
+  if (!nreads) { return -2; }
+  if (!nwaits) { return -3; }
+  if (!wait_time) { return -4; }
+
+  /* after the thread stopped the counters don't change anymore */
+  if (0xCAFEBABE != ra->is_init) {
+    *nreads = ra->nreads;
+    *nwaits = ra->nwaits;
+    *wait_time = ra->wait_time;
+    return 0;
+  }
+
+  uv_mutex_lock(&ra->mutex);
+  {
+    *nreads = ra->nreads;
+    *nwaits = ra->nwaits;
+    *wait_time = ra->wait_time;
+  }
+  uv_mutex_unlock(&ra->mutex);
+
+  return 0;
+}
+
+int rxp_readahead_read(rxp_readahead* ra, void* dest, uint32_t nbytes) {
+
+  uint64_t wait_start = 0;
+  uint32_t to_end = 0;
+  uint32_t available = 0;
+  int error = 0;
+
+  if (!ra) { return -1; }
+  if (!dest) { return -2; }
+  if (0xCAFEBABE != ra->is_init) { return -3; }
+
+  uv_mutex_lock(&ra->mutex);
+  {
+    if (0 == ra->nbytes && 0 == ra->eof) {
+      ra->nwaits++;
+      wait_start = uv_hrtime();
+      while (0 == ra->nbytes && 0 == ra->eof) {
+        uv_cond_wait(&ra->cond, &ra->mutex);
+      }
+      ra->wait_time += uv_hrtime() - wait_start;
+    }
+    available = ra->nbytes;
+    error = ra->error;
+  }
+  uv_mutex_unlock(&ra->mutex);
+
+  if (0 == available) {
+    return (error) ? -4 : 0;
+  }
+
+  /* only we touch the filled part of the buffer, so we can copy w/o the lock */
+  if (nbytes > available) {
+    nbytes = available;
+  }
+
+  to_end = ra->capacity - ra->tail;
+  if (nbytes <= to_end) {
+    memcpy(dest, ra->buffer + ra->tail, nbytes);
+  }
+  else {
+    memcpy(dest, ra->buffer + ra->tail, to_end);
+    memcpy((uint8_t*)dest + to_end, ra->buffer, nbytes - to_end);
+  }
+
+  uv_mutex_lock(&ra->mutex);
+  {
+    ra->tail = (ra->tail + nbytes) % ra->capacity;
+    ra->nbytes -= nbytes;
+    uv_cond_signal(&ra->cond);
+  }
+  uv_mutex_unlock(&ra->mutex);
+
+  return (int)nbytes;
+}
+
+/* ---------------------------------------------------------------- */
+
+static void rxp_readahead_thread(void* readahead) {
+
+  rxp_readahead* ra = (rxp_readahead*)readahead;
+  uint32_t space = 0;
+  uint32_t head = 0;
+  size_t nread = 0;
+  int is_error = 0;
+
+  while (1) {
+
+    /* wait until there is space for a chunk */
+    uv_mutex_lock(&ra->mutex);
+    {
+      while (0 == ra->must_stop && (ra->capacity - ra->nbytes) < RXP_READAHEAD_CHUNK_SIZE) {
+        uv_cond_wait(&ra->cond, &ra->mutex);
+      }
+
+      if (ra->must_stop) {
+        uv_mutex_unlock(&ra->mutex);
+        return;
+      }
+
+      head = ra->head;
+      space = ra->capacity - ra->nbytes;
+    }
+    uv_mutex_unlock(&ra->mutex);
+
+    /* we only write into the contiguous free part after head */
+    if (space > ra->capacity - head) {
+      space = ra->capacity - head;
+    }
+    if (space > RXP_READAHEAD_CHUNK_SIZE) {
+      space = RXP_READAHEAD_CHUNK_SIZE;
+    }
+
+    nread = fread(ra->buffer + head, 1, space, ra->fp);
+    is_error = (nread < space && ferror(ra->fp)) ? 1 : 0;
+
+    if (is_error) {
+      printf("Error: cannot read the file in the read-ahead thread.\n");
+    }
+
+    uv_mutex_lock(&ra->mutex);
+    {
+      ra->nreads++;
+      ra->head = (ra->head + (uint32_t)nread) % ra->capacity;
+      ra->nbytes += (uint32_t)nread;
+      if (is_error) {
+        ra->error = 1;
+        ra->eof = 1;
+      }
+      else if (0 == nread) {
+        ra->eof = 1;
+      }
+      uv_cond_signal(&ra->cond);
+    }
+    uv_mutex_unlock(&ra->mutex);
+
+    if (0 == nread || is_error) {
+      return;
+    }
+  }
+}
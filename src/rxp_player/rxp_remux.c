@@ -0,0 +1,498 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ogg/ogg.h>
+#include <rxp_player/rxp_remux.h>
+#include <rxp_player/rxp_decoder.h>
+#include <rxp_player/rxp_time.h>
+#include <rxp_player/rxp_types.h>
+
+#define RXP_REMUX_VIDEO 0                                                    /* index of the theora stream in rxp_remux.streams */
+#define RXP_REMUX_AUDIO 1                                                    /* index of the vorbis or opus stream in rxp_remux.streams */
+#define RXP_REMUX_NSTREAMS 2
+
+/* ---------------------------------------------------------------- */
+
+typedef struct rxp_remux_stream rxp_remux_stream;
+typedef struct rxp_remux rxp_remux;
+
+struct rxp_remux_stream {                                                    /* a stream that we copy */
+  int serial;                                                                /* the serial of the source stream, -1 when the file doesn't have this kind of stream */
+  int type;                                                                  /* RXP_THEORA, RXP_VORBIS or RXP_OPUS */
+  ogg_stream_state out;                                                      /* the stream we write, it has the same serial */
+  int is_started;                                                            /* 1 when we've written the first data packet */
+  int is_ended;                                                              /* 1 when we've written the last packet */
+  int64_t start;                                                             /* theora: the frame count of the keyframe we start at, -1 for the first keyframe; audio: the first granule we copy */
+  int64_t end;                                                               /* theora: the first frame index we don't copy, audio: the granule of the last sample we copy; -1 to copy until the end */
+  int64_t granule_base;                                                      /* we subtract this from the granulepos of the source packets */
+  int64_t last_granule;                                                      /* audio: the granulepos of the previous packet, which is where the next packet starts */
+};
+
+struct rxp_remux {
+  rxp_decoder* decoder;                                                      /* we use the decoder to demux and to seek */
+  FILE* fp;                                                                  /* the file we write */
+  rxp_remux_stream streams[RXP_REMUX_NSTREAMS];                              /* RXP_REMUX_VIDEO and RXP_REMUX_AUDIO */
+  rxp_demux_packet pkt;                                                      /* the last packet we got from the decoder */
+};
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_remux_read_headers(rxp_remux* rx);                           /* copies the header packets, returns 0 when `pkt` is the first data packet */
+static int rxp_remux_find_keyframe(rxp_remux* rx, uint64_t start, uint64_t* time); /* finds the last keyframe at or before start, time is set to the time at which it's shown */
+static int rxp_remux_set_range(rxp_remux* rx, uint64_t start, uint64_t end); /* sets the granules at which the streams start and end; start is the time of the keyframe */
+static int rxp_remux_copy_packet(rxp_remux* rx);                            /* writes `pkt` when it's in the range, returns 1 when all streams ended */
+static int rxp_remux_write_page(rxp_remux* rx, ogg_page* page);
+static int rxp_remux_is_done(rxp_remux* rx);                                /* returns 1 when all streams ended */
+static rxp_remux_stream* rxp_remux_find_stream(rxp_remux* rx, int serial);  /* returns the stream we copy for the serial or NULL */
+
+/* ---------------------------------------------------------------- */
+
+int rxp_remux_trim(char* srcpath, char* dstpath, uint64_t start, uint64_t end) {
+
+  rxp_remux rx;
+  ogg_page page;
+  uint64_t time = 0;
+  int has_packet = 0;
+  int r = 0;
+  int i = 0;
+
+  if (!srcpath) { return -1; }
+  if (!dstpath) { return -2; }
+
+  if (end > 0 && end <= start) {
+    printf("Error: the end of the range must be after the start.\n");
+    return -3;
+  }
+
+  /* the source is memory mapped, we can't write into it at the same time */
+  if (0 == strcmp(srcpath, dstpath)) {
+    printf("Error: cannot remux a file into itself.\n");
+    return -4;
+  }
+
+  memset((char*)&rx, 0x00, sizeof(rx));
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    rx.streams[i].serial = -1;
+    rx.streams[i].start = -1;
+    rx.streams[i].end = -1;
+    rx.streams[i].last_granule = -1;
+  }
+
+  rx.decoder = rxp_decoder_alloc();
+  if (!rx.decoder) {
+    return -5;
+  }
+
+  if (rxp_decoder_open_file(rx.decoder, srcpath) < 0) {
+    printf("Error: cannot open %s to remux.\n", srcpath);
+    r = -6;
+    goto done;
+  }
+
+  rx.fp = fopen(dstpath, "wb");
+  if (!rx.fp) {
+    printf("Error: cannot open %s for writing.\n", dstpath);
+    r = -7;
+    goto done;
+  }
+
+  if (rxp_remux_read_headers(&rx) < 0) {
+    r = -8;
+    goto done;
+  }
+
+  /* the headers end with the first data packet, when we start at 0 we copy it */
+  has_packet = 1;
+
+  if (start > 0) {
+
+    if (rxp_remux_find_keyframe(&rx, start, &time) < 0) {
+      r = -9;
+      goto done;
+    }
+
+    /* go back to where find_keyframe started reading, w/o bisecting again; w/o video it didn't seek yet */
+    if (rx.decoder->seek_offset >= 0) {
+      r = rxp_decoder_seek_offset(rx.decoder, start, rx.decoder->seek_offset);
+    }
+    else {
+      r = rxp_decoder_seek(rx.decoder, start);
+    }
+
+    if (r < 0) {
+      r = -10;
+      goto done;
+    }
+
+    has_packet = 0;
+  }
+
+  rxp_remux_set_range(&rx, time, end);
+
+  while (has_packet || 0 == rxp_decoder_demux(rx.decoder, &rx.pkt)) {
+
+    has_packet = 0;
+
+    r = rxp_remux_copy_packet(&rx);
+    if (r < 0) {
+      r = -11;
+      goto done;
+    }
+
+    if (1 == r) {
+      break;
+    }
+  }
+
+  r = 0;
+
+  /* the last page of each stream gets the eos flag */
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    if (rx.streams[i].serial < 0) {
+      continue;
+    }
+    rx.streams[i].out.e_o_s = 1;
+    while (0 != ogg_stream_flush(&rx.streams[i].out, &page)) {
+      if (rxp_remux_write_page(&rx, &page) < 0) {
+        r = -12;
+        goto done;
+      }
+    }
+  }
+
+ done:
+
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    if (rx.streams[i].serial >= 0) {
+      ogg_stream_clear(&rx.streams[i].out);
+    }
+  }
+
+  if (rx.fp) {
+    if (0 != fclose(rx.fp) && 0 == r) {
+      printf("Error: cannot close %s.\n", dstpath);
+      r = -13;
+    }
+  }
+
+  if (0 == rxp_decoder_is_open(rx.decoder)) {
+    rxp_decoder_close_file(rx.decoder);
+  }
+
+  rxp_decoder_clear(rx.decoder);
+  free(rx.decoder);
+
+  return r;
+}
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_remux_read_headers(rxp_remux* rx) {
+
+  rxp_decoder* dec = rx->decoder;
+  rxp_remux_stream* s = NULL;
+  ogg_page page;
+  int r = 0;
+  int i = 0;
+
+  while (0 == (r = rxp_decoder_demux(dec, &rx->pkt))) {
+
+    if (rx->pkt.link > 0) {
+      break;
+    }
+
+    /* the bos pages come first; they have to be written before all other pages */
+    if (rx->pkt.packet.b_o_s) {
+
+      if (dec->video && dec->video->serial == rx->pkt.serial) {
+        s = &rx->streams[RXP_REMUX_VIDEO];
+      }
+      else if (dec->audio && dec->audio->serial == rx->pkt.serial) {
+        s = &rx->streams[RXP_REMUX_AUDIO];
+      }
+      else {
+        continue;
+      }
+
+      if (0 != ogg_stream_init(&s->out, rx->pkt.serial)) {
+        printf("Error: cannot initialize the ogg stream for %d.\n", rx->pkt.serial);
+        return -1;
+      }
+
+      s->serial = rx->pkt.serial;
+      s->type = rx->pkt.type;
+
+      ogg_stream_packetin(&s->out, &rx->pkt.packet);
+      while (0 != ogg_stream_flush(&s->out, &page)) {
+        if (rxp_remux_write_page(rx, &page) < 0) {
+          return -2;
+        }
+      }
+      continue;
+    }
+
+    s = rxp_remux_find_stream(rx, rx->pkt.serial);
+    if (NULL == s) {
+      continue;
+    }
+
+    if (0 == rx->pkt.is_header) {
+      break;
+    }
+
+    ogg_stream_packetin(&s->out, &rx->pkt.packet);
+  }
+
+  if (0 != r || rx->pkt.link > 0) {
+    printf("Error: the file has no video or audio data.\n");
+    return -3;
+  }
+
+  /* the first data packet must start on a new page */
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    if (rx->streams[i].serial < 0) {
+      continue;
+    }
+    while (0 != ogg_stream_flush(&rx->streams[i].out, &page)) {
+      if (rxp_remux_write_page(rx, &page) < 0) {
+        return -4;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static int rxp_remux_find_keyframe(rxp_remux* rx, uint64_t start, uint64_t* time) {
+
+  rxp_remux_stream* s = &rx->streams[RXP_REMUX_VIDEO];
+  rxp_stream* video = rx->decoder->video;
+  th_info* info = NULL;
+  uint64_t frame_time = 0;
+  int64_t count = 0;
+
+  *time = start;
+  s->start = -1;
+
+  if (s->serial < 0 || NULL == video) {
+    return 0;
+  }
+
+  if (rxp_decoder_seek(rx->decoder, start) < 0) {
+    return -1;
+  }
+
+  info = &video->theora.info;
+
+  /* read up to the frame that is shown at start and remember the last keyframe */
+  while (0 == rxp_decoder_demux(rx->decoder, &rx->pkt)) {
+
+    if (rx->pkt.link > 0) {
+      break;
+    }
+
+    if (rx->pkt.serial != s->serial || rx->pkt.is_header || rx->pkt.pts < 0) {
+      continue;
+    }
+
+    count = video->demux_frame;
+    frame_time = (uint64_t)rxp_time_ns(count - rxp_time_theora_offset(info->version_major, info->version_minor, info->version_subminor),
+                                       info->fps_numerator,
+                                       info->fps_denominator);
+    if (frame_time > start) {
+      break;
+    }
+
+    if (rx->pkt.is_keyframe) {
+      s->start = count;
+      *time = frame_time;
+    }
+  }
+
+  /* when we didn't see one before start we use the first keyframe after it */
+  if (s->start < 0) {
+    printf("Warning: no keyframe before %llu ns, starting at the next keyframe.\n", (unsigned long long)start);
+  }
+
+#if !defined(NDEBUG)
+  printf("Info: starting the copy at frame %lld (%llu ns).\n", (long long)s->start, (unsigned long long)*time);
+#endif
+
+  return 0;
+}
+
+static int rxp_remux_set_range(rxp_remux* rx, uint64_t start, uint64_t end) {
+
+  rxp_remux_stream* video = &rx->streams[RXP_REMUX_VIDEO];
+  rxp_remux_stream* audio = &rx->streams[RXP_REMUX_AUDIO];
+  th_info* info = NULL;
+  uint64_t rate = 0;
+  uint64_t div = 0;
+  int64_t preskip = 0;
+
+  if (video->serial >= 0 && rx->decoder->video && end > 0) {
+    info = &rx->decoder->video->theora.info;
+    if (info->fps_numerator > 0) {
+      /* the index of the first frame that is shown at or after end */
+      div = (uint64_t)info->fps_denominator * 1000000000ull;
+      video->end = (int64_t)((end * info->fps_numerator + div - 1) / div);
+    }
+  }
+
+  if (audio->serial >= 0 && rx->decoder->audio) {
+
+    if (RXP_OPUS == audio->type) {
+      rate = RXP_OPUS_RATE;
+      preskip = rx->decoder->audio->opus.preskip;
+    }
+    else {
+      rate = rx->decoder->audio->vorbis.info.rate;
+    }
+
+    /* the opus granule includes the pre-skip samples */
+    audio->granule_base = rxp_time_to_count(start, rate, 1);
+    audio->start = audio->granule_base + preskip;
+    if (end > 0) {
+      audio->end = rxp_time_to_count(end, rate, 1) + preskip;
+    }
+  }
+
+  return 0;
+}
+
+static int rxp_remux_copy_packet(rxp_remux* rx) {
+
+  rxp_demux_packet* pkt = &rx->pkt;
+  rxp_remux_stream* s = NULL;
+  th_info* info = NULL;
+  ogg_packet op;
+  ogg_page page;
+  int64_t granule = pkt->granulepos;
+  int64_t count = 0;
+  int offset = 0;
+  int shift = 0;
+
+  /* we only copy the first link of a chained file */
+  if (pkt->link > 0 || 1 == rxp_remux_is_done(rx)) {
+    return 1;
+  }
+
+  s = rxp_remux_find_stream(rx, pkt->serial);
+  if (NULL == s || pkt->is_header || s->is_ended || granule < 0) {
+    return 0;
+  }
+
+  op = pkt->packet;
+  op.b_o_s = 0;
+  op.e_o_s = 0;
+
+  if (RXP_THEORA == s->type) {
+
+    info = &rx->decoder->video->theora.info;
+    shift = info->keyframe_granule_shift;
+    offset = rxp_time_theora_offset(info->version_major, info->version_minor, info->version_subminor);
+    count = rxp_time_theora_count(granule, shift);
+
+    /* the copy starts with the keyframe that we found, its frame becomes the first one */
+    if (0 == s->is_started) {
+      if (0 == pkt->is_keyframe || count < s->start) {
+        return 0;
+      }
+      s->granule_base = (count - offset) << shift;
+      s->is_started = 1;
+    }
+
+    if (s->end >= 0 && count - offset >= s->end) {
+      s->is_ended = 1;
+    }
+    else {
+      op.granulepos = granule - s->granule_base;
+    }
+  }
+  else {
+
+    if (0 == s->is_started) {
+      if (granule < s->start) {
+        s->last_granule = granule;
+        return 0;
+      }
+      s->is_started = 1;
+    }
+
+    /* the last packet ends at end; the decoder drops the samples after the granule of the eos page */
+    if (s->end >= 0 && s->last_granule >= s->end) {
+      s->is_ended = 1;
+    }
+    else {
+      if (s->end >= 0 && granule >= s->end) {
+        granule = s->end;
+        s->is_ended = 1;
+        op.e_o_s = 1;
+      }
+      op.granulepos = granule - s->granule_base;
+    }
+
+    s->last_granule = pkt->granulepos;
+  }
+
+  /* this packet starts after the range */
+  if (s->is_ended && 0 == op.e_o_s) {
+    return rxp_remux_is_done(rx);
+  }
+
+  /* we write the full pages before we add the packet, so the last packet stays in the stream for the eos page */
+  while (0 != ogg_stream_pageout(&s->out, &page)) {
+    if (rxp_remux_write_page(rx, &page) < 0) {
+      return -1;
+    }
+  }
+
+  if (0 != ogg_stream_packetin(&s->out, &op)) {
+    printf("Error: cannot add a packet to the stream %d.\n", s->serial);
+    return -2;
+  }
+
+  return 0;
+}
+
+static int rxp_remux_write_page(rxp_remux* rx, ogg_page* page) {
+
+  if (1 != fwrite(page->header, page->header_len, 1, rx->fp)) {
+    printf("Error: cannot write the page header.\n");
+    return -1;
+  }
+
+  if (page->body_len > 0 && 1 != fwrite(page->body, page->body_len, 1, rx->fp)) {
+    printf("Error: cannot write the page body.\n");
+    return -2;
+  }
+
+  return 0;
+}
+
+static int rxp_remux_is_done(rxp_remux* rx) {
+
+  int i = 0;
+
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    if (rx->streams[i].serial >= 0 && 0 == rx->streams[i].is_ended) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static rxp_remux_stream* rxp_remux_find_stream(rxp_remux* rx, int serial) {
+
+  int i = 0;
+
+  for (i = 0; i < RXP_REMUX_NSTREAMS; ++i) {
+    if (rx->streams[i].serial >= 0 && rx->streams[i].serial == serial) {
+      return &rx->streams[i];
+    }
+  }
+
+  return NULL;
+}
+
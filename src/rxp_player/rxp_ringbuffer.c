@@ -21,15 +21,32 @@ int rxp_ringbuffer_init(rxp_ringbuffer* rb) {
   return 0;
 }
 
-/* allocate a new buffer for nbytes */
+/* allocate a new buffer for nbytes; an empty buffer with another size is reallocated */
 int rxp_ringbuffer_allocate(rxp_ringbuffer* rb, uint32_t nbytes) {
 
   if (!rb) { return -1; } 
   if (!nbytes) { return -2; } 
 
-  if (0xCAFEBABE == rb->is_init) {
-    printf("Info: the ringbuffer is already initialized. ignoring request. first call rxp_ringbuffer_clear\n");
-    return 0;
+  if (0xCAFEBABE != rb->is_init) {
+    printf("Error: the ringbuffer is not initialized, call rxp_ringbuffer_init() first.\n");
+    return -4;
+  }
+
+  /* we keep the buffer and the data in it, e.g. when the next link of a chained file starts */
+  if (NULL != rb->buffer) {
+
+    if (rb->capacity == nbytes) {
+      return 0;
+    }
+
+    if (0 != rb->nbytes) {
+      printf("Error: cannot resize the ringbuffer from %u to %u bytes while it contains data.\n", rb->capacity, nbytes);
+      return -5;
+    }
+
+    free(rb->buffer);
+    rb->buffer = NULL;
+    rb->capacity = 0;
   }
 
   rb->buffer = (uint8_t*)malloc(nbytes);
@@ -78,7 +95,7 @@ int rxp_ringbuffer_write(rxp_ringbuffer* rb, void* data, uint32_t nbytes) {
     
     /* copy the remaining bytes to the start */
     rb->head = (nbytes - space);
-    memcpy(rb->buffer, data, rb->head);
+    memcpy(rb->buffer, (uint8_t*)data + space, rb->head);
     rb->nbytes += nbytes;
   }
   return 0;
@@ -5,11 +5,25 @@
 
 /* ---------------------------------------------------------------- */
 
+typedef struct rxp_scheduler_open_task rxp_scheduler_open_task;
+
+struct rxp_scheduler_open_task {                                           /* the data of a RXP_TASK_OPEN_FILE or RXP_TASK_REOPEN_FILE task, allocated as one block so rxp_task_dealloc() can free it */
+  rxp_io io;                                                               /* the source to open when has_io is 1 */
+  int has_io;                                                              /* 1 when we need to open `io`, 0 when we need to open `file` */
+  char* file;                                                              /* the file to open, points to the memory directly after this struct */
+};
+
+/* ---------------------------------------------------------------- */
+
+static int rxp_scheduler_add_open_task(rxp_scheduler* s, int tasktype, char* file, rxp_io* io); /* adds the (re)open file task for either a file or a source and starts pre-buffering */
+static void rxp_scheduler_on_open_task_dealloc(rxp_task* task);            /* closes the source of a (re)open task that we didn't hand over to the open callback */
 static void rxp_scheduler_thread(void* scheduler);                         /* the thread function from which we trigger decoding and basic play/stop state */
 static void rxp_scheduler_handle_task(rxp_scheduler* s, rxp_task* task);   /* is called from the thread function and will call any set callbacks */
 static void rxp_scheduler_add_decode_task(rxp_scheduler* s);               /* adds a decode tasks and updates internal state */
 static int rxp_scheduler_add_task(rxp_scheduler* s, int tasktype);         /* add a general task that's handled in the thread */
 static int rxp_scheduler_update_goal_pts(rxp_scheduler* s, uint64_t pts);  /* is used internally to make sure we will decode some more when necessary */
+static int rxp_scheduler_has_task(rxp_task* task, int tasktype);           /* returns 0 when the given list contains a task of the given type */
+static int rxp_scheduler_is_outdated(rxp_task* task);                      /* returns 0 when the task doesn't have to be handled because of a task that follows it */
 static int rxp_scheduler_lock(rxp_scheduler* s);                           /* used to protect the internally used data of the scheduler */
 static int rxp_scheduler_unlock(rxp_scheduler* s);                         /* used to protect the internally used data of the scheduler */
 
@@ -51,13 +65,16 @@ int rxp_scheduler_clear(rxp_scheduler* s) {
 
   s->decode = NULL;
   s->open_file = NULL;
+  s->reopen_file = NULL;
   s->close_file = NULL;
   s->play = NULL;
   s->stop = NULL;
+  s->seek = NULL;
   s->user = NULL;
   s->goal_pts = 0;
   s->decoded_pts = 0;
   s->played_pts = 0;
+  s->decode_ahead = RXP_SCHED_DECODE_AHEAD;
   s->state = RXP_SCHED_STATE_NONE;
   s->thread = 0;
   s->is_init = 0xDEADBEEF;
@@ -84,14 +101,17 @@ int rxp_scheduler_init(rxp_scheduler* s) {
   /* callbacks */
   s->decode = NULL;
   s->open_file = NULL;
+  s->reopen_file = NULL;
   s->close_file = NULL;
   s->play = NULL;
   s->stop = NULL;
+  s->seek = NULL;
   s->user = NULL;
   s->thread = 0;
   s->goal_pts = 0;
   s->decoded_pts = 0;
   s->played_pts = 0;
+  s->decode_ahead = RXP_SCHED_DECODE_AHEAD;
   s->state = RXP_SCHED_STATE_NONE;
   s->is_init = 0xCAFEBABE;
   
@@ -114,52 +134,55 @@ int rxp_scheduler_init(rxp_scheduler* s) {
 
 int rxp_scheduler_start(rxp_scheduler* s) {
 
+  int state = 0;
+
   if (!s) { return -1; }
 
-  s->state |= RXP_SCHED_STATE_STARTED;
-  uv_thread_create(&s->thread, rxp_scheduler_thread, (void*)s);
+  rxp_scheduler_lock(s);
+  {
+    state = s->state;
+    s->state |= RXP_SCHED_STATE_STARTED;
+  }
+  rxp_scheduler_unlock(s);
+
+  /* the thread keeps running until rxp_scheduler_stop() */
+  if (state & RXP_SCHED_STATE_STARTED) {
+    return 0;
+  }
+
+  if (uv_thread_create(&s->thread, rxp_scheduler_thread, (void*)s) != 0) {
+    printf("Error: cannot create the scheduler thread.\n");
+    rxp_scheduler_lock(s);
+      s->state &= ~RXP_SCHED_STATE_STARTED;
+    rxp_scheduler_unlock(s);
+    return -2;
+  }
 
   return 0;
 }
 
 int rxp_scheduler_open_file(rxp_scheduler* s, char* file) {
- 
-  rxp_task* task;
   if (!s) { return -1; } 
   if (!file) { return -2; } 
+  return rxp_scheduler_add_open_task(s, RXP_TASK_OPEN_FILE, file, NULL);
+}
 
-  task = rxp_task_alloc();
-  if (!task) {
-    return -3;
-  }
-
-  task->data = malloc(strlen(file) + 1); /* @todo: should we check for a max size in rxp_scheduler_open_file? */
-  if (!task->data) {
-    printf("Error: cannot allocate memory for the open file task.\n");
-    free(task);
-    task = NULL;
-    return -4;
-  }
-
-  memcpy(task->data, file, strlen(file) + 1);
-
-  task->type = RXP_TASK_OPEN_FILE;
- 
-  if (rxp_task_queue_add(&s->tasks, task) < 0) {
-    printf("Error: cannot add the open file task to the task queue.\n");
-    free(task);
-    task = NULL;
-    return -5;
-  }
-  
-  rxp_scheduler_update_goal_pts(s, 3 * 1000ull * 1000ull * 1000ull); /* make sure to decode the next N-frames */
-  rxp_scheduler_add_decode_task(s); 
+int rxp_scheduler_open_io(rxp_scheduler* s, rxp_io* io) {
+  if (!s) { return -1; } 
+  if (!io) { return -2; } 
+  return rxp_scheduler_add_open_task(s, RXP_TASK_OPEN_FILE, NULL, io);
+}
 
-  rxp_scheduler_lock(s);
-    s->state |= RXP_SCHED_STATE_DECODING;
-  rxp_scheduler_unlock(s);
+int rxp_scheduler_reopen_file(rxp_scheduler* s, char* file) {
+  if (!s) { return -1; } 
+  if (!file) { return -2; } 
+  return rxp_scheduler_add_open_task(s, RXP_TASK_REOPEN_FILE, file, NULL);
+}
 
-  return 0;
+int rxp_scheduler_reopen_io(rxp_scheduler* s, rxp_io* io) {
+  if (!s) { return -1; } 
+  if (!io) { return -2; } 
+  return rxp_scheduler_add_open_task(s, RXP_TASK_REOPEN_FILE, NULL, io);
 }
 
 int rxp_scheduler_play(rxp_scheduler* s) {
@@ -198,6 +221,39 @@ int rxp_scheduler_stop(rxp_scheduler* s) {
   return 0;
 }
 
+int rxp_scheduler_seek(rxp_scheduler* s, uint64_t pts) {
+
+  rxp_task* task;
+
+  if (!s) { return -1; } 
+
+  task = rxp_task_alloc();
+  if (!task) {
+    return -2;
+  }
+
+  task->data = malloc(sizeof(uint64_t));
+  if (!task->data) {
+    printf("Error: cannot allocate memory for the seek task.\n");
+    rxp_task_dealloc(task);
+    return -3;
+  }
+
+  *(uint64_t*)task->data = pts;
+  task->type = RXP_TASK_SEEK;
+
+  if (rxp_task_queue_add(&s->tasks, task) < 0) {
+    printf("Error: cannot add the seek task to the task queue.\n");
+    rxp_task_dealloc(task);
+    return -4;
+  }
+
+  /* decode from the new position directly, also when we're paused */
+  rxp_scheduler_add_decode_task(s);
+
+  return 0;
+}
+
 int rxp_scheduler_close_file(rxp_scheduler* s) {
   if (!s) { return -1; } 
   rxp_scheduler_add_task(s, RXP_TASK_CLOSE_FILE);
@@ -207,6 +263,7 @@ int rxp_scheduler_close_file(rxp_scheduler* s) {
 void rxp_scheduler_update(rxp_scheduler* s) {
   uint64_t decoded_pts;
   uint64_t goal_pts;
+  uint64_t decode_ahead;
   int state;
 
 #if !defined(NDEBUG)
@@ -217,6 +274,7 @@ void rxp_scheduler_update(rxp_scheduler* s) {
   rxp_scheduler_lock(s);
     decoded_pts = s->decoded_pts;
     goal_pts = s->goal_pts;
+    decode_ahead = s->decode_ahead;
     state = s->state;
   rxp_scheduler_unlock(s);
 
@@ -233,7 +291,7 @@ void rxp_scheduler_update(rxp_scheduler* s) {
   }
 
   /* update the goal pts */
-  rxp_scheduler_update_goal_pts(s, (10 * 1000ull * 1000ull * 1000ull));
+  rxp_scheduler_update_goal_pts(s, decode_ahead);
 }
 
 /* tell the scheduler up until what pts we've decoded either video or 
@@ -271,6 +329,22 @@ int rxp_scheduler_update_played_pts(rxp_scheduler* s, uint64_t pts) {
   return 0;
 }
 
+/* the decoded pts is updated from the scheduler thread, so we lock */
+uint64_t rxp_scheduler_get_decoded_pts(rxp_scheduler* s) {
+
+  uint64_t pts;
+
+  if (!s) { return 0; } 
+
+  rxp_scheduler_lock(s);
+  {
+    pts = s->decoded_pts;
+  }
+  rxp_scheduler_unlock(s);
+
+  return pts;
+}
+
 
 /* ---------------------------------------------------------------- */
 
@@ -327,6 +401,78 @@ static int rxp_scheduler_add_task(rxp_scheduler* s, int tasktype) {
   return 0;
 }
 
+static int rxp_scheduler_add_open_task(rxp_scheduler* s, int tasktype, char* file, rxp_io* io) {
+ 
+  rxp_task* task;
+  rxp_scheduler_open_task* open_task;
+  size_t file_len = (file) ? strlen(file) + 1 : 1;
+
+  task = rxp_task_alloc();
+  if (!task) {
+    return -3;
+  }
+
+  task->data = malloc(sizeof(rxp_scheduler_open_task) + file_len); /* @todo: should we check for a max size in rxp_scheduler_open_file? */
+  if (!task->data) {
+    printf("Error: cannot allocate memory for the open file task.\n");
+    free(task);
+    task = NULL;
+    return -4;
+  }
+
+  open_task = (rxp_scheduler_open_task*)task->data;
+  open_task->file = (char*)(open_task + 1);
+  open_task->file[0] = '\0';
+  open_task->has_io = 0;
+
+  if (io) {
+    open_task->io = *io;
+    open_task->has_io = 1;
+  }
+  else {
+    memcpy(open_task->file, file, file_len);
+  }
+
+  task->type = tasktype;
+  task->on_dealloc = rxp_scheduler_on_open_task_dealloc;
+ 
+  if (rxp_task_queue_add(&s->tasks, task) < 0) {
+    printf("Error: cannot add the open file task to the task queue.\n");
+    task->on_dealloc = NULL; /* the caller still owns the source */
+    rxp_task_dealloc(task);
+    task = NULL;
+    return -5;
+  }
+  
+  /* make sure to decode the next N-frames */
+  rxp_scheduler_update_goal_pts(s, (s->decode_ahead < RXP_SCHED_PREBUFFER) ? s->decode_ahead : RXP_SCHED_PREBUFFER);
+  rxp_scheduler_add_decode_task(s); 
+
+  rxp_scheduler_lock(s);
+    s->state |= RXP_SCHED_STATE_DECODING;
+  rxp_scheduler_unlock(s);
+
+  return 0;
+}
+
+/* 
+   An open task owns its source until the open callback accepted it. When the
+   callback failed w/o closing it (e.g. because another file is still open) or
+   when the task is dropped, e.g. by rxp_scheduler_stop(), we close it here.
+*/
+static void rxp_scheduler_on_open_task_dealloc(rxp_task* task) {
+
+  rxp_scheduler_open_task* open_task = (rxp_scheduler_open_task*)task->data;
+
+  if (NULL == open_task || 0 == open_task->has_io) {
+    return;
+  }
+
+  if (0 == rxp_io_is_open(&open_task->io)) {
+    rxp_io_close(&open_task->io);
+  }
+}
+
 static void rxp_scheduler_thread(void* scheduler) {
   
   rxp_scheduler* s;
@@ -377,19 +523,21 @@ static void rxp_scheduler_thread(void* scheduler) {
           rxp_scheduler_handle_task(s, task);
         }
         if (task->type == RXP_TASK_STOP) {
-          /* when we recieved a stop task, we clear our task queue and stop the thread */
           rxp_scheduler_handle_task(s, task);
-          rxp_task_dealloc_all(work); 
         }
         task = task->next;
       }
+      /* when we recieved a stop task, we clear our task queue and stop the thread */
+      rxp_task_dealloc_all(work); 
       return;
     }
 
     /* when no task with more preference is found we perform the work */
     task = work;
     while (task) {
-      rxp_scheduler_handle_task(s, task);
+      if (0 != rxp_scheduler_is_outdated(task)) {
+        rxp_scheduler_handle_task(s, task);
+      }
       task = task->next;
     }
     rxp_task_dealloc_all(work);
@@ -415,10 +563,41 @@ static void rxp_scheduler_handle_task(rxp_scheduler* s, rxp_task* task) {
     }
     case RXP_TASK_OPEN_FILE: {
       if (s->open_file) {
-        if (s->open_file(s, (char*)task->data) < 0) {
+        rxp_scheduler_open_task* open_task = (rxp_scheduler_open_task*)task->data;
+        if (s->open_file(s, 
+                         (open_task->has_io) ? NULL : open_task->file, 
+                         (open_task->has_io) ? &open_task->io : NULL) < 0) 
+        {
           printf("Error: cannot open the file. RXP_TASK_OPEN_FILE failed.\n");
         }   
+        else if (open_task->has_io) {
+          /* the callback owns the source now */
+          rxp_io_init(&open_task->io);
+        }
+      }
+      break;
+    }
+    case RXP_TASK_REOPEN_FILE: {
+      rxp_scheduler_open_task* open_task = (rxp_scheduler_open_task*)task->data;
+      if (s->reopen_file) {
+        if (s->reopen_file(s, 
+                           (open_task->has_io) ? NULL : open_task->file, 
+                           (open_task->has_io) ? &open_task->io : NULL) < 0) 
+        {
+          printf("Error: cannot reopen the file. RXP_TASK_REOPEN_FILE failed.\n");
+        }
+        else if (open_task->has_io) {
+          rxp_io_init(&open_task->io);
+        }
       }
+      /* start pre-buffering the new file from the start */
+      rxp_scheduler_lock(s);
+      {
+        s->decoded_pts = 0;
+        s->played_pts = 0;
+        s->goal_pts = (s->decode_ahead < RXP_SCHED_PREBUFFER) ? s->decode_ahead : RXP_SCHED_PREBUFFER;
+      }
+      rxp_scheduler_unlock(s);
       break;
     }
     case RXP_TASK_CLOSE_FILE: {
@@ -437,6 +616,24 @@ static void rxp_scheduler_handle_task(rxp_scheduler* s, rxp_task* task) {
       }
       break;
     }
+    case RXP_TASK_SEEK: {
+      uint64_t pts = *(uint64_t*)task->data;
+      if (s->seek) {
+        if (s->seek(s, pts) < 0) {
+          printf("Error: cannot seek. RXP_TASK_SEEK failed.\n");
+          break;
+        }
+      }
+      /* start pre-buffering from the new position */
+      rxp_scheduler_lock(s);
+      {
+        s->decoded_pts = pts;
+        s->played_pts = pts;
+        s->goal_pts = pts + ((s->decode_ahead < RXP_SCHED_PREBUFFER) ? s->decode_ahead : RXP_SCHED_PREBUFFER);
+      }
+      rxp_scheduler_unlock(s);
+      break;
+    }
     case RXP_TASK_STOP: {
       /* 
          Gracefully ignore the stop task; as it will stop the thread. 
@@ -470,3 +667,32 @@ static int rxp_scheduler_update_goal_pts(rxp_scheduler* s, uint64_t pts) {
 
   return 0;
 }
+
+static int rxp_scheduler_is_outdated(rxp_task* task) {
+
+  /* when there is another seek task, this one is outdated */
+  if (RXP_TASK_SEEK == task->type && 0 == rxp_scheduler_has_task(task->next, RXP_TASK_SEEK)) {
+    return 0;
+  }
+
+  /* decoding or seeking the file that will be replaced is useless */
+  if ((RXP_TASK_SEEK == task->type || RXP_TASK_DECODE == task->type) 
+      && 0 == rxp_scheduler_has_task(task->next, RXP_TASK_REOPEN_FILE)) 
+    {
+      return 0;
+    }
+
+  return -1;
+}
+
+static int rxp_scheduler_has_task(rxp_task* task, int tasktype) {
+
+  while (task) {
+    if (task->type == tasktype) {
+      return 0;
+    }
+    task = task->next;
+  }
+
+  return -1;
+}
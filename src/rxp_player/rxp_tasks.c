@@ -14,6 +14,7 @@ rxp_task* rxp_task_alloc() {
   t->type = RXP_NONE;
   t->state = RXP_NONE;
   t->data = NULL;
+  t->on_dealloc = NULL;
   t->next = NULL;
 
   return t;
@@ -23,6 +24,11 @@ int rxp_task_dealloc (rxp_task* task) {
 
   if (!task) { return -1; } 
 
+  if (task->on_dealloc) {
+    task->on_dealloc(task);
+    task->on_dealloc = NULL;
+  }
+
   if (task->data) {
     free(task->data);
     task->data = NULL;
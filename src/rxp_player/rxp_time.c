@@ -0,0 +1,59 @@
+#include <rxp_player/rxp_time.h>
+
+/* ---------------------------------------------------------------- */
+
+int64_t rxp_time_ns(int64_t n, uint64_t rate_num, uint64_t rate_den) {
+
+  uint64_t t = 0;
+
+  if (n <= 0 || 0 == rate_num) {
+    return 0;
+  }
+
+  t = (uint64_t)n * rate_den;
+
+  return (int64_t)((t / rate_num) * 1000000000ull + ((t % rate_num) * 1000000000ull) / rate_num);
+}
+
+int64_t rxp_time_to_count(uint64_t pts, uint64_t rate_num, uint64_t rate_den) {
+
+  uint64_t secs = pts / 1000000000ull;
+  uint64_t nanos = pts % 1000000000ull;
+  uint64_t t = 0;
+
+  if (0 == rate_den) {
+    return 0;
+  }
+
+  /* (pts * rate_num) / (rate_den * 1e9), split in whole seconds and the rest */
+  t = secs * rate_num;
+
+  return (int64_t)(t / rate_den + ((t % rate_den) * 1000000000ull + nanos * rate_num) / (rate_den * 1000000000ull));
+}
+
+/* the granule is the frame number of the last keyframe, shifted, plus the offset from that keyframe */
+int64_t rxp_time_theora_count(int64_t granule, int shift) {
+  return (granule >> shift) + (granule & ((1ll << shift) - 1));
+}
+
+int rxp_time_theora_offset(int version_major, int version_minor, int version_subminor) {
+
+  uint32_t version = (version_major << 16) | (version_minor << 8) | version_subminor;
+
+  return (version >= 0x030201) ? 1 : 0;
+}
+
+int64_t rxp_time_theora_ns(th_info* info, int64_t granule) {
+
+  int offset = 0;
+
+  if (granule < 0 || 0 == info->fps_numerator) {
+    return 0;
+  }
+
+  offset = rxp_time_theora_offset(info->version_major, info->version_minor, info->version_subminor);
+
+  return rxp_time_ns(rxp_time_theora_count(granule, info->keyframe_granule_shift) + 1 - offset,
+                     info->fps_numerator,
+                     info->fps_denominator);
+}